@@ -88,6 +88,8 @@ Settings config = {
     .fixed_num_lines   = FALSE,
     /** Do not use history */
     .disable_history   = FALSE,
+    /** Maximum number of entries kept in the history */
+    .max_history_size  =                                      1000,
     /** Use levenshtein sorting when matching */
     .levenshtein_sort  = FALSE,
     /** Case sensitivity of the search */
@@ -0,0 +1,59 @@
+#ifndef ROFI_DESKTOP_ENTRY_H
+#define ROFI_DESKTOP_ENTRY_H
+
+#include <glib.h>
+
+/**
+ * @defgroup DesktopEntry DesktopEntry
+ * @ingroup HELPERS
+ *
+ * Minimal parser for the desktop files drun lists.
+ * Only the [Desktop Entry] group is parsed, in a single pass over the file; parsing stops at the
+ * next group, so actions and other groups are never looked at. Of the translated keys only the
+ * best match for the current languages is kept, and only the retained strings are allocated.
+ *
+ * @{
+ */
+
+/**
+ * The keys of a [Desktop Entry] group used by drun.
+ */
+typedef struct
+{
+    /** Name, best match for the languages, NULL if not set. */
+    char     *name;
+    /** GenericName, best match for the languages, NULL if not set. */
+    char     *generic_name;
+    /** Exec, NULL if not set. */
+    char     *exec;
+    /** Terminal */
+    gboolean terminal;
+    /** Hidden */
+    gboolean hidden;
+    /** NoDisplay */
+    gboolean no_display;
+} DesktopEntry;
+
+/**
+ * @param data The content of the desktop file.
+ * @param length The length of data.
+ * @param languages The languages to match translated keys against, best first, as returned by g_get_language_names().
+ * @param entry The entry to fill in, free with desktop_entry_clear().
+ *
+ * Parse the [Desktop Entry] group of a desktop file. Values are unescaped like GKeyFile does, values
+ * that are not valid UTF-8 are ignored.
+ * This function is thread safe.
+ *
+ * @returns FALSE if the file has no [Desktop Entry] group or a line in it can not be parsed.
+ */
+gboolean desktop_entry_parse ( const char *data, gsize length, const char * const *languages, DesktopEntry *entry );
+
+/**
+ * @param entry The entry to clear.
+ *
+ * Free the strings of the entry.
+ */
+void desktop_entry_clear ( DesktopEntry *entry );
+
+/*@}*/
+#endif // ROFI_DESKTOP_ENTRY_H
@@ -17,5 +17,11 @@ int dmenu_switcher_dialog ( void );
 
 void print_dmenu_options ( void );
 
+/**
+ * Start reading the dmenu input on a separate thread, so it overlaps with the rest of the startup.
+ * The thread is joined when the dmenu mode is initialized.
+ */
+void dmenu_prefetch_start ( void );
+
 /*@}*/
 #endif // ROFI_DIALOG_DMENU_H
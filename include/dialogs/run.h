@@ -14,5 +14,14 @@
  */
 extern Mode run_mode;
 
+/**
+ * @param sw The run mode.
+ *
+ * The output of the run-list-command is read while the window is shown.
+ * Finish reading it before returning, for users of the mode that do not pick up entries
+ * appended later on (like combi).
+ */
+void run_mode_wait_external ( Mode *sw );
+
 /*@}*/
 #endif // DIALOG_RUN_H
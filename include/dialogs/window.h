@@ -9,9 +9,18 @@
  */
 #include <config.h>
 #ifdef WINDOW_MODE
+#include <xcb/xcb.h>
 
 extern Mode window_mode;
 extern Mode window_mode_cd;
+
+/**
+ * @param ev The property notify event.
+ *
+ * Keep the window list up to date: add and remove rows when the client list changes,
+ * and update the row of a client when one of the shown properties changes.
+ */
+void window_mode_property_notify ( xcb_property_notify_event_t *ev );
 #endif // WINDOW_MODE
 /* @}*/
 #endif // ROFI_DIALOG_WINDOW_H
@@ -23,6 +23,29 @@
  */
 int helper_parse_setup ( char * string, char ***output, int *length, ... );
 
+/**
+ * Compile the command templates of the configuration (run, run shell and ssh command),
+ * so helper_parse_setup() does not have to parse them on every launch, and build the
+ * environment of launched processes.
+ * Call after the configuration is loaded.
+ */
+void helper_launch_setup ( void );
+
+/**
+ * Free the compiled templates and the environment.
+ */
+void helper_launch_cleanup ( void );
+
+/**
+ * @param args  The arguments, as returned by helper_parse_setup(). The command is looked up in PATH.
+ * @param error Set when the process could not be started.
+ *
+ * Start the process with posix_spawn, which does not copy the address space of rofi.
+ *
+ * @returns TRUE when the process was started.
+ */
+gboolean helper_spawn ( char **args, GError **error );
+
 /**
  * @param token The string for which we want a collation key.
  * @param case_sensitive Whether case is significant.
@@ -1,14 +1,18 @@
 #ifndef ROFI_HISTORY_H
 #define ROFI_HISTORY_H
 
+#include <glib.h>
+
 /**
  * @defgroup HISTORY History
  * @ingroup HELPERS
  *
  * Implements a very simple history module that can be used by a #Mode.
+ * Entries are ranked on frecency: every use counts one, halving in weight every two weeks.
  *
  * This uses the following options from the #config object:
  * * #_Settings::disable_history
+ * * #_Settings::max_history_size
  *
  * @{
  */
@@ -17,11 +21,26 @@
  * @param filename The filename of the history cache.
  * @param entry    The entry to add/increment
  *
- * Sets the entry in the history, if it exists its use-count is incremented.
+ * Records a use of the entry in the history, at the current time.
  *
  */
 void history_set ( const char *filename, const char *entry ) __attribute__( ( nonnull ) );
 
+/**
+ * @param filename The filename of the history cache.
+ * @param entry    The entry to add/increment
+ *
+ * Like history_set(), but the file is written by a background thread, so launching the
+ * selected entry does not wait for the file I/O. Call history_flush() before exiting.
+ */
+void history_set_deferred ( const char *filename, const char *entry ) __attribute__( ( nonnull ) );
+
+/**
+ * Wait until the entries queued by history_set_deferred() are written.
+ * history_remove() and history_get_list() do this first.
+ */
+void history_flush ( void );
+
 /**
  * @param filename The filename of the history cache.
  * @param entry    The entry to remove
@@ -34,10 +53,21 @@ void history_remove ( const char *filename, const char *entry ) __attribute__( (
  * @param filename The filename of the history cache.
  * @param length   The length of the returned list.
  *
- * Gets the entries in the list (in order of usage)
+ * Gets the entries in the list, highest ranked first. The ranks are computed when the list is loaded.
  * @returns a list of entries length long. (and NULL terminated).
  */
 char ** history_get_list ( const char *filename, unsigned int * length ) __attribute__( ( nonnull ) );
 
+/**
+ * @param entries The entries, as returned by history_get_list().
+ * @param length  The number of entries.
+ *
+ * Index the entries, so a mode loading its list can check in constant time if an item is
+ * already listed from the history. The set holds its own copies of the entries.
+ *
+ * @returns a set of the entries, free with g_hash_table_destroy().
+ */
+GHashTable * history_index ( char * const *entries, unsigned int length );
+
 /*@}*/
 #endif // ROFI_HISTORY_H
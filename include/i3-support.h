@@ -1,5 +1,6 @@
 #ifndef ROFI_I3_H
 #define ROFI_I3_H
+#include "i3-tree.h"
 
 /**
  * @defgroup I3Support I3Support
@@ -21,6 +22,15 @@
  */
 void i3_support_focus_window ( xcb_window_t id );
 
+/**
+ * @param num Set to the number of windows.
+ *
+ * Get all windows managed by i3, with their title, class and role, from a single GET_TREE request.
+ *
+ * @returns the windows, free with i3_tree_free(), or NULL on failure or when i3 support is not compiled in.
+ */
+I3Window * i3_support_get_windows ( unsigned int *num );
+
 /**
  * @param display The display to read the i3 property from.
  *
@@ -0,0 +1,61 @@
+#ifndef ROFI_I3_TREE_H
+#define ROFI_I3_TREE_H
+
+#include <stdint.h>
+#include <glib.h>
+
+/**
+ * @defgroup I3Tree I3Tree
+ * @ingroup HELPERS
+ *
+ * Reader for the reply to the i3 GET_TREE request.
+ * The JSON is read in a single pass and no document is built: only the fields of the
+ * containers that hold a window are kept, everything else is skipped while reading.
+ *
+ * @{
+ */
+
+/**
+ * A window in the i3 layout tree.
+ */
+typedef struct
+{
+    /** The X11 window id. */
+    uint32_t window;
+    /** The title of the window, NULL if not set. */
+    char     *title;
+    /** WM_CLASS class, NULL if not set. */
+    char     *class;
+    /** WM_CLASS instance, NULL if not set. */
+    char     *instance;
+    /** WM_WINDOW_ROLE, NULL if not set. */
+    char     *role;
+    /** The window is marked urgent. */
+    gboolean urgent;
+    /** The window has the focus. */
+    gboolean focused;
+} I3Window;
+
+/**
+ * @param data The GET_TREE reply.
+ * @param length The length of data.
+ * @param num Set to the number of windows.
+ *
+ * Find all windows in the tree, in the order i3 lists them. Dock clients and
+ * desktop windows are left out.
+ * This function is thread safe.
+ *
+ * @returns the windows, free with i3_tree_free(), or NULL if the reply is not valid JSON.
+ */
+I3Window * i3_tree_parse ( const char *data, size_t length, unsigned int *num );
+
+/**
+ * @param windows The windows returned by i3_tree_parse().
+ * @param num The number of windows.
+ *
+ * Free the windows.
+ */
+void i3_tree_free ( I3Window *windows, unsigned int num );
+
+/*@}*/
+#endif // ROFI_I3_TREE_H
@@ -0,0 +1,80 @@
+#ifndef ROFI_IO_BATCH_H
+#define ROFI_IO_BATCH_H
+
+#include <sys/types.h>
+#include <time.h>
+#include <glib.h>
+
+/**
+ * @defgroup IOBatch IOBatch
+ * @ingroup HELPERS
+ *
+ * Batched file metadata and content reads.
+ * When compiled with liburing the requests are submitted through io_uring, keeping up
+ * to #IO_BATCH_DEPTH operations in flight, so scanning directories on a cold cache is bound
+ * by the device and not by the latency of each individual syscall.
+ * Without liburing, or when the kernel refuses to set up a ring, the requests are handled
+ * one by one with plain syscalls.
+ *
+ * @{
+ */
+
+/** Maximum number of operations kept in flight. */
+#define IO_BATCH_DEPTH    256
+
+/**
+ * A single file in a batch.
+ */
+typedef struct
+{
+    /** The path of the file, set by the caller. */
+    const char      *path;
+    /** 0 on success, the errno value of the failed operation otherwise. */
+    int             error;
+    /** File type and mode. */
+    mode_t          mode;
+    /** Owner of the file. */
+    uid_t           uid;
+    /** Group of the file. */
+    gid_t           gid;
+    /** Size of the file. */
+    off_t           size;
+    /** Last modification time of the file. */
+    struct timespec mtime;
+    /** The content of the file (NUL terminated), filled by io_batch_read(). Free with g_free(). */
+    char            *data;
+    /** The number of bytes in data. */
+    size_t          length;
+} IOBatchRequest;
+
+/**
+ * @param reqs The requests, path set.
+ * @param num  The number of requests.
+ *
+ * Stat all files in reqs, following symlinks. Fills in error, mode, uid, gid, size and mtime.
+ * This function is thread safe.
+ */
+void io_batch_stat ( IOBatchRequest *reqs, unsigned int num );
+
+/**
+ * @param reqs The requests, path set.
+ * @param num  The number of requests.
+ *
+ * Read the full content of all (regular) files in reqs. On success data and length are set, on
+ * failure error is set and data is NULL. The stat fields are filled in too.
+ * This function is thread safe.
+ */
+void io_batch_read ( IOBatchRequest *reqs, unsigned int num );
+
+/**
+ * @param req A request filled in by io_batch_stat() or io_batch_read().
+ *
+ * Check the mode against the credentials of the process, like access ( X_OK ) would,
+ * but without doing an extra syscall.
+ *
+ * @returns TRUE if the file is a regular file the user can execute.
+ */
+gboolean io_batch_is_executable ( const IOBatchRequest *req );
+
+/*@}*/
+#endif // ROFI_IO_BATCH_H
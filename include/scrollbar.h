@@ -18,6 +18,8 @@ typedef struct _scrollbar
     unsigned int length;
     unsigned int pos;
     unsigned int pos_length;
+    /** Changed since it was last drawn. */
+    int          update;
 } scrollbar;
 
 /**
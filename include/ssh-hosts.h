@@ -0,0 +1,63 @@
+#ifndef ROFI_SSH_HOSTS_H
+#define ROFI_SSH_HOSTS_H
+
+#include <glib.h>
+
+/**
+ * @defgroup SSHHosts SSHHosts
+ * @ingroup HELPERS
+ *
+ * Reads the ssh hosts from known_hosts, `/etc/hosts` and the ssh config, including the files it `Include`s.
+ * The hosts are cached together with the files they were read from. If none of the files changed the cache
+ * is used, if lines were only appended to known_hosts, just the new lines are parsed.
+ *
+ * @{
+ */
+
+/** known_hosts is parsed. */
+#define SSH_HOSTS_CACHE_PARSE_KNOWN_HOSTS    1
+/** /etc/hosts is parsed. */
+#define SSH_HOSTS_CACHE_PARSE_HOSTS          2
+
+/**
+ * How the hosts were found by ssh_hosts_read().
+ */
+typedef enum
+{
+    /** The cache could not be used, all files were parsed. */
+    SSH_CACHE_MISS,
+    /** Nothing changed, the hosts were taken from the cache. */
+    SSH_CACHE_HIT,
+    /** Only lines were appended to known_hosts, just those were parsed. */
+    SSH_CACHE_TAIL,
+} SSHCacheState;
+
+/**
+ * @param home The home directory, the ssh files are read from its .ssh directory.
+ * @param cache_path The cache file, it is rewritten when the hosts changed.
+ * @param flags The sources to parse, SSH_HOSTS_CACHE_PARSE_*.
+ * @param length Set to the number of hosts.
+ * @param state Set to how the hosts were found, can be NULL.
+ *
+ * Get the hosts from the ssh files, without duplicates, ignoring case.
+ * The hosts from known_hosts go in front, then those from `/etc/hosts`, then those from the ssh config.
+ *
+ * @returns the NULL terminated list of hosts, free with g_strfreev().
+ */
+char ** ssh_hosts_read ( const char *home, const char *cache_path, unsigned int flags, unsigned int *length, SSHCacheState *state );
+
+/**
+ * @param hosts The NULL terminated list of hosts, can be NULL.
+ * @param length The number of hosts, updated.
+ * @param more The hosts to append, can be NULL.
+ * @param num_more The number of hosts in more.
+ *
+ * Append the hosts that are not in the list yet, ignoring case.
+ * Both lists are absorbed, the hosts that are left out are freed.
+ *
+ * @returns the NULL terminated merged list, free with g_strfreev().
+ */
+char ** ssh_hosts_merge ( char **hosts, unsigned int *length, char **more, unsigned int num_more );
+
+/*@}*/
+#endif // ROFI_SSH_HOSTS_H
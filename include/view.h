@@ -1,6 +1,7 @@
 #ifndef ROFI_VIEW_H
 #define ROFI_VIEW_H
 
+#include <glib.h>
 #include "xkb.h"
 
 /**
@@ -86,6 +87,32 @@ void rofi_view_restart ( RofiViewState *state );
  */
 void rofi_view_update ( RofiViewState *state );
 
+/**
+ * @param state The handle to the view
+ *
+ * The mode of the view appended entries to its list. Only the new entries are checked
+ * and matched against the current filter, then a redraw is queued.
+ */
+void rofi_view_reload_appended ( RofiViewState *state );
+
+/**
+ * @param state The handle to the view
+ *
+ * The mode of the view removed or reordered entries. The number of entries is read again
+ * and all entries are matched against the current filter before the next redraw.
+ */
+void rofi_view_reload ( RofiViewState *state );
+
+/**
+ * @param state The handle to the view
+ * @param lines The entries that changed.
+ * @param num The number of entries in lines.
+ *
+ * The mode of the view changed the given entries in place. Only these entries are checked
+ * and matched against the current filter again, then a redraw is queued.
+ */
+void rofi_view_reload_lines ( RofiViewState *state, const unsigned int *lines, unsigned int num );
+
 gboolean rofi_view_trigger_action ( RofiViewState *state, KeyBindingAction action );
 
 /**
@@ -150,9 +177,53 @@ Mode * rofi_view_get_mode ( RofiViewState *state );
  *
  * @{
  */
+/**
+ * A job that is run on the thread pool.
+ */
+typedef struct _thread_state
+{
+    /** The view the job works on, can be NULL. */
+    RofiViewState *state;
+    /** Tokens to match. */
+    char          **tokens;
+    /** First element to process. */
+    unsigned int  start;
+    /** End of the range to process (exclusive). */
+    unsigned int  stop;
+    /** Number of elements the job produced. */
+    unsigned int  count;
+    /** Signalled when the job is done. */
+    GCond         *cond;
+    /** Protects acount. */
+    GMutex        *mutex;
+    /** Decremented when the job is done. */
+    unsigned int  *acount;
+    /** Job specific data. */
+    void          *priv;
+    /** The function to run. */
+    void ( *callback )( struct _thread_state *t, gpointer data );
+}thread_state;
+
 void rofi_view_workers_initialize ( void );
 void rofi_view_workers_finalize ( void );
 
+/**
+ * @param t The job to run.
+ *
+ * Queue a job on the thread pool, when done acount is decremented and cond is signalled.
+ * Without a thread pool the job is run directly.
+ */
+void rofi_view_queue_job ( thread_state *t );
+
+/**
+ * @param states The jobs to run.
+ * @param num The number of jobs.
+ *
+ * Run the jobs on the thread pool, the first one in the calling thread, and wait till all are done.
+ * The cond, mutex and acount fields are filled in.
+ */
+void rofi_view_run_jobs ( thread_state *states, unsigned int num );
+
 void __create_window ( MenuFlags menu_flags );
 /**@}*/
 #endif
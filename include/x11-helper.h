@@ -24,6 +24,16 @@
  */
 char* window_get_text_prop ( xcb_window_t w, xcb_atom_t atom );
 
+/**
+ * @param r The reply of a get property request for a text property, can be NULL.
+ *
+ * Convert the reply of a text property to UTF-8, so the request can be sent
+ * ahead of time. The reply is freed.
+ *
+ * @returns a newly allocated string with the result or NULL
+ */
+char* window_get_text_prop_reply ( xcb_get_property_reply_t *r );
+
 void window_set_atom_prop ( xcb_window_t w, xcb_atom_t prop, xcb_atom_t *atoms, int count );
 
 /**
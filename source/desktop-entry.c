@@ -0,0 +1,275 @@
+/**
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright 2013-2016 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include "desktop-entry.h"
+
+/** The group that is parsed. */
+#define DESKTOP_ENTRY_GROUP    "[Desktop Entry]"
+
+/**
+ * The best value seen so far for a key, it points into the parsed data.
+ */
+typedef struct
+{
+    const char   *value;
+    gsize        length;
+    /** Lower is a better match, G_MAXUINT if not set. */
+    unsigned int rank;
+} DesktopEntryValue;
+
+/**
+ * @param key The key to match.
+ * @param length The length of key.
+ * @param name The name of the key (without locale).
+ * @param languages The languages, best first.
+ * @param num_languages The number of languages.
+ * @param rank Set to the rank of the key: the index of the language, or the number of languages for the untranslated key.
+ *
+ * @returns TRUE if key is name, optionally with a locale in languages.
+ */
+static gboolean desktop_entry_match_key ( const char *key, gsize length, const char *name,
+                                          const char * const *languages, unsigned int num_languages, unsigned int *rank )
+{
+    gsize name_length = strlen ( name );
+    if ( length < name_length || memcmp ( key, name, name_length ) != 0 ) {
+        return FALSE;
+    }
+    if ( length == name_length ) {
+        *rank = num_languages;
+        return TRUE;
+    }
+    if ( key[name_length] != '[' || key[length - 1] != ']' ) {
+        return FALSE;
+    }
+    const char *locale       = key + name_length + 1;
+    gsize      locale_length = length - name_length - 2;
+    for ( unsigned int i = 0; i < num_languages; i++ ) {
+        if ( strlen ( languages[i] ) == locale_length && memcmp ( languages[i], locale, locale_length ) == 0 ) {
+            *rank = i;
+            return TRUE;
+        }
+    }
+    // Translation for a language we do not use.
+    return FALSE;
+}
+
+/**
+ * @param key The key.
+ * @param length The length of key.
+ * @param name The name to compare against.
+ *
+ * @returns TRUE if key is name.
+ */
+static inline gboolean desktop_entry_is_key ( const char *key, gsize length, const char *name )
+{
+    return strlen ( name ) == length && memcmp ( key, name, length ) == 0;
+}
+
+/**
+ * @param value The raw value.
+ * @param length The length of value.
+ *
+ * Parse a boolean value, like GKeyFile: true or 1.
+ *
+ * @returns the boolean value, FALSE if it is not a valid boolean.
+ */
+static gboolean desktop_entry_parse_boolean ( const char *value, gsize length )
+{
+    while ( length > 0 && g_ascii_isspace ( value[length - 1] ) ) {
+        length--;
+    }
+    return ( length == 4 && memcmp ( value, "true", 4 ) == 0 ) || ( length == 1 && value[0] == '1' );
+}
+
+/**
+ * @param value The best value for the key.
+ *
+ * Unescape the value like GKeyFile does for strings.
+ *
+ * @returns a newly allocated string, or NULL if not set or not valid UTF-8.
+ */
+static char *desktop_entry_unescape ( const DesktopEntryValue *value )
+{
+    if ( value->value == NULL ) {
+        return NULL;
+    }
+    char *retv = g_malloc ( value->length + 1 );
+    char *q    = retv;
+    for ( gsize i = 0; i < value->length; i++ ) {
+        if ( value->value[i] == '\\' && ( i + 1 ) < value->length ) {
+            i++;
+            switch ( value->value[i] )
+            {
+            case 's':
+                *q++ = ' ';
+                break;
+            case 'n':
+                *q++ = '\n';
+                break;
+            case 't':
+                *q++ = '\t';
+                break;
+            case 'r':
+                *q++ = '\r';
+                break;
+            case '\\':
+                *q++ = '\\';
+                break;
+            default:
+                // Escapes used by lists (\;), keep as is.
+                *q++ = '\\';
+                *q++ = value->value[i];
+                break;
+            }
+        }
+        else {
+            *q++ = value->value[i];
+        }
+    }
+    *q = '\0';
+    if ( !g_utf8_validate ( retv, q - retv, NULL ) ) {
+        g_free ( retv );
+        return NULL;
+    }
+    return retv;
+}
+
+gboolean desktop_entry_parse ( const char *data, gsize length, const char * const *languages, DesktopEntry *entry )
+{
+    DesktopEntryValue name          = { NULL, 0, G_MAXUINT };
+    DesktopEntryValue generic_name  = { NULL, 0, G_MAXUINT };
+    DesktopEntryValue exec          = { NULL, 0, G_MAXUINT };
+    gboolean          in_group      = FALSE;
+    gboolean          found         = FALSE;
+    gboolean          seen_group    = FALSE;
+    const char        *end          = data + length;
+    const char        *p            = data;
+    unsigned int      num_languages = 0;
+
+    while ( languages[num_languages] != NULL ) {
+        num_languages++;
+    }
+    memset ( entry, 0, sizeof ( *entry ) );
+    while ( p < end ) {
+        const char *eol = memchr ( p, '\n', end - p );
+        if ( eol == NULL ) {
+            eol = end;
+        }
+        const char *next = ( eol < end ) ? eol + 1 : end;
+        const char *s    = p;
+        const char *le   = eol;
+        p = next;
+        if ( le > s && le[-1] == '\r' ) {
+            le--;
+        }
+        while ( s < le && g_ascii_isspace ( *s ) ) {
+            s++;
+        }
+        // Empty lines and comments.
+        if ( s == le || *s == '#' ) {
+            continue;
+        }
+        if ( *s == '[' ) {
+            if ( in_group ) {
+                // Done, the rest of the file is not of interest.
+                break;
+            }
+            const char *ge = le;
+            while ( ge > s && g_ascii_isspace ( ge[-1] ) ) {
+                ge--;
+            }
+            if ( ge[-1] != ']' ) {
+                return FALSE;
+            }
+            seen_group = TRUE;
+            in_group   = ( (gsize) ( ge - s ) == strlen ( DESKTOP_ENTRY_GROUP ) && memcmp ( s, DESKTOP_ENTRY_GROUP, ge - s ) == 0 );
+            found      = found || in_group;
+            continue;
+        }
+        if ( !seen_group ) {
+            // Keys before the first group.
+            return FALSE;
+        }
+        if ( !in_group ) {
+            continue;
+        }
+        const char *eq = memchr ( s, '=', le - s );
+        if ( eq == NULL ) {
+            return FALSE;
+        }
+        const char *ke = eq;
+        while ( ke > s && g_ascii_isspace ( ke[-1] ) ) {
+            ke--;
+        }
+        const char *v = eq + 1;
+        while ( v < le && ( *v == ' ' || *v == '\t' ) ) {
+            v++;
+        }
+        gsize        klength = ke - s;
+        gsize        vlength = le - v;
+        unsigned int rank    = 0;
+        if ( desktop_entry_match_key ( s, klength, "Name", languages, num_languages, &rank ) ) {
+            if ( rank <= name.rank ) {
+                name = (DesktopEntryValue) { v, vlength, rank };
+            }
+        }
+        else if ( desktop_entry_match_key ( s, klength, "GenericName", languages, num_languages, &rank ) ) {
+            if ( rank <= generic_name.rank ) {
+                generic_name = (DesktopEntryValue) { v, vlength, rank };
+            }
+        }
+        else if ( desktop_entry_is_key ( s, klength, "Exec" ) ) {
+            exec = (DesktopEntryValue) { v, vlength, 0 };
+        }
+        else if ( desktop_entry_is_key ( s, klength, "Terminal" ) ) {
+            entry->terminal = desktop_entry_parse_boolean ( v, vlength );
+        }
+        else if ( desktop_entry_is_key ( s, klength, "Hidden" ) ) {
+            entry->hidden = desktop_entry_parse_boolean ( v, vlength );
+        }
+        else if ( desktop_entry_is_key ( s, klength, "NoDisplay" ) ) {
+            entry->no_display = desktop_entry_parse_boolean ( v, vlength );
+        }
+    }
+    if ( !found ) {
+        return FALSE;
+    }
+    entry->name         = desktop_entry_unescape ( &name );
+    entry->generic_name = desktop_entry_unescape ( &generic_name );
+    entry->exec         = desktop_entry_unescape ( &exec );
+    return TRUE;
+}
+
+void desktop_entry_clear ( DesktopEntry *entry )
+{
+    g_free ( entry->name );
+    g_free ( entry->generic_name );
+    g_free ( entry->exec );
+    memset ( entry, 0, sizeof ( *entry ) );
+}
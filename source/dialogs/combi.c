@@ -112,6 +112,10 @@ static int combi_mode_init ( Mode *sw )
             if ( !mode_init ( pd->switchers[i] ) ) {
                 return FALSE;
             }
+            // The combined list does not grow, get the complete run list now.
+            if ( pd->switchers[i] == &run_mode ) {
+                run_mode_wait_external ( pd->switchers[i] );
+            }
         }
         if ( pd->cmd_list_length == 0 ) {
             pd->cmd_list_length = 0;
@@ -34,6 +34,8 @@
 #include <ctype.h>
 #include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include "rofi.h"
 #include "settings.h"
 #include "textbox.h"
@@ -44,11 +46,51 @@
 // We limit at 1000000 rows for now.
 #define DMENU_MAX_ROWS    1000000
 
+/**
+ * Row flags used by the binary (rbin) input format.
+ */
+#define DMENU_RBIN_URGENT     1
+#define DMENU_RBIN_ACTIVE     2
+#define DMENU_RBIN_MARKUP     4
+/** Size of the header (flags, display length, match length) of one rbin record. */
+#define DMENU_RBIN_HEADER     12
+/** Size of the write buffer of the spill file. */
+#define DMENU_SPILL_BUFFER    ( 1024 * 1024 )
+/** Number of rows handed to a worker at once by -dump. */
+#define DMENU_DUMP_CHUNK      8192
+/** Size of the stdout buffer used by -dump. */
+#define DMENU_DUMP_BUFFER     ( 1024 * 1024 )
+
 struct range_pair
 {
     unsigned int start;
     unsigned int stop;
 };
+
+/**
+ * Storage for input that does not fit in the memory budget.
+ * Rows are written NUL terminated to an unlinked spill file, that is mapped read-only once all input is read.
+ */
+typedef struct
+{
+    // Spill file.
+    int     fd;
+    // Write buffer and the file offset of its first byte.
+    char    *buffer;
+    size_t  buffer_length;
+    guint64 buffer_offset;
+    // Offset of each row in the spill file (only while reading).
+    guint64 *offsets;
+    // Scratch buffer to read back rows while reading.
+    char    *scratch;
+    size_t  scratch_size;
+    // Mapping of the spill file.
+    char    *map;
+    size_t  map_size;
+    // Size of the windows that are released after filtering passed them.
+    size_t  window;
+} DmenuSpill;
+
 typedef struct
 {
     /** Settings */
@@ -71,8 +113,388 @@ typedef struct
     char              **cmd_list;
     unsigned int      cmd_list_length;
     unsigned int      only_selected;
+    // Binary input: buffer holding all rows, cmd_list and match_list point into it.
+    char              *input_buffer;
+    // Text to match against (binary input only), NULL entries match on the display text.
+    char              **match_list;
+    // Per row DMENU_RBIN_* flags (binary input only).
+    uint8_t           *row_flags;
+    // Drop duplicate rows while reading.
+    unsigned int      dedup;
+    // Index of each row in the original input (only with dedup).
+    unsigned int      *row_index;
+    // Maximum number of bytes of row data kept in memory, 0 is unlimited.
+    size_t            memory_budget;
+    // Paged storage, used once the input exceeds the memory budget.
+    DmenuSpill        *spill;
+    // Input that is streamed through -dump instead of being read up front.
+    FILE              *dump_input;
+    // Error while opening the input, shown once the input is joined.
+    char              *input_error;
 } DmenuModePrivateData;
 
+/** Thread reading the input while rofi starts up. */
+static GThread              *prefetch_thread = NULL;
+/** Private data filled in by prefetch_thread. */
+static DmenuModePrivateData *prefetch_pd = NULL;
+
+/**
+ * @param pd The dmenu private data.
+ *
+ * Create the spill file in the cache directory, it is unlinked directly so it goes away with rofi.
+ *
+ * @returns TRUE when the spill file is ready.
+ */
+static int dmenu_spill_open ( DmenuModePrivateData *pd )
+{
+    char *path = g_build_filename ( cache_dir, "rofi-dmenu-XXXXXX", NULL );
+    int  fd    = g_mkstemp ( path );
+    if ( fd < 0 ) {
+        fprintf ( stderr, "Failed to create spill file %s: %s, keeping input in memory.\n", path, strerror ( errno ) );
+        g_free ( path );
+        return FALSE;
+    }
+    unlink ( path );
+    g_free ( path );
+    pd->spill         = g_malloc0 ( sizeof ( DmenuSpill ) );
+    pd->spill->fd     = fd;
+    pd->spill->buffer = g_malloc ( DMENU_SPILL_BUFFER );
+    return TRUE;
+}
+
+/**
+ * @param spill The spill storage.
+ * @param data The data to write.
+ * @param length The number of bytes to write.
+ *
+ * Write data to the spill file, bypassing the write buffer.
+ */
+static void dmenu_spill_write ( DmenuSpill *spill, const char *data, size_t length )
+{
+    while ( length > 0 ) {
+        ssize_t r = write ( spill->fd, data, length );
+        if ( r < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            fprintf ( stderr, "Failed to write spill file: %s\n", strerror ( errno ) );
+            exit ( EXIT_FAILURE );
+        }
+        data   += r;
+        length -= r;
+    }
+}
+
+/**
+ * @param spill The spill storage.
+ *
+ * Write out the write buffer.
+ */
+static void dmenu_spill_flush ( DmenuSpill *spill )
+{
+    dmenu_spill_write ( spill, spill->buffer, spill->buffer_length );
+    spill->buffer_offset += spill->buffer_length;
+    spill->buffer_length  = 0;
+}
+
+/**
+ * @param spill The spill storage.
+ * @param row The index of the row.
+ * @param str The row.
+ *
+ * Append the row to the spill file.
+ */
+static void dmenu_spill_append ( DmenuSpill *spill, unsigned int row, const char *str )
+{
+    size_t length = strlen ( str ) + 1;
+    spill->offsets[row] = spill->buffer_offset + spill->buffer_length;
+    if ( ( spill->buffer_length + length ) > DMENU_SPILL_BUFFER ) {
+        dmenu_spill_flush ( spill );
+        if ( length > DMENU_SPILL_BUFFER ) {
+            dmenu_spill_write ( spill, str, length );
+            spill->buffer_offset += length;
+            return;
+        }
+    }
+    memcpy ( spill->buffer + spill->buffer_length, str, length );
+    spill->buffer_length += length;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param rows The rows read so far.
+ * @param length The number of rows read so far.
+ * @param row The row to get.
+ *
+ * Get a row while reading the input, rows that are already written to the spill file are read back.
+ *
+ * @returns the row, only valid until the next call.
+ */
+static const char *dmenu_ingest_row ( DmenuModePrivateData *pd, char **rows, unsigned int length, unsigned int row )
+{
+    DmenuSpill *spill = pd->spill;
+    if ( spill == NULL ) {
+        return rows[row];
+    }
+    guint64 start = spill->offsets[row];
+    guint64 end   = ( ( row + 1 ) < length ) ? spill->offsets[row + 1] : ( spill->buffer_offset + spill->buffer_length );
+    if ( start >= spill->buffer_offset ) {
+        return spill->buffer + ( start - spill->buffer_offset );
+    }
+    size_t size = end - start;
+    if ( size > spill->scratch_size ) {
+        spill->scratch_size = size;
+        spill->scratch      = g_realloc ( spill->scratch, size );
+    }
+    size_t done = 0;
+    while ( done < size ) {
+        ssize_t r = pread ( spill->fd, spill->scratch + done, size - done, start + done );
+        if ( r <= 0 ) {
+            if ( r < 0 && errno == EINTR ) {
+                continue;
+            }
+            fprintf ( stderr, "Failed to read spill file: %s\n", r < 0 ? strerror ( errno ) : "unexpected end of file" );
+            exit ( EXIT_FAILURE );
+        }
+        done += r;
+    }
+    return spill->scratch;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param rows The list of rows to fill in.
+ * @param length The number of rows.
+ *
+ * Finish reading into the spill file: map the file and point the rows into the mapping.
+ */
+static void dmenu_spill_map ( DmenuModePrivateData *pd, char **rows, unsigned int length )
+{
+    DmenuSpill *spill = pd->spill;
+    dmenu_spill_flush ( spill );
+    spill->map_size = spill->buffer_offset;
+    g_free ( spill->buffer );
+    g_free ( spill->scratch );
+    spill->buffer  = NULL;
+    spill->scratch = NULL;
+    if ( spill->map_size > 0 ) {
+        spill->map = mmap ( NULL, spill->map_size, PROT_READ, MAP_SHARED, spill->fd, 0 );
+        if ( spill->map == MAP_FAILED ) {
+            fprintf ( stderr, "Failed to map spill file: %s\n", strerror ( errno ) );
+            exit ( EXIT_FAILURE );
+        }
+        // Filtering walks the rows front to back.
+        madvise ( spill->map, spill->map_size, MADV_SEQUENTIAL );
+    }
+    for ( unsigned int i = 0; i < length; i++ ) {
+        rows[i] = spill->map + spill->offsets[i];
+    }
+    g_free ( spill->offsets );
+    spill->offsets = NULL;
+}
+
+/**
+ * @param pd The dmenu private data.
+ *
+ * Split the memory budget over the filter threads, each keeps at most two windows resident.
+ */
+static void dmenu_spill_set_window ( DmenuModePrivateData *pd )
+{
+    DmenuSpill *spill  = pd->spill;
+    long       page    = sysconf ( _SC_PAGESIZE );
+    size_t     threads = config.threads > 0 ? config.threads : g_get_num_processors ();
+    spill->window = pd->memory_budget / ( 2 * threads );
+    spill->window = MAX ( spill->window, 1024 * 1024 );
+    spill->window = ( spill->window / page ) * page;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row that was just looked at.
+ *
+ * When index is the last row in its window, drop the pages of that window so the resident
+ * part of the mapping stays within the budget. Pages are re-read from the spill file when needed again.
+ */
+static void dmenu_spill_release ( const DmenuModePrivateData *pd, unsigned int index )
+{
+    const DmenuSpill *spill = pd->spill;
+    size_t           start  = pd->cmd_list[index] - spill->map;
+    size_t           end    = ( ( index + 1 ) < pd->cmd_list_length ) ? (size_t) ( pd->cmd_list[index + 1] - spill->map ) : spill->map_size;
+    if ( ( start / spill->window ) == ( end / spill->window ) ) {
+        return;
+    }
+    long   page = sysconf ( _SC_PAGESIZE );
+    size_t from = ( start / spill->window ) * spill->window;
+    size_t to   = ( end / page ) * page;
+    if ( to > from ) {
+        madvise ( spill->map + from, to - from, MADV_DONTNEED );
+    }
+}
+
+/**
+ * @param pd The dmenu private data.
+ *
+ * Close the spill storage.
+ */
+static void dmenu_spill_free ( DmenuModePrivateData *pd )
+{
+    DmenuSpill *spill = pd->spill;
+    if ( spill->map != NULL ) {
+        munmap ( spill->map, spill->map_size );
+    }
+    close ( spill->fd );
+    g_free ( spill->offsets );
+    g_free ( spill->scratch );
+    g_free ( spill->buffer );
+    g_free ( spill );
+    pd->spill = NULL;
+}
+
+/**
+ * Slot in the deduplication hash set.
+ */
+typedef struct
+{
+    // Precomputed hash of the row.
+    uint32_t     hash;
+    // Row index + 1, 0 when the slot is empty.
+    unsigned int row;
+} DmenuDedupSlot;
+
+/**
+ * Open addressing hash set used to drop duplicate rows while reading.
+ */
+typedef struct
+{
+    DmenuDedupSlot *slots;
+    // Number of slots, always a power of two.
+    unsigned int   size;
+    unsigned int   used;
+} DmenuDedupSet;
+
+/**
+ * @param str The string to hash.
+ *
+ * @returns the FNV-1a hash of str.
+ */
+static uint32_t dmenu_dedup_hash ( const char *str )
+{
+    uint32_t hash = 2166136261u;
+    for ( const unsigned char *p = (const unsigned char *) str; *p != '\0'; p++ ) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @param set The set to grow.
+ *
+ * Double the number of slots, rehashing uses the stored hashes.
+ */
+static void dmenu_dedup_grow ( DmenuDedupSet *set )
+{
+    unsigned int   size  = set->size ? set->size * 2 : 4096;
+    DmenuDedupSlot *slots = g_malloc0 ( size * sizeof ( DmenuDedupSlot ) );
+    for ( unsigned int i = 0; i < set->size; i++ ) {
+        if ( set->slots[i].row == 0 ) {
+            continue;
+        }
+        unsigned int pos = set->slots[i].hash & ( size - 1 );
+        while ( slots[pos].row != 0 ) {
+            pos = ( pos + 1 ) & ( size - 1 );
+        }
+        slots[pos] = set->slots[i];
+    }
+    g_free ( set->slots );
+    set->slots = slots;
+    set->size  = size;
+}
+
+/**
+ * @param set The set.
+ * @param pd The dmenu private data.
+ * @param rows The rows already stored.
+ * @param str The new row.
+ * @param row The index str will get in rows.
+ *
+ * @returns TRUE when str was added, FALSE when it is a duplicate of an earlier row.
+ */
+static int dmenu_dedup_insert ( DmenuDedupSet *set, DmenuModePrivateData *pd, char **rows, const char *str, unsigned int row )
+{
+    if ( ( set->used + 1 ) * 2 > set->size ) {
+        dmenu_dedup_grow ( set );
+    }
+    uint32_t     hash = dmenu_dedup_hash ( str );
+    unsigned int pos  = hash & ( set->size - 1 );
+    while ( set->slots[pos].row != 0 ) {
+        if ( set->slots[pos].hash == hash && strcmp ( dmenu_ingest_row ( pd, rows, row, set->slots[pos].row - 1 ), str ) == 0 ) {
+            return FALSE;
+        }
+        pos = ( pos + 1 ) & ( set->size - 1 );
+    }
+    set->slots[pos].hash = hash;
+    set->slots[pos].row  = row + 1;
+    set->used++;
+    return TRUE;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row.
+ *
+ * @returns the index of the row in the original input.
+ */
+static inline unsigned int dmenu_get_row_index ( const DmenuModePrivateData *pd, unsigned int index )
+{
+    if ( pd->row_index != NULL ) {
+        return pd->row_index[index];
+    }
+    return index;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The index of the row in the original input.
+ *
+ * @returns the row showing the line of the original input, UINT32_MAX if it was dropped as duplicate.
+ */
+static unsigned int dmenu_get_row ( const DmenuModePrivateData *pd, unsigned int index )
+{
+    if ( pd->row_index == NULL || index == UINT32_MAX ) {
+        return index;
+    }
+    // The rows keep the order of the input, so the indexes are sorted.
+    unsigned int low = 0, high = pd->cmd_list_length;
+    while ( low < high ) {
+        unsigned int mid = low + ( high - low ) / 2;
+        if ( pd->row_index[mid] < index ) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    if ( low < pd->cmd_list_length && pd->row_index[low] == index ) {
+        return low;
+    }
+    return UINT32_MAX;
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param index The row.
+ *
+ * @returns the text the filter should match on for row index.
+ */
+static inline const char *dmenu_get_match_text ( const DmenuModePrivateData *pd, unsigned int index )
+{
+    if ( pd->match_list != NULL && pd->match_list[index] != NULL ) {
+        return pd->match_list[index];
+    }
+    return pd->cmd_list[index];
+}
+
 static char **get_dmenu ( DmenuModePrivateData *pd, FILE *fd, unsigned int *length )
 {
     TICK_N ( "Read stdin START" );
@@ -80,27 +502,75 @@ static char **get_dmenu ( DmenuModePrivateData *pd, FILE *fd, unsigned int *leng
     unsigned int rvlength = 1;
 
     *length = 0;
-    gchar   *data  = NULL;
-    size_t  data_l = 0;
-    ssize_t l      = 0;
+    gchar         *data  = NULL;
+    size_t        data_l = 0;
+    ssize_t       l      = 0;
+    unsigned int  line   = 0;
+    size_t        bytes  = 0;
+    DmenuDedupSet set    = { NULL, 0, 0 };
     while ( ( l = getdelim ( &data, &data_l, pd->separator, fd ) ) > 0 ) {
         if ( rvlength < ( *length + 2 ) ) {
             rvlength *= 2;
             retv      = g_realloc ( retv, ( rvlength ) * sizeof ( char* ) );
+            if ( pd->dedup ) {
+                pd->row_index = g_realloc ( pd->row_index, ( rvlength ) * sizeof ( unsigned int ) );
+            }
+            if ( pd->spill != NULL ) {
+                pd->spill->offsets = g_realloc ( pd->spill->offsets, ( rvlength ) * sizeof ( guint64 ) );
+            }
         }
         if ( data[l - 1] == pd->separator ) {
             data[l - 1] = '\0';
             l--;
         }
+        char *orig = data;
         data = rofi_force_utf8 ( data );
+        line++;
 
-        retv[( *length )] = data;
-        data              = NULL;
-        data_l            = 0;
+        if ( pd->dedup ) {
+            if ( !dmenu_dedup_insert ( &set, pd, retv, data, *length ) ) {
+                // Keep the buffer for getdelim, unless it got replaced while fixing up the UTF-8.
+                if ( data != orig ) {
+                    g_free ( data );
+                    data   = NULL;
+                    data_l = 0;
+                }
+                continue;
+            }
+            pd->row_index[( *length )] = line - 1;
+        }
+        bytes += l + 1;
+        if ( pd->spill == NULL && pd->memory_budget > 0 && bytes > pd->memory_budget && dmenu_spill_open ( pd ) ) {
+            // Over budget, move the rows read so far out of memory.
+            TICK_N ( "Read stdin spill" );
+            pd->spill->offsets = g_malloc ( rvlength * sizeof ( guint64 ) );
+            for ( unsigned int i = 0; i < *length; i++ ) {
+                dmenu_spill_append ( pd->spill, i, retv[i] );
+                free ( retv[i] );
+                retv[i] = NULL;
+            }
+        }
+        if ( pd->spill != NULL ) {
+            dmenu_spill_append ( pd->spill, *length, data );
+            // Re-use the buffer for the next line.
+            if ( data != orig ) {
+                g_free ( data );
+                data   = NULL;
+                data_l = 0;
+            }
+        }
+        else {
+            retv[( *length )] = data;
+            data              = NULL;
+            data_l            = 0;
+        }
 
         ( *length )++;
-        // Stop when we hit 2³¹ entries.
+        // Stop when we hit the row limit.
         if ( ( *length ) >= DMENU_MAX_ROWS ) {
+            if ( fgetc ( fd ) != EOF ) {
+                fprintf ( stderr, "Input has more than %d rows, ignoring the remaining input.\n", DMENU_MAX_ROWS );
+            }
             break;
         }
     }
@@ -112,6 +582,114 @@ static char **get_dmenu ( DmenuModePrivateData *pd, FILE *fd, unsigned int *leng
         retv               = g_realloc ( retv, ( *length + 1 ) * sizeof ( char* ) );
         retv[( *length ) ] = NULL;
     }
+    g_free ( set.slots );
+    if ( pd->spill != NULL ) {
+        dmenu_spill_map ( pd, retv, *length );
+    }
+    TICK_N ( "Read stdin STOP" );
+    return retv;
+}
+
+/**
+ * @param data Pointer to 4 bytes of data.
+ *
+ * @returns the little endian 32 bit value stored at data.
+ */
+static inline uint32_t dmenu_rbin_read_u32 ( const uint8_t *data )
+{
+    return ( (uint32_t) data[0] ) | ( (uint32_t) data[1] << 8 ) | ( (uint32_t) data[2] << 16 ) | ( (uint32_t) data[3] << 24 );
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param fd The file to read from.
+ * @param length Set to the number of rows read.
+ *
+ * Read the binary (rbin) input format. The input is a sequence of records:
+ *   * uint32 flags (little endian, DMENU_RBIN_*)
+ *   * uint32 length of the display text, including its terminating NUL.
+ *   * uint32 length of the match text, including its terminating NUL, 0 to match on the display text.
+ *   * The display text followed by the match text.
+ *
+ * The complete input is kept in one buffer and the rows point into it, no delimiter scanning or
+ * UTF-8 repair is done. The producer has to make sure the strings are valid UTF-8.
+ *
+ * @returns the list of display strings.
+ */
+static char **get_dmenu_rbin ( DmenuModePrivateData *pd, FILE *fd, unsigned int *length )
+{
+    TICK_N ( "Read stdin START" );
+    size_t size = 0;
+    size_t alloc = 65536;
+    char   *buffer = g_malloc ( alloc );
+    size_t r;
+    while ( ( r = fread ( buffer + size, 1, alloc - size, fd ) ) > 0 ) {
+        size += r;
+        if ( size == alloc ) {
+            alloc *= 2;
+            buffer = g_realloc ( buffer, alloc );
+        }
+    }
+    TICK_N ( "Read stdin binary" );
+
+    // Count the records, so we can size the lists in one go.
+    unsigned int rows = 0;
+    size_t       offset = 0;
+    while ( ( size - offset ) >= DMENU_RBIN_HEADER && rows < DMENU_MAX_ROWS ) {
+        const uint8_t *header = (const uint8_t *) ( buffer + offset );
+        uint64_t      dlen    = dmenu_rbin_read_u32 ( header + 4 );
+        uint64_t      mlen    = dmenu_rbin_read_u32 ( header + 8 );
+        if ( dlen == 0 || ( size - offset - DMENU_RBIN_HEADER ) < ( dlen + mlen ) ) {
+            break;
+        }
+        offset += DMENU_RBIN_HEADER + dlen + mlen;
+        rows++;
+    }
+    if ( offset != size ) {
+        if ( rows >= DMENU_MAX_ROWS ) {
+            fprintf ( stderr, "Input has more than %d rows, ignoring the remaining input.\n", DMENU_MAX_ROWS );
+        }
+        else {
+            fprintf ( stderr, "Invalid or truncated binary input record at offset %zu, ignoring the remaining input.\n", offset );
+        }
+    }
+
+    char          **retv = g_malloc ( ( rows + 1 ) * sizeof ( char* ) );
+    DmenuDedupSet set    = { NULL, 0, 0 };
+    pd->match_list = g_malloc0 ( ( rows + 1 ) * sizeof ( char* ) );
+    pd->row_flags  = g_malloc0 ( rows * sizeof ( uint8_t ) );
+    if ( pd->dedup ) {
+        pd->row_index = g_malloc ( rows * sizeof ( unsigned int ) );
+    }
+    *length = 0;
+    offset  = 0;
+    for ( unsigned int i = 0; i < rows; i++ ) {
+        const uint8_t *header = (const uint8_t *) ( buffer + offset );
+        uint32_t      flags   = dmenu_rbin_read_u32 ( header );
+        uint32_t      dlen    = dmenu_rbin_read_u32 ( header + 4 );
+        uint32_t      mlen    = dmenu_rbin_read_u32 ( header + 8 );
+        char          *dstr   = buffer + offset + DMENU_RBIN_HEADER;
+        char          *mstr   = dstr + dlen;
+        offset += DMENU_RBIN_HEADER + dlen + mlen;
+        // Strings have to be NUL terminated, skip the row otherwise.
+        if ( dstr[dlen - 1] != '\0' || ( mlen > 0 && mstr[mlen - 1] != '\0' ) ) {
+            fprintf ( stderr, "Binary input record %u is not NUL terminated, skipping.\n", i );
+            continue;
+        }
+        if ( pd->dedup ) {
+            if ( !dmenu_dedup_insert ( &set, pd, retv, dstr, *length ) ) {
+                continue;
+            }
+            pd->row_index[*length] = i;
+        }
+        retv[*length]           = dstr;
+        pd->match_list[*length] = ( mlen > 0 ) ? mstr : NULL;
+        pd->row_flags[*length]  = (uint8_t) flags;
+        ( *length )++;
+    }
+    retv[*length]    = NULL;
+    pd->input_buffer = buffer;
+    g_free ( set.slots );
     TICK_N ( "Read stdin STOP" );
     return retv;
 }
@@ -159,11 +737,13 @@ static void parse_ranges ( char *input, struct range_pair **list, unsigned int *
     }
 }
 
-static char *get_display_data ( const Mode *data, unsigned int index, int *state, int get_entry )
+static char *get_display_data ( const Mode *data, unsigned int row, int *state, int get_entry )
 {
     Mode                 *sw    = (Mode *) data;
     DmenuModePrivateData *pd    = (DmenuModePrivateData *) mode_get_private_data ( sw );
     char                 **retv = (char * *) pd->cmd_list;
+    // Ranges refer to the rows of the original input.
+    unsigned int         index = dmenu_get_row_index ( pd, row );
     for ( unsigned int i = 0; i < pd->num_active_list; i++ ) {
         if ( index >= pd->active_list[i].start && index <= pd->active_list[i].stop ) {
             *state |= ACTIVE;
@@ -182,16 +762,29 @@ static char *get_display_data ( const Mode *data, unsigned int index, int *state
     if ( pd->do_markup ) {
         *state |= MARKUP;
     }
-    return get_entry ? g_strdup ( retv[index] ) : NULL;
+    if ( pd->row_flags != NULL ) {
+        uint8_t flags = pd->row_flags[row];
+        if ( flags & DMENU_RBIN_URGENT ) {
+            *state |= URGENT;
+        }
+        if ( flags & DMENU_RBIN_ACTIVE ) {
+            *state |= ACTIVE;
+        }
+        if ( flags & DMENU_RBIN_MARKUP ) {
+            *state |= MARKUP;
+        }
+    }
+    return get_entry ? g_strdup ( retv[row] ) : NULL;
 }
 
 /**
+ * @param out The string to append the formatted line to.
  * @param format The format string used. See below for possible syntax.
  * @param string The selected entry.
  * @param selected_line The selected line index.
  * @param filter The entered filter.
  *
- * Function that outputs the selected line in the user-specified format.
+ * Function that formats the selected line in the user-specified format.
  * Currently the following formats are supported:
  *   * i: Print the index (0-(N-1))
  *   * d: Print the index (1-N)
@@ -200,41 +793,60 @@ static char *get_display_data ( const Mode *data, unsigned int index, int *state
  *   * f: Print the entered filter.
  *   * F: Print the entered filter, quoted
  *
- * This functions outputs the formatted string to stdout, appends a newline (\n) character and
- * calls flush on the file descriptor.
+ * A newline (\n) character is appended.
  */
-static void dmenu_output_formatted_line ( const char *format, const char *string, int selected_line,
-                                          const char *filter )
+static void dmenu_format_line ( GString *out, const char *format, const char *string, int selected_line,
+                                const char *filter )
 {
     for ( int i = 0; format && format[i]; i++ ) {
         if ( format[i] == 'i' ) {
-            fprintf ( stdout, "%d", selected_line );
+            g_string_append_printf ( out, "%d", selected_line );
         }
         else if ( format[i] == 'd' ) {
-            fprintf ( stdout, "%d", ( selected_line + 1 ) );
+            g_string_append_printf ( out, "%d", ( selected_line + 1 ) );
         }
         else if ( format[i] == 's' ) {
-            fputs ( string, stdout );
+            g_string_append ( out, string );
         }
         else if ( format[i] == 'q' ) {
             char *quote = g_shell_quote ( string );
-            fputs ( quote, stdout );
+            g_string_append ( out, quote );
             g_free ( quote );
         }
         else if ( format[i] == 'f' ) {
-            fputs ( filter, stdout );
+            if ( filter != NULL ) {
+                g_string_append ( out, filter );
+            }
         }
         else if ( format[i] == 'F' ) {
-            char *quote = g_shell_quote ( filter );
-            fputs ( quote, stdout );
+            char *quote = g_shell_quote ( filter != NULL ? filter : "" );
+            g_string_append ( out, quote );
             g_free ( quote );
         }
         else {
-            fputc ( format[i], stdout );
+            g_string_append_c ( out, format[i] );
         }
     }
-    fputc ( '\n', stdout );
+    g_string_append_c ( out, '\n' );
+}
+
+/**
+ * @param format The format string used. See dmenu_format_line for possible syntax.
+ * @param string The selected entry.
+ * @param selected_line The selected line index.
+ * @param filter The entered filter.
+ *
+ * Function that outputs the selected line in the user-specified format to stdout and
+ * calls flush on the file descriptor.
+ */
+static void dmenu_output_formatted_line ( const char *format, const char *string, int selected_line,
+                                          const char *filter )
+{
+    GString *out = g_string_sized_new ( 128 );
+    dmenu_format_line ( out, format, string, selected_line, filter );
+    fwrite ( out->str, 1, out->len, stdout );
     fflush ( stdout );
+    g_string_free ( out, TRUE );
 }
 static void dmenu_mode_free ( Mode *sw )
 {
@@ -243,12 +855,23 @@ static void dmenu_mode_free ( Mode *sw )
     }
     DmenuModePrivateData *pd = (DmenuModePrivateData *) mode_get_private_data ( sw );
     if ( pd != NULL ) {
-        for ( size_t i = 0; i < pd->cmd_list_length; i++ ) {
-            if ( pd->cmd_list[i] ) {
-                free ( pd->cmd_list[i] );
+        // Rows from the binary input live in the input buffer, paged rows in the spill file.
+        if ( pd->input_buffer == NULL && pd->spill == NULL ) {
+            for ( size_t i = 0; i < pd->cmd_list_length; i++ ) {
+                if ( pd->cmd_list[i] ) {
+                    free ( pd->cmd_list[i] );
+                }
             }
         }
         g_free ( pd->cmd_list );
+        g_free ( pd->match_list );
+        g_free ( pd->row_flags );
+        g_free ( pd->row_index );
+        g_free ( pd->input_buffer );
+        g_free ( pd->input_error );
+        if ( pd->spill != NULL ) {
+            dmenu_spill_free ( pd );
+        }
         g_free ( pd->urgent_list );
         g_free ( pd->active_list );
         g_free ( pd->selected_list );
@@ -258,26 +881,117 @@ static void dmenu_mode_free ( Mode *sw )
     }
 }
 
+/**
+ * @param pd The dmenu private data.
+ *
+ * Read the input. This can run on a separate thread (see dmenu_prefetch_start), so it only
+ * looks at the command-line and does not touch the configuration or the view.
+ */
+static void dmenu_read_input ( DmenuModePrivateData *pd )
+{
+    pd->separator = '\n';
+    // Input data separator.
+    find_arg_char ( "-sep", &( pd->separator ) );
+
+    int  binary = FALSE;
+    char *str   = NULL;
+    if ( find_arg_str ( "-input-format", &str ) ) {
+        if ( g_strcmp0 ( str, "rbin" ) == 0 ) {
+            binary = TRUE;
+        }
+        else if ( g_strcmp0 ( str, "text" ) != 0 ) {
+            fprintf ( stderr, "Unknown input format: %s, using text.\n", str );
+        }
+    }
+    pd->dedup = ( find_arg ( "-dedup" ) >= 0 );
+    unsigned int budget = 0;
+    if ( find_arg_uint ( "-memory-budget", &budget ) ) {
+        pd->memory_budget = ( (size_t) budget ) * 1024 * 1024;
+    }
+    FILE *fd = NULL;
+    str = NULL;
+    if ( find_arg_str ( "-input", &str ) ) {
+        char *estr = rofi_expand_path ( str );
+        fd = fopen ( estr, "r" );
+        if ( fd == NULL ) {
+            pd->input_error = g_markup_printf_escaped ( "Failed to open file: <b>%s</b>:\n\t<i>%s</i>", estr, strerror ( errno ) );
+            g_free ( estr );
+            return;
+        }
+        g_free ( estr );
+    }
+    if ( !binary && !pd->dedup && pd->memory_budget == 0 && find_arg ( "-dump" ) >= 0 ) {
+        // -dump reads the input while filtering.
+        pd->dump_input = ( fd == NULL ) ? stdin : fd;
+        return;
+    }
+    if ( binary && pd->memory_budget > 0 ) {
+        fprintf ( stderr, "-memory-budget is not supported with binary input, the input is kept in memory.\n" );
+        pd->memory_budget = 0;
+    }
+    if ( binary ) {
+        pd->cmd_list = get_dmenu_rbin ( pd, fd == NULL ? stdin : fd, &( pd->cmd_list_length ) );
+    }
+    else {
+        pd->cmd_list = get_dmenu ( pd, fd == NULL ? stdin : fd, &( pd->cmd_list_length ) );
+    }
+    if ( fd != NULL ) {
+        fclose ( fd );
+    }
+}
+
+/**
+ * @param data The private data to fill in.
+ *
+ * Thread function for the input prefetch.
+ *
+ * @returns NULL
+ */
+static gpointer dmenu_prefetch_thread ( gpointer data )
+{
+    dmenu_read_input ( (DmenuModePrivateData *) data );
+    return NULL;
+}
+
+void dmenu_prefetch_start ( void )
+{
+    if ( prefetch_thread != NULL ) {
+        return;
+    }
+    prefetch_pd     = g_malloc0 ( sizeof ( DmenuModePrivateData ) );
+    prefetch_thread = g_thread_new ( "dmenu-input", dmenu_prefetch_thread, prefetch_pd );
+}
+
 static int dmenu_mode_init ( Mode *sw )
 {
     if ( mode_get_private_data ( sw ) != NULL ) {
         return TRUE;
     }
-    mode_set_private_data ( sw, g_malloc0 ( sizeof ( DmenuModePrivateData ) ) );
-    DmenuModePrivateData *pd = (DmenuModePrivateData *) mode_get_private_data ( sw );
+    DmenuModePrivateData *pd = NULL;
+    if ( prefetch_thread != NULL ) {
+        // Input was read while starting up, wait for it to finish.
+        g_thread_join ( prefetch_thread );
+        TICK_N ( "Joined input prefetch" );
+        pd              = prefetch_pd;
+        prefetch_thread = NULL;
+        prefetch_pd     = NULL;
+    }
+    else {
+        pd = g_malloc0 ( sizeof ( DmenuModePrivateData ) );
+        dmenu_read_input ( pd );
+    }
+    mode_set_private_data ( sw, pd );
 
     pd->prompt        = "dmenu ";
-    pd->separator     = '\n';
     pd->selected_line = UINT32_MAX;
 
     find_arg_str ( "-mesg", &( pd->message ) );
 
-    // Input data separator.
-    find_arg_char ( "-sep", &( pd->separator ) );
-
     // Check prompt
     find_arg_str (  "-p", &( pd->prompt ) );
     find_arg_uint (  "-selected-row", &( pd->selected_line ) );
+    // Like the ranges, the row refers to the original input.
+    pd->selected_line = dmenu_get_row ( pd, pd->selected_line );
     // By default we print the unescaped line back.
     pd->format = "s";
 
@@ -311,37 +1025,36 @@ static int dmenu_mode_init ( Mode *sw )
     if ( find_arg ( "-i" ) >= 0 ) {
         config.case_sensitive = FALSE;
     }
-    FILE *fd = NULL;
-    str = NULL;
-    if ( find_arg_str ( "-input", &str ) ) {
-        char *estr = rofi_expand_path ( str );
-        fd = fopen ( str, "r" );
-        if ( fd == NULL ) {
-            char *msg = g_markup_printf_escaped ( "Failed to open file: <b>%s</b>:\n\t<i>%s</i>", estr, strerror ( errno ) );
-            rofi_view_error_dialog ( msg, TRUE );
-            g_free ( msg );
-            g_free ( estr );
-            return TRUE;
-        }
-        g_free ( estr );
+    if ( pd->input_error != NULL ) {
+        rofi_view_error_dialog ( pd->input_error, TRUE );
+        g_free ( pd->input_error );
+        pd->input_error = NULL;
+        return TRUE;
     }
-    pd->cmd_list = get_dmenu ( pd, fd == NULL ? stdin : fd, &( pd->cmd_list_length ) );
-    if ( fd != NULL ) {
-        fclose ( fd );
+    if ( pd->spill != NULL ) {
+        dmenu_spill_set_window ( pd );
     }
     return TRUE;
 }
 
 static int dmenu_token_match ( const Mode *sw, char **tokens, int not_ascii, int case_sensitive, unsigned int index )
 {
-    DmenuModePrivateData *rmpd = (DmenuModePrivateData *) mode_get_private_data ( sw );
-    return token_match ( tokens, rmpd->cmd_list[index], not_ascii, case_sensitive );
+    DmenuModePrivateData *rmpd  = (DmenuModePrivateData *) mode_get_private_data ( sw );
+    int                  match = token_match ( tokens, dmenu_get_match_text ( rmpd, index ), not_ascii, case_sensitive );
+    if ( rmpd->spill != NULL ) {
+        dmenu_spill_release ( rmpd, index );
+    }
+    return match;
 }
 
 static int dmenu_is_not_ascii ( const Mode *sw, unsigned int index )
 {
-    DmenuModePrivateData *rmpd = (DmenuModePrivateData *) mode_get_private_data ( sw );
-    return !g_str_is_ascii ( rmpd->cmd_list[index] );
+    DmenuModePrivateData *rmpd      = (DmenuModePrivateData *) mode_get_private_data ( sw );
+    int                  not_ascii = !g_str_is_ascii ( dmenu_get_match_text ( rmpd, index ) );
+    if ( rmpd->spill != NULL ) {
+        dmenu_spill_release ( rmpd, index );
+    }
+    return not_ascii;
 }
 
 #include "mode-private.h"
@@ -403,7 +1116,7 @@ static void dmenu_finalize ( RofiViewState *state )
         }
         else if ( pd->selected_line != UINT32_MAX ) {
             if ( ( mretv & ( MENU_OK | MENU_QUICK_SWITCH ) ) && cmd_list[pd->selected_line] != NULL ) {
-                dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], pd->selected_line, input );
+                dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], dmenu_get_row_index ( pd, pd->selected_line ), input );
                 retv = TRUE;
                 if ( ( mretv & MENU_QUICK_SWITCH ) ) {
                     retv = 10 + ( mretv & MENU_LOWER_MASK );
@@ -426,21 +1139,23 @@ static void dmenu_finalize ( RofiViewState *state )
     restart = FALSE;
     // Normal mode
     if ( ( mretv & MENU_OK  ) && pd->selected_line != UINT32_MAX && cmd_list[pd->selected_line] != NULL ) {
-        dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], pd->selected_line, input );
+        dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], dmenu_get_row_index ( pd, pd->selected_line ), input );
         if ( ( mretv & MENU_CUSTOM_ACTION ) ) {
             restart = TRUE;
-            int seen = FALSE;
+            int          seen  = FALSE;
+            // The selected ranges are compared against the original input, like -a and -u.
+            unsigned int index = dmenu_get_row_index ( pd, pd->selected_line );
             if ( pd->selected_list != NULL ) {
-                if ( pd->selected_list[pd->num_selected_list - 1].stop == ( pd->selected_line - 1 ) ) {
-                    pd->selected_list[pd->num_selected_list - 1].stop = pd->selected_line;
+                if ( pd->selected_list[pd->num_selected_list - 1].stop == ( index - 1 ) ) {
+                    pd->selected_list[pd->num_selected_list - 1].stop = index;
                     seen                                              = TRUE;
                 }
             }
             if ( !seen ) {
                 pd->selected_list = g_realloc ( pd->selected_list,
                                                 ( pd->num_selected_list + 1 ) * sizeof ( struct range_pair ) );
-                pd->selected_list[pd->num_selected_list].start = pd->selected_line;
-                pd->selected_list[pd->num_selected_list].stop  = pd->selected_line;
+                pd->selected_list[pd->num_selected_list].start = index;
+                pd->selected_list[pd->num_selected_list].stop  = index;
                 ( pd->num_selected_list )++;
             }
 
@@ -462,7 +1177,7 @@ static void dmenu_finalize ( RofiViewState *state )
     }
     // Quick switch with entry selected.
     else if ( ( mretv & MENU_QUICK_SWITCH ) && pd->selected_line < UINT32_MAX ) {
-        dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], pd->selected_line, input );
+        dmenu_output_formatted_line ( pd->format, cmd_list[pd->selected_line], dmenu_get_row_index ( pd, pd->selected_line ), input );
 
         restart = FALSE;
         retv    = 10 + ( mretv & MENU_LOWER_MASK );
@@ -484,6 +1199,170 @@ static void dmenu_finalize ( RofiViewState *state )
     }
 }
 
+/**
+ * A block of rows that is filtered by one job of -dump.
+ */
+typedef struct
+{
+    thread_state         job;
+    DmenuModePrivateData *pd;
+    // Rows read from the input, NULL when filtering the already read cmd_list.
+    char                 **lines;
+    unsigned int         length;
+    // Index of the first row in the input.
+    unsigned int         first;
+    // The formatted matching rows.
+    GString              *output;
+    // 1 while the job is queued or running.
+    unsigned int         pending;
+} DmenuDumpChunk;
+
+/**
+ * @param t The job.
+ * @param user_data Unused.
+ *
+ * Filter the rows of a chunk and format the matches into the chunk output.
+ */
+static void dmenu_dump_chunk ( thread_state *t, G_GNUC_UNUSED gpointer user_data )
+{
+    DmenuDumpChunk       *c  = (DmenuDumpChunk *) t->priv;
+    DmenuModePrivateData *pd = c->pd;
+    for ( unsigned int i = 0; i < c->length; i++ ) {
+        if ( c->lines != NULL ) {
+            const char *text = c->lines[i];
+            if ( token_match ( t->tokens, text, !g_str_is_ascii ( text ), config.case_sensitive ) ) {
+                dmenu_format_line ( c->output, pd->format, text, c->first + i, config.filter );
+            }
+        }
+        else {
+            unsigned int row = c->first + i;
+            int          not_ascii = dmenu_is_not_ascii ( &dmenu_mode, row );
+            if ( dmenu_token_match ( &dmenu_mode, t->tokens, not_ascii, config.case_sensitive, row ) ) {
+                dmenu_format_line ( c->output, pd->format, pd->cmd_list[row], dmenu_get_row_index ( pd, row ), config.filter );
+            }
+        }
+    }
+}
+
+/**
+ * @param pd The dmenu private data.
+ * @param c The chunk to fill.
+ * @param row The index of the next row, updated.
+ *
+ * Get the next block of rows, from the input stream or the already read list.
+ *
+ * @returns TRUE when the chunk holds rows.
+ */
+static int dmenu_dump_fill ( DmenuModePrivateData *pd, DmenuDumpChunk *c, unsigned int *row )
+{
+    c->first  = *row;
+    c->length = 0;
+    if ( pd->dump_input == NULL ) {
+        c->length = MIN ( DMENU_DUMP_CHUNK, pd->cmd_list_length - *row );
+    }
+    else {
+        if ( c->lines == NULL ) {
+            c->lines = g_malloc ( DMENU_DUMP_CHUNK * sizeof ( char* ) );
+        }
+        char    *data  = NULL;
+        size_t  data_l = 0;
+        ssize_t l      = 0;
+        while ( c->length < DMENU_DUMP_CHUNK && ( l = getdelim ( &data, &data_l, pd->separator, pd->dump_input ) ) > 0 ) {
+            if ( data[l - 1] == pd->separator ) {
+                data[l - 1] = '\0';
+            }
+            c->lines[c->length++] = rofi_force_utf8 ( data );
+            data                  = NULL;
+            data_l                = 0;
+        }
+        free ( data );
+    }
+    *row += c->length;
+    return c->length > 0;
+}
+
+/**
+ * @param pd The dmenu private data.
+ *
+ * Filter the input with the -filter string and print the matches.
+ * Reading, filtering and writing overlap: the input is cut in chunks that are filtered
+ * on the thread pool, while the next chunks are read and finished chunks are written in order.
+ */
+static void dmenu_dump ( DmenuModePrivateData *pd )
+{
+    TICK_N ( "Dump start" );
+    char           **tokens   = tokenize ( config.filter ? config.filter : "", config.case_sensitive );
+    unsigned int   max_chunks = 2 * MAX ( 1, config.threads ) + 1;
+    DmenuDumpChunk *chunks    = g_malloc0_n ( max_chunks, sizeof ( DmenuDumpChunk ) );
+    unsigned int   head       = 0;
+    unsigned int   used       = 0;
+    unsigned int   row        = 0;
+    int            eof        = FALSE;
+    GCond          cond;
+    GMutex         mutex;
+    g_mutex_init ( &mutex );
+    g_cond_init ( &cond );
+
+    setvbuf ( stdout, NULL, _IOFBF, DMENU_DUMP_BUFFER );
+    for ( unsigned int i = 0; i < max_chunks; i++ ) {
+        chunks[i].pd              = pd;
+        chunks[i].output          = g_string_sized_new ( 4096 );
+        chunks[i].job.priv        = &chunks[i];
+        chunks[i].job.tokens      = tokens;
+        chunks[i].job.cond        = &cond;
+        chunks[i].job.mutex       = &mutex;
+        chunks[i].job.acount      = &( chunks[i].pending );
+        chunks[i].job.callback    = dmenu_dump_chunk;
+    }
+    while ( TRUE ) {
+        // Keep the workers busy.
+        while ( !eof && used < max_chunks ) {
+            DmenuDumpChunk *c = &chunks[( head + used ) % max_chunks];
+            if ( !dmenu_dump_fill ( pd, c, &row ) ) {
+                eof = TRUE;
+                break;
+            }
+            c->pending = 1;
+            rofi_view_queue_job ( &( c->job ) );
+            used++;
+        }
+        if ( used == 0 ) {
+            break;
+        }
+        // Write out the oldest chunk, so the output keeps the input order.
+        DmenuDumpChunk *c = &chunks[head];
+        g_mutex_lock ( &mutex );
+        while ( c->pending > 0 ) {
+            g_cond_wait ( &cond, &mutex );
+        }
+        g_mutex_unlock ( &mutex );
+        fwrite ( c->output->str, 1, c->output->len, stdout );
+        g_string_truncate ( c->output, 0 );
+        if ( c->lines != NULL ) {
+            for ( unsigned int i = 0; i < c->length; i++ ) {
+                free ( c->lines[i] );
+            }
+        }
+        head = ( head + 1 ) % max_chunks;
+        used--;
+    }
+    fflush ( stdout );
+
+    for ( unsigned int i = 0; i < max_chunks; i++ ) {
+        g_string_free ( chunks[i].output, TRUE );
+        g_free ( chunks[i].lines );
+    }
+    g_free ( chunks );
+    g_cond_clear ( &cond );
+    g_mutex_clear ( &mutex );
+    g_strfreev ( tokens );
+    if ( pd->dump_input != NULL && pd->dump_input != stdin ) {
+        fclose ( pd->dump_input );
+    }
+    pd->dump_input = NULL;
+    TICK_N ( "Dump stop" );
+}
+
 int dmenu_switcher_dialog ( void )
 {
     mode_init ( &dmenu_mode );
@@ -493,6 +1372,10 @@ int dmenu_switcher_dialog ( void )
     unsigned int         cmd_list_length = pd->cmd_list_length;
     char                 **cmd_list      = pd->cmd_list;
 
+    if ( find_arg ( "-dump" ) >= 0 ) {
+        dmenu_dump ( pd );
+        return TRUE;
+    }
     pd->only_selected = FALSE;
     if ( find_arg ( "-markup-rows" ) >= 0 ) {
         pd->do_markup = TRUE;
@@ -519,24 +1402,14 @@ int dmenu_switcher_dialog ( void )
         char         **tokens = tokenize ( select, config.case_sensitive );
         unsigned int i        = 0;
         for ( i = 0; i < cmd_list_length; i++ ) {
-            if ( token_match ( tokens, cmd_list[i], !g_str_is_ascii ( cmd_list[i] ), config.case_sensitive ) ) {
+            const char *text = dmenu_get_match_text ( pd, i );
+            if ( token_match ( tokens, text, !g_str_is_ascii ( text ), config.case_sensitive ) ) {
                 pd->selected_line = i;
                 break;
             }
         }
         g_strfreev ( tokens );
     }
-    if ( find_arg ( "-dump" ) >= 0 ) {
-        char         **tokens = tokenize ( config.filter ? config.filter : "", config.case_sensitive );
-        unsigned int i        = 0;
-        for ( i = 0; i < cmd_list_length; i++ ) {
-            if ( token_match ( tokens, cmd_list[i], !g_str_is_ascii ( cmd_list[i] ), config.case_sensitive ) ) {
-                dmenu_output_formatted_line ( pd->format, cmd_list[i], i, config.filter );
-            }
-        }
-        g_strfreev ( tokens );
-        return TRUE;
-    }
     // TODO remove
     RofiViewState *state = rofi_view_create ( &dmenu_mode, input, pd->prompt, pd->message, menu_flags, dmenu_finalize );
     rofi_view_set_selected_line ( state, pd->selected_line );
@@ -562,4 +1435,7 @@ void print_dmenu_options ( void )
     print_help_msg ( "-password", "", "Do not show what the user inputs. Show '*' instead.", NULL, is_term );
     print_help_msg ( "-markup-rows", "", "Allow and render pango markup as input data.", NULL, is_term );
     print_help_msg ( "-sep", "[char]", "Element separator.", "'\\n'", is_term );
+    print_help_msg ( "-dedup", "", "Drop duplicate rows from the input.", NULL, is_term );
+    print_help_msg ( "-memory-budget", "[integer]", "Keep at most this many MB of input in memory, page the rest from disk.", NULL, is_term );
+    print_help_msg ( "-input-format", "[text|rbin]", "Format of the input data.", "text", is_term );
 }
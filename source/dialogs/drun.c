@@ -36,15 +36,22 @@
 #include <strings.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "rofi.h"
 #include "settings.h"
 #include "helper.h"
 #include "textbox.h"
 #include "history.h"
+#include "io-batch.h"
+#include "desktop-entry.h"
 #include "dialogs/drun.h"
 
 #define DRUN_CACHE_FILE    "rofi.druncache"
+#define DRUN_INDEX_FILE    "rofi.drunindex"
 
 static inline int execsh ( const char *cmd, int run_in_term )
 {
@@ -58,7 +65,7 @@ static inline int execsh ( const char *cmd, int run_in_term )
         helper_parse_setup ( config.run_command, &args, &argc, "{cmd}", cmd, NULL );
     }
     GError *error = NULL;
-    g_spawn_async ( NULL, args, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error );
+    helper_spawn ( args, &error );
     if ( error != NULL ) {
         char *msg = g_strdup_printf ( "Failed to execute: '%s'\nError: '%s'", cmd, error->message );
         rofi_view_error_dialog ( msg, FALSE  );
@@ -126,98 +133,721 @@ static void exec_cmd_entry ( DRunModeEntry *e )
     gchar *fp = rofi_expand_path ( g_strstrip ( str ) );
     if ( execsh ( fp, e->terminal ) ) {
         char *path = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
-        history_set ( path, e->path );
+        history_set_deferred ( path, e->path );
         g_free ( path );
     }
     g_free ( str );
     g_free ( fp );
 }
 /**
- * This function absorbs/freeś path, so this is no longer available afterwards.
+ * A list of entries, grown geometrically.
  */
-static void read_desktop_file ( DRunModePrivateData *pd, char *path, const char *filename )
+typedef struct
 {
-    for ( unsigned int index = 0; index < pd->history_length; index++ ) {
-        if ( g_strcmp0 ( path, pd->entry_list[index].path ) == 0 ) {
-            g_free ( path );
-            return;
-        }
+    DRunModeEntry *entries;
+    unsigned int  length;
+    unsigned int  size;
+} DRunModeEntryList;
+
+/**
+ * @param list The list to add an entry to.
+ *
+ * @returns a pointer to the new (uninitialized) entry at the end of the list.
+ */
+static DRunModeEntry *drun_entry_list_add ( DRunModeEntryList *list )
+{
+    if ( list->length >= list->size ) {
+        list->size    = list->size ? list->size * 2 : 64;
+        list->entries = g_realloc ( list->entries, list->size * sizeof ( DRunModeEntry ) );
     }
-    GKeyFile *kf    = g_key_file_new ();
-    GError   *error = NULL;
-    g_key_file_load_from_file ( kf, path, 0, &error );
+    return &( list->entries[list->length++] );
+}
+
+static void drun_entry_clear ( DRunModeEntry *e )
+{
+    g_free ( e->path );
+    g_free ( e->exec );
+    g_free ( e->name );
+    g_free ( e->generic_name );
+}
+
+/**
+ * @param list The list to add the entry to.
+ * @param path The path of the desktop file.
+ * @param filename The filename of the desktop file.
+ * @param data The content of the desktop file.
+ * @param length The length of data.
+ *
+ * This function absorbs/freeś path, so this is no longer available afterwards.
+ *
+ * @returns TRUE if an entry was added to the list.
+ */
+static gboolean read_desktop_file ( DRunModeEntryList *list, char *path, const char *filename, const char *data, gsize length )
+{
+    DesktopEntry de;
     // If error, skip to next entry
-    if ( error != NULL ) {
-        g_error_free ( error );
-        g_key_file_free ( kf );
+    if ( !desktop_entry_parse ( data, length, g_get_language_names (), &de ) ) {
         g_free ( path );
-        return;
+        return FALSE;
     }
-    // Skip hidden entries.
-    if ( g_key_file_has_key ( kf, "Desktop Entry", "Hidden", NULL ) ) {
-        if ( g_key_file_get_boolean ( kf, "Desktop Entry", "Hidden", NULL ) ) {
-            g_key_file_free ( kf );
-            g_free ( path );
-            return;
+    // Skip hidden entries and entries that have NoDisplay set.
+    if ( de.hidden || de.no_display || de.exec == NULL ) {
+        desktop_entry_clear ( &de );
+        g_free ( path );
+        return FALSE;
+    }
+    DRunModeEntry *entry = drun_entry_list_add ( list );
+    entry->path         = path;
+    entry->terminal     = de.terminal;
+    entry->exec         = de.exec;
+    entry->name         = de.name;
+    entry->generic_name = de.generic_name;
+    if ( entry->name == NULL ) {
+        entry->name         = g_filename_display_name ( filename );
+        g_free ( entry->generic_name );
+        entry->generic_name = NULL;
+    }
+    return TRUE;
+}
+
+/**
+ * Magic and version of the desktop entry index file.
+ */
+#define DRUN_INDEX_MAGIC           "RDRN"
+#define DRUN_INDEX_VERSION         1
+
+/** The file has an entry that is shown. */
+#define DRUN_INDEX_ENTRY           1
+/** The entry is run in a terminal. */
+#define DRUN_INDEX_TERMINAL        2
+/** The entry has a generic name. */
+#define DRUN_INDEX_GENERIC_NAME    4
+
+/**
+ * Header of the desktop entry index file.
+ * It is followed by the directory records, the file records and the string area.
+ * Records hold offsets into the string area.
+ */
+typedef struct
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t num_dirs;
+    uint32_t num_files;
+    /** Offset of the language list the names were looked up for. */
+    uint32_t languages;
+    uint32_t pad;
+    uint64_t strings_size;
+} DRunIndexHeader;
+
+/**
+ * An applications directory in the index file.
+ */
+typedef struct
+{
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    /** Offset of the directory name in the string area. */
+    uint32_t path;
+    /** Index of the first file record of the directory. */
+    uint32_t first_file;
+    uint32_t num_files;
+    uint32_t pad;
+} DRunIndexDir;
+
+/**
+ * A desktop file in the index file.
+ * Files without an entry are kept too, so they are not parsed again.
+ */
+typedef struct
+{
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    int64_t  size;
+    uint32_t path;
+    uint32_t flags;
+    uint32_t name;
+    uint32_t generic_name;
+    uint32_t exec;
+    uint32_t pad;
+} DRunIndexFile;
+
+/**
+ * The mapped index file.
+ */
+typedef struct
+{
+    char                  *map;
+    size_t                size;
+    const DRunIndexHeader *header;
+    const DRunIndexDir    *dirs;
+    const DRunIndexFile   *files;
+    const char            *strings;
+    /** Maps the path of a desktop file to its DRunIndexFile. */
+    GHashTable            *lookup;
+} DRunIndex;
+
+/**
+ * A desktop file found while scanning, used to write the new index.
+ */
+typedef struct
+{
+    char            *path;
+    struct timespec mtime;
+    off_t           size;
+    /** Position of the entry in the list, -1 if the file has no entry. */
+    int             entry;
+} DRunScannedFile;
+
+/**
+ * @param index The index to fill in.
+ * @param filename The index file.
+ * @param languages The current language list.
+ *
+ * Map and validate the index file. An index written for other languages is not used.
+ *
+ * @returns TRUE when the index was loaded.
+ */
+static int drun_index_load ( DRunIndex *index, const char *filename, const char *languages )
+{
+    struct stat st;
+    memset ( index, 0, sizeof ( *index ) );
+    int         fd = open ( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        return FALSE;
+    }
+    if ( fstat ( fd, &st ) != 0 || (size_t) st.st_size < sizeof ( DRunIndexHeader ) ) {
+        close ( fd );
+        return FALSE;
+    }
+    char *map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close ( fd );
+    if ( map == MAP_FAILED ) {
+        return FALSE;
+    }
+    index->map    = map;
+    index->size   = st.st_size;
+    index->header = (const DRunIndexHeader *) map;
+
+    const DRunIndexHeader *h       = index->header;
+    uint64_t              expected = sizeof ( DRunIndexHeader ) + (uint64_t) h->num_dirs * sizeof ( DRunIndexDir ) +
+                                     (uint64_t) h->num_files * sizeof ( DRunIndexFile ) + h->strings_size;
+    if ( memcmp ( h->magic, DRUN_INDEX_MAGIC, 4 ) != 0 || h->version != DRUN_INDEX_VERSION ||
+         expected != index->size || h->strings_size == 0 ) {
+        goto invalid;
+    }
+    index->dirs    = (const DRunIndexDir *) ( map + sizeof ( DRunIndexHeader ) );
+    index->files   = (const DRunIndexFile *) ( index->dirs + h->num_dirs );
+    index->strings = (const char *) ( index->files + h->num_files );
+    if ( index->strings[h->strings_size - 1] != '\0' || h->languages >= h->strings_size ) {
+        goto invalid;
+    }
+    for ( uint32_t i = 0; i < h->num_dirs; i++ ) {
+        if ( index->dirs[i].path >= h->strings_size ||
+             (uint64_t) index->dirs[i].first_file + index->dirs[i].num_files > h->num_files ) {
+            goto invalid;
         }
     }
-    // Skip entries that have NoDisplay set.
-    if ( g_key_file_has_key ( kf, "Desktop Entry", "NoDisplay", NULL ) ) {
-        if ( g_key_file_get_boolean ( kf, "Desktop Entry", "NoDisplay", NULL ) ) {
-            g_key_file_free ( kf );
-            g_free ( path );
-            return;
+    for ( uint32_t i = 0; i < h->num_files; i++ ) {
+        const DRunIndexFile *f = &( index->files[i] );
+        if ( f->path >= h->strings_size || f->name >= h->strings_size ||
+             f->generic_name >= h->strings_size || f->exec >= h->strings_size ) {
+            goto invalid;
         }
     }
-    if ( g_key_file_has_key ( kf, "Desktop Entry", "Exec", NULL ) ) {
-        size_t nl = ( ( pd->cmd_list_length ) + 1 );
-        pd->entry_list                               = g_realloc ( pd->entry_list, nl * sizeof ( *( pd->entry_list ) ) );
-        pd->entry_list[pd->cmd_list_length].path     = path;
-        pd->entry_list[pd->cmd_list_length].terminal = FALSE;
-        if ( g_key_file_has_key ( kf, "Desktop Entry", "Name", NULL ) ) {
-            gchar *n  = g_key_file_get_locale_string ( kf, "Desktop Entry", "Name", NULL, NULL );
-            gchar *gn = g_key_file_get_locale_string ( kf, "Desktop Entry", "GenericName", NULL, NULL );
-            pd->entry_list[pd->cmd_list_length].name         = n;
-            pd->entry_list[pd->cmd_list_length].generic_name = gn;
+    if ( strcmp ( index->strings + h->languages, languages ) != 0 ) {
+        // Names are translated, the index is of no use after a language change.
+        munmap ( map, index->size );
+        memset ( index, 0, sizeof ( *index ) );
+        return FALSE;
+    }
+    index->lookup = g_hash_table_new ( g_str_hash, g_str_equal );
+    for ( uint32_t i = 0; i < h->num_files; i++ ) {
+        g_hash_table_insert ( index->lookup, (gpointer) ( index->strings + index->files[i].path ), (gpointer) &( index->files[i] ) );
+    }
+    return TRUE;
+invalid:
+    fprintf ( stderr, "Ignoring invalid desktop entry index: %s\n", filename );
+    munmap ( map, index->size );
+    memset ( index, 0, sizeof ( *index ) );
+    return FALSE;
+}
+
+/**
+ * @param index The index to free.
+ *
+ * Unmap the index file.
+ */
+static void drun_index_free ( DRunIndex *index )
+{
+    if ( index->lookup != NULL ) {
+        g_hash_table_destroy ( index->lookup );
+    }
+    if ( index->map != NULL ) {
+        munmap ( index->map, index->size );
+    }
+    memset ( index, 0, sizeof ( *index ) );
+}
+
+/**
+ * @param index The index.
+ * @param path The applications directory.
+ *
+ * @returns the directory record in the index, or NULL if not found.
+ */
+static const DRunIndexDir *drun_index_find_dir ( const DRunIndex *index, const char *path )
+{
+    if ( index->map == NULL ) {
+        return NULL;
+    }
+    for ( uint32_t i = 0; i < index->header->num_dirs; i++ ) {
+        if ( strcmp ( index->strings + index->dirs[i].path, path ) == 0 ) {
+            return &( index->dirs[i] );
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @param index The index.
+ * @param req The stat result of the desktop file.
+ *
+ * @returns the file record in the index if the file did not change since, NULL otherwise.
+ */
+static const DRunIndexFile *drun_index_find_file ( const DRunIndex *index, const IOBatchRequest *req )
+{
+    if ( index->lookup == NULL ) {
+        return NULL;
+    }
+    const DRunIndexFile *f = g_hash_table_lookup ( index->lookup, req->path );
+    if ( f == NULL || f->mtime_sec != (int64_t) req->mtime.tv_sec || f->mtime_nsec != (int64_t) req->mtime.tv_nsec ||
+         f->size != (int64_t) req->size ) {
+        return NULL;
+    }
+    return f;
+}
+
+/**
+ * @param strings The string area.
+ * @param str The string to add.
+ *
+ * @returns the offset of str in the string area.
+ */
+static uint32_t drun_index_add_string ( GString *strings, const char *str )
+{
+    uint32_t offset = strings->len;
+    g_string_append_len ( strings, str, strlen ( str ) + 1 );
+    return offset;
+}
+
+/**
+ * The stat results and contents of a list of desktop files.
+ */
+typedef struct
+{
+    /** The stat result of every file. */
+    IOBatchRequest      *stats;
+    /** The record of every file in the index of the previous run, NULL if it changed. */
+    const DRunIndexFile **cached;
+    /** The content of every file that is not in the index, data is NULL otherwise. */
+    IOBatchRequest      *reads;
+} DRunFetch;
+
+/**
+ * @param fetch The fetch to fill in, free with drun_fetch_free().
+ * @param index The index of the previous run.
+ * @param paths The paths of the desktop files.
+ * @param num The number of paths.
+ *
+ * Stat all files, then read the ones that changed since the index was written.
+ * Each step is one batch over all files, so the ring is kept full with up to #IO_BATCH_DEPTH requests.
+ */
+static void drun_fetch_files ( DRunFetch *fetch, const DRunIndex *index, char **paths, unsigned int num )
+{
+    fetch->stats  = g_malloc0_n ( MAX ( num, 1 ), sizeof ( IOBatchRequest ) );
+    fetch->cached = g_malloc0_n ( MAX ( num, 1 ), sizeof ( DRunIndexFile * ) );
+    fetch->reads  = g_malloc0_n ( MAX ( num, 1 ), sizeof ( IOBatchRequest ) );
+    for ( unsigned int i = 0; i < num; i++ ) {
+        fetch->stats[i].path = paths[i];
+    }
+    io_batch_stat ( fetch->stats, num );
+
+    // The files to read have to be consecutive for the batch.
+    IOBatchRequest *reads     = g_malloc0_n ( MAX ( num, 1 ), sizeof ( IOBatchRequest ) );
+    unsigned int   *positions = g_malloc_n ( MAX ( num, 1 ), sizeof ( unsigned int ) );
+    unsigned int   num_reads  = 0;
+    for ( unsigned int i = 0; i < num; i++ ) {
+        if ( fetch->stats[i].error != 0 ) {
+            continue;
+        }
+        fetch->cached[i] = drun_index_find_file ( index, &( fetch->stats[i] ) );
+        if ( fetch->cached[i] == NULL ) {
+            positions[num_reads]    = i;
+            reads[num_reads++].path = paths[i];
+        }
+    }
+    io_batch_read ( reads, num_reads );
+    for ( unsigned int i = 0; i < num_reads; i++ ) {
+        fetch->reads[positions[i]] = reads[i];
+    }
+    g_free ( positions );
+    g_free ( reads );
+}
+
+/**
+ * @param fetch The fetch to free.
+ *
+ * Free the fetch, the content of the files is freed by drun_scan_files().
+ */
+static void drun_fetch_free ( DRunFetch *fetch )
+{
+    g_free ( fetch->stats );
+    g_free ( fetch->cached );
+    g_free ( fetch->reads );
+    memset ( fetch, 0, sizeof ( *fetch ) );
+}
+
+/**
+ * @param list The list to add the entries to.
+ * @param files If not NULL, the scanned files are appended to it (DRunScannedFile), to write a new index.
+ * @param index The index of the previous run.
+ * @param paths The paths of the desktop files.
+ * @param fetch The fetched files, the paths start at offset in it.
+ * @param offset The position of the first path in fetch.
+ * @param num The number of paths.
+ *
+ * Get the entries of the desktop files, in order. Files that did not change since the index
+ * was written are taken from the index, the others are parsed from their fetched content.
+ * Files that could not be stat'ed or read are left out of files, so they are tried again on the next run.
+ * This function absorbs/frees the paths and the fetched content, the arrays themselves are kept.
+ *
+ * @returns the number of files that were parsed.
+ */
+static unsigned int drun_scan_files ( DRunModeEntryList *list, GArray *files, const DRunIndex *index, char **paths,
+                                      const DRunFetch *fetch, unsigned int offset, unsigned int num )
+{
+    unsigned int parsed = 0;
+    for ( unsigned int i = 0; i < num; i++ ) {
+        char                 *path = paths[i];
+        const IOBatchRequest *req  = &( fetch->stats[offset + i] );
+        DRunScannedFile      sf    = { NULL, req->mtime, req->size, -1 };
+        if ( req->error != 0 ) {
+            g_free ( path );
+            continue;
+        }
+        if ( fetch->cached[offset + i] != NULL ) {
+            const DRunIndexFile *f = fetch->cached[offset + i];
+            if ( f->flags & DRUN_INDEX_ENTRY ) {
+                DRunModeEntry *entry = drun_entry_list_add ( list );
+                entry->path         = g_strdup ( path );
+                entry->name         = g_strdup ( index->strings + f->name );
+                entry->generic_name = ( f->flags & DRUN_INDEX_GENERIC_NAME ) ? g_strdup ( index->strings + f->generic_name ) : NULL;
+                entry->exec         = g_strdup ( index->strings + f->exec );
+                entry->terminal     = ( f->flags & DRUN_INDEX_TERMINAL ) != 0;
+                sf.entry            = list->length - 1;
+            }
+            sf.path = path;
         }
         else {
-            pd->entry_list[pd->cmd_list_length].name         = g_filename_display_name ( filename );
-            pd->entry_list[pd->cmd_list_length].generic_name = NULL;
+            IOBatchRequest *rd = &( fetch->reads[offset + i] );
+            if ( rd->data == NULL ) {
+                // If error, skip to next entry
+                g_free ( path );
+                continue;
+            }
+            sf.path  = g_strdup ( path );
+            sf.mtime = rd->mtime;
+            sf.size  = rd->size;
+            gchar *name = g_path_get_basename ( path );
+            if ( read_desktop_file ( list, path, name, rd->data, rd->length ) ) {
+                sf.entry = list->length - 1;
+            }
+            g_free ( name );
+            g_free ( rd->data );
+            rd->data = NULL;
+            parsed++;
         }
-        pd->entry_list[pd->cmd_list_length].exec = g_key_file_get_string ( kf, "Desktop Entry", "Exec", NULL );
-        if ( g_key_file_has_key ( kf, "Desktop Entry", "Terminal", NULL ) ) {
-            pd->entry_list[pd->cmd_list_length].terminal = g_key_file_get_boolean ( kf, "Desktop Entry", "Terminal", NULL );
+        if ( files != NULL ) {
+            g_array_append_val ( files, sf );
+        }
+        else {
+            g_free ( sf.path );
         }
-        ( pd->cmd_list_length )++;
     }
+    return parsed;
+}
+
+/**
+ * Number of desktop files parsed by a single job.
+ * Small enough that the files of one large directory are spread over all workers.
+ * Only the parsing is split, the files of a directory are fetched as one batch by the listing job.
+ */
+#define DRUN_PARSE_CHUNK    64
 
-    g_key_file_free ( kf );
+/**
+ * Job listing one applications directory.
+ */
+typedef struct
+{
+    /** The index of the previous run. */
+    const DRunIndex   *index;
+    /** The applications directory. */
+    char              *path;
+    /** Set when the directory exists. */
+    int               valid;
+    struct stat       st;
+    /** The paths of the desktop files in the directory. */
+    GPtrArray         *paths;
+    /** The stat results and contents of the desktop files, in the order of paths. */
+    DRunFetch         fetch;
+    /** The entries found in the directory. */
+    DRunModeEntryList list;
+    /** The desktop files found in the directory, DRunScannedFile. */
+    GArray            *files;
+    /** Set when the index is out of date for this directory. */
+    int               changed;
+    /** Set when not all desktop files could be read, the directory is then listed again on the next run. */
+    int               incomplete;
+} DRunModeDirJob;
+
+/**
+ * Job parsing a chunk of the desktop files of one directory.
+ */
+typedef struct
+{
+    DRunModeDirJob    *dir;
+    /** The first desktop file in DRunModeDirJob::paths. */
+    unsigned int      offset;
+    /** The number of desktop files. */
+    unsigned int      num;
+    /** The number of desktop files that were parsed, and not taken from the index. */
+    unsigned int      parsed;
+    /** The entries found in this chunk. */
+    DRunModeEntryList list;
+    /** The desktop files found in this chunk, DRunScannedFile. */
+    GArray            *files;
+} DRunModeParseJob;
+
+/**
+ * @param t The job, priv points to a DRunModeDirJob.
+ * @param user_data Unused.
+ *
+ * Internal spider used to get list of desktop files, run on the thread pool.
+ * When the directory did not change since the index was written, the file list is taken from the index.
+ * The desktop files are then stat'ed and, when changed, read in one batch for the whole directory.
+ */
+static void get_apps_dir ( thread_state *t, G_GNUC_UNUSED gpointer user_data )
+{
+    DRunModeDirJob     *job = (DRunModeDirJob *) t->priv;
+    const DRunIndexDir *cd  = drun_index_find_dir ( job->index, job->path );
+
+    job->paths = g_ptr_array_new ();
+    job->files = g_array_new ( FALSE, FALSE, sizeof ( DRunScannedFile ) );
+    job->valid = ( stat ( job->path, &( job->st ) ) == 0 && S_ISDIR ( job->st.st_mode ) );
+    if ( !job->valid ) {
+        job->changed = ( cd == NULL || cd->mtime_sec != -1 );
+        return;
+    }
+
+    if ( cd != NULL && cd->mtime_sec == (int64_t) job->st.st_mtim.tv_sec && cd->mtime_nsec == (int64_t) job->st.st_mtim.tv_nsec ) {
+        for ( uint32_t i = 0; i < cd->num_files; i++ ) {
+            g_ptr_array_add ( job->paths, g_strdup ( job->index->strings + job->index->files[cd->first_file + i].path ) );
+        }
+    }
+    else {
+        DIR *dir = opendir ( job->path );
+        job->changed = TRUE;
+        if ( dir != NULL ) {
+            struct dirent *dent;
+
+            while ( ( dent = readdir ( dir ) ) != NULL ) {
+                if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
+                    continue;
+                }
+                // Skip dot files.
+                if ( dent->d_name[0] == '.' ) {
+                    continue;
+                }
+                g_ptr_array_add ( job->paths, g_build_filename ( job->path, dent->d_name, NULL ) );
+            }
+
+            closedir ( dir );
+        }
+    }
+    drun_fetch_files ( &( job->fetch ), job->index, (char * *) job->paths->pdata, job->paths->len );
 }
 
 /**
- * Internal spider used to get list of executables.
+ * @param t The job, priv points to a DRunModeParseJob.
+ * @param user_data Unused.
+ *
+ * Parse a chunk of desktop files into the private list of the job, run on the thread pool.
  */
-static void get_apps_dir ( DRunModePrivateData *pd, const char *bp )
+static void get_apps_parse ( thread_state *t, G_GNUC_UNUSED gpointer user_data )
 {
-    DIR *dir = opendir ( bp );
+    DRunModeParseJob *job = (DRunModeParseJob *) t->priv;
+    job->files  = g_array_sized_new ( FALSE, FALSE, sizeof ( DRunScannedFile ), job->num );
+    job->parsed = drun_scan_files ( &( job->list ), job->files, job->dir->index,
+                                    (char * *) &( job->dir->paths->pdata[job->offset] ),
+                                    &( job->dir->fetch ), job->offset, job->num );
+}
 
-    if ( dir != NULL ) {
-        struct dirent *dent;
+/**
+ * @param dirs The listed directories.
+ * @param num_dirs The number of directories.
+ *
+ * Parse the desktop files of all directories in chunks on the thread pool, then merge the
+ * chunks back into their directory in order, so the result does not depend on the scheduling.
+ */
+static void get_apps_parse_dirs ( DRunModeDirJob *dirs, unsigned int num_dirs )
+{
+    unsigned int num_jobs = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        num_jobs += ( dirs[i].paths->len + DRUN_PARSE_CHUNK - 1 ) / DRUN_PARSE_CHUNK;
+    }
+    if ( num_jobs == 0 ) {
+        return;
+    }
+    DRunModeParseJob *jobs   = g_malloc0_n ( num_jobs, sizeof ( DRunModeParseJob ) );
+    thread_state     *states = g_malloc0_n ( num_jobs, sizeof ( thread_state ) );
+    unsigned int     n       = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        for ( unsigned int offset = 0; offset < dirs[i].paths->len; offset += DRUN_PARSE_CHUNK ) {
+            jobs[n].dir        = &( dirs[i] );
+            jobs[n].offset     = offset;
+            jobs[n].num        = MIN ( dirs[i].paths->len - offset, DRUN_PARSE_CHUNK );
+            states[n].priv     = &( jobs[n] );
+            states[n].callback = get_apps_parse;
+            n++;
+        }
+    }
+    rofi_view_run_jobs ( states, num_jobs );
 
-        while ( ( dent = readdir ( dir ) ) != NULL ) {
-            if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
-                continue;
+    for ( unsigned int i = 0; i < num_jobs; i++ ) {
+        DRunModeDirJob   *dir  = jobs[i].dir;
+        DRunModeParseJob *job  = &( jobs[i] );
+        unsigned int     base  = dir->list.length;
+        if ( job->parsed > 0 || job->files->len != job->num ) {
+            dir->changed = TRUE;
+        }
+        if ( job->files->len != job->num ) {
+            dir->incomplete = TRUE;
+        }
+        if ( dir->list.entries == NULL ) {
+            // First chunk of the directory, take over its list.
+            dir->list = job->list;
+        }
+        else {
+            if ( job->list.length > 0 ) {
+                dir->list.size    = dir->list.length + job->list.length;
+                dir->list.entries = g_realloc ( dir->list.entries, dir->list.size * sizeof ( DRunModeEntry ) );
+                memcpy ( &( dir->list.entries[base] ), job->list.entries, job->list.length * sizeof ( DRunModeEntry ) );
+                dir->list.length += job->list.length;
             }
-            // Skip dot files.
-            if ( dent->d_name[0] == '.' ) {
-                continue;
+            g_free ( job->list.entries );
+        }
+        for ( unsigned int j = 0; j < job->files->len; j++ ) {
+            DRunScannedFile *sf = &g_array_index ( job->files, DRunScannedFile, j );
+            if ( sf->entry >= 0 ) {
+                sf->entry += base;
+            }
+        }
+        g_array_append_vals ( dir->files, job->files->data, job->files->len );
+        g_array_free ( job->files, TRUE );
+    }
+    g_free ( states );
+    g_free ( jobs );
+}
+
+/**
+ * @param filename The index file.
+ * @param languages The current language list.
+ * @param jobs The scanned applications directories.
+ * @param num_jobs The number of directories.
+ *
+ * Write the desktop entry index file, the file is replaced atomically.
+ *
+ * @returns TRUE when the index was written.
+ */
+static int drun_index_write ( const char *filename, const char *languages, const DRunModeDirJob *jobs, unsigned int num_jobs )
+{
+    GString         *strings   = g_string_sized_new ( 65536 );
+    DRunIndexDir    *cdirs     = g_malloc0_n ( num_jobs + 1, sizeof ( DRunIndexDir ) );
+    unsigned int    num_files  = 0;
+    for ( unsigned int i = 0; i < num_jobs; i++ ) {
+        num_files += jobs[i].files->len;
+    }
+    DRunIndexFile   *cfiles    = g_malloc0_n ( num_files + 1, sizeof ( DRunIndexFile ) );
+    unsigned int    n          = 0;
+    DRunIndexHeader header;
+    memset ( &header, 0, sizeof ( header ) );
+    memcpy ( header.magic, DRUN_INDEX_MAGIC, 4 );
+    header.version   = DRUN_INDEX_VERSION;
+    header.num_dirs  = num_jobs;
+    header.num_files = num_files;
+    header.languages = drun_index_add_string ( strings, languages );
+    for ( unsigned int i = 0; i < num_jobs; i++ ) {
+        cdirs[i].path       = drun_index_add_string ( strings, jobs[i].path );
+        cdirs[i].first_file = n;
+        cdirs[i].num_files  = jobs[i].files->len;
+        if ( jobs[i].valid && !jobs[i].incomplete ) {
+            cdirs[i].mtime_sec  = jobs[i].st.st_mtim.tv_sec;
+            cdirs[i].mtime_nsec = jobs[i].st.st_mtim.tv_nsec;
+        }
+        else if ( jobs[i].valid ) {
+            // Never matches, so the files that failed are found and read again.
+            cdirs[i].mtime_sec = -2;
+        }
+        else {
+            cdirs[i].mtime_sec = -1;
+        }
+        for ( unsigned int j = 0; j < jobs[i].files->len; j++ ) {
+            const DRunScannedFile *sf = &g_array_index ( jobs[i].files, DRunScannedFile, j );
+            DRunIndexFile         *cf = &( cfiles[n++] );
+            cf->path       = drun_index_add_string ( strings, sf->path );
+            cf->mtime_sec  = sf->mtime.tv_sec;
+            cf->mtime_nsec = sf->mtime.tv_nsec;
+            cf->size       = sf->size;
+            if ( sf->entry >= 0 ) {
+                const DRunModeEntry *e = &( jobs[i].list.entries[sf->entry] );
+                cf->flags = DRUN_INDEX_ENTRY | ( e->terminal ? DRUN_INDEX_TERMINAL : 0 );
+                cf->name  = drun_index_add_string ( strings, e->name ? e->name : "" );
+                cf->exec  = drun_index_add_string ( strings, e->exec ? e->exec : "" );
+                if ( e->generic_name != NULL ) {
+                    cf->flags       |= DRUN_INDEX_GENERIC_NAME;
+                    cf->generic_name = drun_index_add_string ( strings, e->generic_name );
+                }
             }
-            gchar *path = g_build_filename ( bp, dent->d_name, NULL );
-            read_desktop_file ( pd, path, dent->d_name );
         }
+    }
+    header.strings_size = strings->len;
 
-        closedir ( dir );
+    int  retv     = FALSE;
+    char *tmpname = g_strdup_printf ( "%s.XXXXXX", filename );
+    int  fd       = g_mkstemp ( tmpname );
+    if ( fd >= 0 ) {
+        FILE *fp = fdopen ( fd, "w" );
+        if ( fp != NULL ) {
+            int ok = fwrite ( &header, sizeof ( header ), 1, fp ) == 1;
+            ok   = ok && ( num_jobs == 0 || fwrite ( cdirs, sizeof ( DRunIndexDir ), num_jobs, fp ) == num_jobs );
+            ok   = ok && ( num_files == 0 || fwrite ( cfiles, sizeof ( DRunIndexFile ), num_files, fp ) == num_files );
+            ok   = ok && fwrite ( strings->str, 1, strings->len, fp ) == strings->len;
+            ok   = ( fclose ( fp ) == 0 ) && ok;
+            retv = ok && rename ( tmpname, filename ) == 0;
+        }
+        else {
+            close ( fd );
+        }
+        if ( !retv ) {
+            fprintf ( stderr, "Failed to write desktop entry index: %s: %s\n", filename, strerror ( errno ) );
+            unlink ( tmpname );
+        }
     }
+    g_free ( tmpname );
+    g_free ( cfiles );
+    g_free ( cdirs );
+    g_string_free ( strings, TRUE );
+    return retv;
 }
 /**
  * @param cmd The command to remove from history
@@ -232,52 +862,134 @@ static void delete_entry_history ( const DRunModeEntry *entry )
 
     g_free ( path );
 }
-static void get_apps_history ( DRunModePrivateData *pd )
+/**
+ * @param pd The drun private data.
+ * @param index The index of the previous run.
+ *
+ * Put the entries from the history in front of the list.
+ *
+ * @returns the set of desktop files in the history.
+ */
+static GHashTable *get_apps_history ( DRunModePrivateData *pd, const DRunIndex *index )
 {
-    unsigned int length = 0;
-    gchar        *path  = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
-    gchar        **retv = history_get_list ( path, &length );
+    unsigned int      length   = 0;
+    gchar             *path    = g_build_filename ( cache_dir, DRUN_CACHE_FILE, NULL );
+    gchar             **retv   = history_get_list ( path, &length );
+    GHashTable        *history = history_index ( retv, length );
+    DRunModeEntryList list     = { NULL, 0, 0 };
     g_free ( path );
-    for ( unsigned int index = 0; index < length; index++ ) {
-        gchar *name = g_path_get_basename ( retv[index] );
-        read_desktop_file ( pd, retv[index], name );
-        g_free ( name );
-    }
+    DRunFetch         fetch;
+    drun_fetch_files ( &fetch, index, retv, length );
+    drun_scan_files ( &list, NULL, index, retv, &fetch, 0, length );
+    drun_fetch_free ( &fetch );
     g_free ( retv );
-    pd->history_length = pd->cmd_list_length;
+    pd->entry_list      = list.entries;
+    pd->cmd_list_length = list.length;
+    pd->history_length  = pd->cmd_list_length;
+    return history;
 }
 static void get_apps ( DRunModePrivateData *pd )
 {
-    get_apps_history ( pd );
-    const char * const * dr   = g_get_system_data_dirs ();
-    const char * const * iter = dr;
+    // The names are translated, so the index is only valid for the current languages.
+    char      *languages  = g_strjoinv ( ":", (gchar * *) g_get_language_names () );
+    char      *index_path = g_build_filename ( cache_dir, DRUN_INDEX_FILE, NULL );
+    DRunIndex index;
+    drun_index_load ( &index, index_path, languages );
+    TICK_N ( "Load desktop entry index" );
+
+    GHashTable *history = get_apps_history ( pd, &index );
+
+    // Collect the applications directories.
+    GPtrArray            *dirs = g_ptr_array_new ();
+    const char * const * dr    = g_get_system_data_dirs ();
+    const char * const * iter  = dr;
     while ( iter != NULL && *iter != NULL && **iter != '\0' ) {
         gboolean skip = FALSE;
         for ( size_t i = 0; !skip && dr[i] != ( *iter ); i++ ) {
             skip = ( g_strcmp0 ( *iter, dr[i] ) == 0 );
         }
-        if ( skip ) {
-            iter++;
-            continue;
+        if ( !skip ) {
+            g_ptr_array_add ( dirs, g_build_filename ( *iter, "applications", NULL ) );
         }
-        gchar *bp = g_build_filename ( *iter, "applications", NULL );
-        get_apps_dir ( pd, bp );
-        g_free ( bp );
         iter++;
     }
 
-    const char *d = g_get_user_data_dir ();
-    for ( size_t i = 0; dr && dr[i] != NULL; i++ ) {
-        if ( g_strcmp0 ( d, dr[i] ) == 0 ) {
-            // Done this already, no need to repeat.
-            return;
-        }
+    const char *d    = g_get_user_data_dir ();
+    gboolean   found = FALSE;
+    for ( size_t i = 0; !found && dr && dr[i] != NULL; i++ ) {
+        // Done this already, no need to repeat.
+        found = ( g_strcmp0 ( d, dr[i] ) == 0 );
+    }
+    if ( d && !found ) {
+        g_ptr_array_add ( dirs, g_build_filename ( d, "applications", NULL ) );
+    }
+    if ( dirs->len == 0 ) {
+        g_ptr_array_free ( dirs, TRUE );
+        g_hash_table_destroy ( history );
+        drun_index_free ( &index );
+        g_free ( index_path );
+        g_free ( languages );
+        return;
     }
-    if ( d ) {
-        gchar *bp = g_build_filename ( d, "applications", NULL );
-        get_apps_dir ( pd, bp );
-        g_free ( bp );
+
+    // List the directories in parallel, one job per directory.
+    DRunModeDirJob jobs[dirs->len];
+    thread_state   states[dirs->len];
+    for ( unsigned int i = 0; i < dirs->len; i++ ) {
+        memset ( &( jobs[i] ), 0, sizeof ( DRunModeDirJob ) );
+        memset ( &( states[i] ), 0, sizeof ( thread_state ) );
+        jobs[i].index      = &index;
+        jobs[i].path       = g_ptr_array_index ( dirs, i );
+        states[i].priv     = &( jobs[i] );
+        states[i].callback = get_apps_dir;
+    }
+    rofi_view_run_jobs ( states, dirs->len );
+    TICK_N ( "List desktop files" );
+    get_apps_parse_dirs ( jobs, dirs->len );
+    for ( unsigned int i = 0; i < dirs->len; i++ ) {
+        drun_fetch_free ( &( jobs[i].fetch ) );
+    }
+    TICK_N ( "Parse desktop files" );
+
+    // Only rewrite the index when something changed.
+    int changed = ( index.map == NULL || index.header->num_dirs != dirs->len );
+    for ( unsigned int i = 0; !changed && i < dirs->len; i++ ) {
+        changed = jobs[i].changed || strcmp ( index.strings + index.dirs[i].path, jobs[i].path ) != 0;
     }
+    drun_index_free ( &index );
+    if ( changed ) {
+        drun_index_write ( index_path, languages, jobs, dirs->len );
+        TICK_N ( "Write desktop entry index" );
+    }
+    g_free ( index_path );
+    g_free ( languages );
+
+    // Merge the results in directory order, skipping the entries already listed from the history.
+    unsigned int total = pd->cmd_list_length;
+    for ( unsigned int i = 0; i < dirs->len; i++ ) {
+        total += jobs[i].list.length;
+    }
+    pd->entry_list = g_realloc ( pd->entry_list, ( total + 1 ) * sizeof ( DRunModeEntry ) );
+    for ( unsigned int i = 0; i < dirs->len; i++ ) {
+        for ( unsigned int j = 0; j < jobs[i].list.length; j++ ) {
+            DRunModeEntry *e = &( jobs[i].list.entries[j] );
+            if ( g_hash_table_contains ( history, e->path ) ) {
+                drun_entry_clear ( e );
+                continue;
+            }
+            pd->entry_list[pd->cmd_list_length++] = *e;
+        }
+        for ( unsigned int j = 0; j < jobs[i].files->len; j++ ) {
+            g_free ( g_array_index ( jobs[i].files, DRunScannedFile, j ).path );
+        }
+        g_array_free ( jobs[i].files, TRUE );
+        // The paths themselves are owned by the entries or the scanned files.
+        g_ptr_array_free ( jobs[i].paths, TRUE );
+        g_free ( jobs[i].list.entries );
+        g_free ( jobs[i].path );
+    }
+    g_hash_table_destroy ( history );
+    g_ptr_array_free ( dirs, TRUE );
 }
 
 static int drun_mode_init ( Mode *sw )
@@ -289,13 +1001,6 @@ static int drun_mode_init ( Mode *sw )
     }
     return TRUE;
 }
-static void drun_entry_clear ( DRunModeEntry *e )
-{
-    g_free ( e->path );
-    g_free ( e->exec );
-    g_free ( e->name );
-    g_free ( e->generic_name );
-}
 
 static ModeMode drun_mode_result ( Mode *sw, int mretv, char **input, unsigned int selected_line )
 {
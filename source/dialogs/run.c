@@ -36,23 +36,41 @@
 #include <unistd.h>
 #include <limits.h>
 #include <signal.h>
+#include <stdint.h>
+#include <fcntl.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <dirent.h>
 #include <strings.h>
 #include <string.h>
 #include <errno.h>
+#include <glib-unix.h>
 
 #include "rofi.h"
 #include "settings.h"
 #include "helper.h"
 #include "history.h"
+#include "io-batch.h"
 #include "dialogs/run.h"
 
 #include "mode-private.h"
 /**
  * Name of the history file where previously choosen commands are stored.
  */
-#define RUN_CACHE_FILE    "rofi-3.runcache"
+#define RUN_CACHE_FILE         "rofi-3.runcache"
+/**
+ * Name of the file caching the executables found in PATH.
+ */
+#define RUN_PATH_CACHE_FILE    "rofi.runpathcache"
+/**
+ * Size of a single read of the run-list-command output.
+ */
+#define RUN_EXTERNAL_BUFFER    65536
+/**
+ * Number of reads done before returning to the main loop.
+ */
+#define RUN_EXTERNAL_READS     16
 
 /**
  * The internal data structure holding the private data of the Run Mode.
@@ -63,8 +81,110 @@ typedef struct
     char         **cmd_list;
     /** Length of the #cmd_list. */
     unsigned int cmd_list_length;
+    /** Mapping of the executable cache, entries in #cmd_list can point into it. */
+    char         *cache_map;
+    /** Size of #cache_map. */
+    size_t       cache_map_size;
+    /** Allocated size of #cmd_list. */
+    unsigned int cmd_list_size;
+    /** Number of history entries at the start of #cmd_list. */
+    unsigned int num_favorites;
+    /** Output of the run-list-command while it is being read, -1 otherwise. */
+    int          external_fd;
+    /** Source watching #external_fd. */
+    guint        external_watch;
+    /** Incomplete last line read from #external_fd. */
+    GString      *external_line;
+    /** The history entries, lower case, used to drop duplicates from the external list. */
+    GHashTable   *external_favorites;
+    /** The other entries in #cmd_list, used to drop duplicates from the external list. */
+    GHashTable   *external_seen;
 } RunModePrivateData;
 
+/**
+ * Magic and version of the executable cache file.
+ */
+#define RUN_PATH_CACHE_MAGIC      "RRUN"
+#define RUN_PATH_CACHE_VERSION    1
+
+/**
+ * Header of the executable cache file.
+ * It is followed by the directory records, the per directory name table, the merged name table
+ * and the string area. Tables hold offsets into the string area.
+ */
+typedef struct
+{
+    char     magic[4];
+    uint32_t version;
+    uint32_t num_dirs;
+    uint32_t num_dir_names;
+    uint32_t num_merged;
+    uint32_t pad;
+    uint64_t strings_size;
+} RunPathCacheHeader;
+
+/**
+ * A PATH directory in the executable cache file.
+ */
+typedef struct
+{
+    uint64_t dev;
+    uint64_t ino;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    /** Offset of the directory name in the string area. */
+    uint32_t path;
+    /** Index of the first name in the per directory name table. */
+    uint32_t first_name;
+    uint32_t num_names;
+    uint32_t pad;
+} RunPathCacheDir;
+
+/**
+ * A mapped executable cache file.
+ */
+typedef struct
+{
+    char                     *map;
+    size_t                   size;
+    const RunPathCacheHeader *header;
+    const RunPathCacheDir    *dirs;
+    const uint32_t           *dir_names;
+    const uint32_t           *merged;
+    const char               *strings;
+} RunPathCache;
+
+/**
+ * A directory in PATH.
+ */
+typedef struct
+{
+    /** The directory name, as found in PATH. */
+    const char   *path;
+    /** Set when stat succeeded. */
+    int          valid;
+    struct stat  st;
+    /** Sorted list of executables in the directory. */
+    char         **names;
+    unsigned int num_names;
+    /** Set when names are read from disk, the strings are owned. */
+    int          scanned;
+    /** Set when the directory is in the home directory, files are checked for being executable. */
+    int          is_homedir;
+} RunPathDir;
+
+
+/**
+ * @param pd The run mode private data.
+ * @param entry The entry to check.
+ *
+ * @returns TRUE when entry points into the executable cache mapping (and should not be freed).
+ */
+static inline int run_is_cached_entry ( const RunModePrivateData *pd, const char *entry )
+{
+    return pd->cache_map != NULL && entry >= pd->cache_map && entry < ( pd->cache_map + pd->cache_map_size );
+}
+
 /**
  * @param cmd The cmd to execute
  * @param run_in_term Indicate if command should be run in a terminal
@@ -85,7 +205,7 @@ static inline int execsh ( const char *cmd, int run_in_term )
         helper_parse_setup ( config.run_command, &args, &argc, "{cmd}", cmd, NULL );
     }
     GError *error = NULL;
-    g_spawn_async ( NULL, args, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error );
+    helper_spawn ( args, &error );
     if ( error != NULL ) {
         char *msg = g_strdup_printf ( "Failed to execute: '%s'\nError: '%s'", cmd, error->message );
         rofi_view_error_dialog ( msg, FALSE  );
@@ -122,12 +242,11 @@ static void exec_cmd ( const char *cmd, int run_in_term )
 
     if (  execsh ( lf_cmd, run_in_term ) ) {
         /**
-         * This happens in non-critical time (After launching app)
-         * It is allowed to be a bit slower.
+         * The app is launched, write the history in the background while rofi closes.
          */
         char *path = g_build_filename ( cache_dir, RUN_CACHE_FILE, NULL );
 
-        history_set ( path, cmd );
+        history_set_deferred ( path, cmd );
 
         g_free ( path );
     }
@@ -170,63 +289,594 @@ static int sort_func ( const void *a, const void *b, void *data __attribute__( (
     else if ( bstr == NULL ) {
         return -1;
     }
-    return g_ascii_strcasecmp ( astr, bstr );
+    int retv = g_ascii_strcasecmp ( astr, bstr );
+    // Keep entries that only differ in case apart, so exact duplicates end up next to each other.
+    if ( retv == 0 ) {
+        retv = strcmp ( astr, bstr );
+    }
+    return retv;
 }
 
 /**
- * External spider to get list of executables.
+ * @param pd The run mode private data.
+ * @param entry The entry to append, absorbed.
+ *
+ * Append an entry to the command list, growing it geometrically.
  */
-static char ** get_apps_external ( char **retv, unsigned int *length, unsigned int num_favorites )
+static void run_cmd_list_append ( RunModePrivateData *pd, char *entry )
 {
-    int fd = execute_generator ( config.run_list_command );
-    if ( fd >= 0 ) {
-        FILE *inp = fdopen ( fd, "r" );
-        if ( inp ) {
-            char   *buffer       = NULL;
-            size_t buffer_length = 0;
-
-            while ( getline ( &buffer, &buffer_length, inp ) > 0 ) {
-                int found = 0;
-                // Filter out line-end.
-                if ( buffer[strlen ( buffer ) - 1] == '\n' ) {
-                    buffer[strlen ( buffer ) - 1] = '\0';
-                }
+    if ( ( pd->cmd_list_length + 1 ) >= pd->cmd_list_size ) {
+        pd->cmd_list_size = MAX ( 64, pd->cmd_list_size * 2 );
+        pd->cmd_list      = g_realloc_n ( pd->cmd_list, pd->cmd_list_size, sizeof ( char* ) );
+    }
+    pd->cmd_list[pd->cmd_list_length++] = entry;
+    pd->cmd_list[pd->cmd_list_length]   = NULL;
+}
 
-                // This is a nice little penalty, but doable? time will tell.
-                // given num_favorites is max 25.
-                for ( unsigned int j = 0; found == 0 && j < num_favorites; j++ ) {
-                    if ( strcasecmp ( buffer, retv[j] ) == 0 ) {
-                        found = 1;
-                    }
-                }
+/**
+ * @param pd The run mode private data.
+ * @param line A line of the run-list-command output, without newline.
+ *
+ * Add the line to the command list, unless it is already in there.
+ */
+static void run_external_add_line ( RunModePrivateData *pd, const char *line )
+{
+    if ( line[0] == '\0' ) {
+        return;
+    }
+    char     *lower = g_ascii_strdown ( line, -1 );
+    gboolean found  = g_hash_table_contains ( pd->external_favorites, lower ) ||
+                      g_hash_table_contains ( pd->external_seen, line );
+    g_free ( lower );
+    if ( found ) {
+        return;
+    }
+    char *entry = g_strdup ( line );
+    run_cmd_list_append ( pd, entry );
+    g_hash_table_add ( pd->external_seen, entry );
+}
 
-                if ( found == 1 ) {
-                    continue;
-                }
+/**
+ * @param pd The run mode private data.
+ * @param data The data read.
+ * @param length The length of data.
+ *
+ * Split the data in lines and add them, keeping the trailing partial line for the next read.
+ */
+static void run_external_feed ( RunModePrivateData *pd, const char *data, size_t length )
+{
+    const char *end = data + length;
+    while ( data < end ) {
+        const char *nl = memchr ( data, '\n', end - data );
+        if ( nl == NULL ) {
+            g_string_append_len ( pd->external_line, data, end - data );
+            return;
+        }
+        if ( pd->external_line->len > 0 ) {
+            g_string_append_len ( pd->external_line, data, nl - data );
+            run_external_add_line ( pd, pd->external_line->str );
+            g_string_truncate ( pd->external_line, 0 );
+        }
+        else {
+            char *line = g_strndup ( data, nl - data );
+            run_external_add_line ( pd, line );
+            g_free ( line );
+        }
+        data = nl + 1;
+    }
+}
+
+/**
+ * @param pd The run mode private data.
+ *
+ * Stop reading the run-list-command output and free the bookkeeping.
+ */
+static void run_external_stop ( RunModePrivateData *pd )
+{
+    if ( pd->external_watch > 0 ) {
+        g_source_remove ( pd->external_watch );
+        pd->external_watch = 0;
+    }
+    if ( pd->external_fd >= 0 ) {
+        if ( close ( pd->external_fd ) != 0 ) {
+            fprintf ( stderr, "Failed to close stdout off executor script: '%s'\n",
+                      strerror ( errno ) );
+        }
+        pd->external_fd = -1;
+    }
+    if ( pd->external_line != NULL ) {
+        g_string_free ( pd->external_line, TRUE );
+        pd->external_line = NULL;
+    }
+    if ( pd->external_favorites != NULL ) {
+        g_hash_table_destroy ( pd->external_favorites );
+        pd->external_favorites = NULL;
+    }
+    if ( pd->external_seen != NULL ) {
+        g_hash_table_destroy ( pd->external_seen );
+        pd->external_seen = NULL;
+    }
+}
+
+/**
+ * @param pd The run mode private data.
+ * @param max_reads The maximum number of reads to do, 0 for no limit.
+ *
+ * Read from the run-list-command output until it would block, max_reads is hit or the end is reached.
+ * At the end the last line is added and reading is stopped.
+ */
+static void run_external_read ( RunModePrivateData *pd, unsigned int max_reads )
+{
+    char buffer[RUN_EXTERNAL_BUFFER];
+    for ( unsigned int i = 0; max_reads == 0 || i < max_reads; i++ ) {
+        ssize_t r = read ( pd->external_fd, buffer, sizeof ( buffer ) );
+        if ( r < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( r < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+            return;
+        }
+        if ( r < 0 ) {
+            fprintf ( stderr, "Failed to read output of run-list-command: '%s'\n", strerror ( errno ) );
+        }
+        if ( r <= 0 ) {
+            if ( pd->external_line->len > 0 ) {
+                run_external_add_line ( pd, pd->external_line->str );
+            }
+            run_external_stop ( pd );
+            return;
+        }
+        run_external_feed ( pd, buffer, r );
+    }
+}
+
+/**
+ * @param fd The output of the run-list-command.
+ * @param condition The condition that triggered.
+ * @param user_data The run mode.
+ *
+ * Read what is available from the run-list-command and show the new entries.
+ *
+ * @returns G_SOURCE_REMOVE when all output is read.
+ */
+static gboolean run_external_dispatch ( G_GNUC_UNUSED gint fd, G_GNUC_UNUSED GIOCondition condition, gpointer user_data )
+{
+    Mode               *sw        = (Mode *) user_data;
+    RunModePrivateData *pd        = (RunModePrivateData *) sw->private_data;
+    unsigned int       old_length = pd->cmd_list_length;
+    gboolean           retv       = G_SOURCE_CONTINUE;
+
+    // Hand control back to the main loop every few reads, so the UI stays responsive.
+    run_external_read ( pd, RUN_EXTERNAL_READS );
+    if ( pd->external_fd < 0 ) {
+        // The watch is removed by returning G_SOURCE_REMOVE.
+        retv = G_SOURCE_REMOVE;
+    }
+    if ( pd->cmd_list_length > old_length ) {
+        RofiViewState *state = rofi_view_get_active ();
+        if ( state != NULL && rofi_view_get_mode ( state ) == sw ) {
+            rofi_view_reload_appended ( state );
+        }
+    }
+    return retv;
+}
+
+/**
+ * @param sw The run mode.
+ *
+ * Start the run-list-command and read its output from the main loop, so the entries
+ * show up while the window is already shown.
+ */
+static void run_external_start ( Mode *sw )
+{
+    RunModePrivateData *pd = (RunModePrivateData *) sw->private_data;
+    pd->external_fd = execute_generator ( config.run_list_command );
+    if ( pd->external_fd < 0 ) {
+        return;
+    }
+    g_unix_set_fd_nonblocking ( pd->external_fd, TRUE, NULL );
+    pd->external_line      = g_string_new ( NULL );
+    pd->external_favorites = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, NULL );
+    pd->external_seen      = g_hash_table_new ( g_str_hash, g_str_equal );
+    for ( unsigned int i = 0; i < pd->cmd_list_length; i++ ) {
+        if ( i < pd->num_favorites ) {
+            g_hash_table_add ( pd->external_favorites, g_ascii_strdown ( pd->cmd_list[i], -1 ) );
+        }
+        else {
+            g_hash_table_add ( pd->external_seen, pd->cmd_list[i] );
+        }
+    }
+    pd->external_watch = g_unix_fd_add ( pd->external_fd, G_IO_IN | G_IO_HUP | G_IO_ERR, run_external_dispatch, sw );
+}
 
-                // No duplicate, add it.
-                retv              = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                retv[( *length )] = g_strdup ( buffer );
+void run_mode_wait_external ( Mode *sw )
+{
+    RunModePrivateData *pd = (RunModePrivateData *) sw->private_data;
+    if ( pd == NULL || pd->external_fd < 0 ) {
+        return;
+    }
+    g_source_remove ( pd->external_watch );
+    pd->external_watch = 0;
+    g_unix_set_fd_nonblocking ( pd->external_fd, FALSE, NULL );
+    run_external_read ( pd, 0 );
+}
+
+/**
+ * @param list The list to sort.
+ * @param length The length of the list, updated.
+ *
+ * Sort the list and remove (and free) duplicate entries.
+ */
+static void run_sort_unique ( char **list, unsigned int *length )
+{
+    if ( ( *length ) < 2 ) {
+        return;
+    }
+    g_qsort_with_data ( list, ( *length ), sizeof ( char* ), sort_func, NULL );
+    unsigned int j = 0;
+    for ( unsigned int i = 1; i < ( *length ); i++ ) {
+        if ( strcmp ( list[j], list[i] ) == 0 ) {
+            g_free ( list[i] );
+            continue;
+        }
+        list[++j] = list[i];
+    }
+    ( *length ) = j + 1;
+}
 
-                ( *length )++;
+/**
+ * @param dirname The directory to scan.
+ * @param is_homedir If the files should be checked for being executable.
+ * @param length Set to the number of names found.
+ *
+ * Get the executables in dirname.
+ *
+ * @returns a sorted list of unique names.
+ */
+static char **run_scan_dir ( const char *dirname, gboolean is_homedir, unsigned int *length )
+{
+    GError       *error = NULL;
+    char         **retv = NULL;
+    unsigned int size   = 0;
+    *length = 0;
+    DIR          *dir = opendir ( dirname );
+    if ( dir == NULL ) {
+        return NULL;
+    }
+    // Full paths of the candidates, to check if they are executable.
+    GPtrArray *paths = is_homedir ? g_ptr_array_new_with_free_func ( g_free ) : NULL;
+    struct dirent *dent;
+    while ( ( dent = readdir ( dir ) ) != NULL ) {
+        if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
+            continue;
+        }
+        // Skip dot files.
+        if ( dent->d_name[0] == '.' ) {
+            continue;
+        }
+        gsize name_len;
+        gchar *name = g_filename_to_utf8 ( dent->d_name, -1, NULL, &name_len, &error );
+        if ( error != NULL ) {
+            fprintf ( stderr, "Failed to convert filename to UTF-8: %s\n", error->message );
+            g_clear_error ( &error );
+            g_free ( name );
+            continue;
+        }
+        if ( ( *length ) >= size ) {
+            size = size ? size * 2 : 64;
+            retv = g_realloc ( retv, size * sizeof ( char* ) );
+        }
+        retv[( *length )++] = name;
+        if ( is_homedir ) {
+            g_ptr_array_add ( paths, g_build_filename ( dirname, dent->d_name, NULL ) );
+        }
+    }
+    closedir ( dir );
+    if ( is_homedir ) {
+        // Stat all candidates in one batch, instead of an access () call per file.
+        IOBatchRequest *reqs = g_malloc0_n ( paths->len, sizeof ( IOBatchRequest ) );
+        for ( unsigned int i = 0; i < paths->len; i++ ) {
+            reqs[i].path = g_ptr_array_index ( paths, i );
+        }
+        io_batch_stat ( reqs, paths->len );
+        unsigned int j = 0;
+        for ( unsigned int i = 0; i < ( *length ); i++ ) {
+            if ( io_batch_is_executable ( &( reqs[i] ) ) ) {
+                retv[j++] = retv[i];
             }
-            if ( buffer != NULL ) {
-                free ( buffer );
+            else {
+                g_free ( retv[i] );
             }
-            if ( fclose ( inp ) != 0 ) {
-                fprintf ( stderr, "Failed to close stdout off executor script: '%s'\n",
-                          strerror ( errno ) );
+        }
+        ( *length ) = j;
+        g_free ( reqs );
+        g_ptr_array_free ( paths, TRUE );
+    }
+    run_sort_unique ( retv, length );
+    return retv;
+}
+
+/**
+ * @param t The job, priv points to the RunPathDir to scan.
+ * @param user_data Unused.
+ *
+ * Thread pool job reading one PATH directory.
+ */
+static void run_scan_dir_job ( thread_state *t, G_GNUC_UNUSED gpointer user_data )
+{
+    RunPathDir *dir = (RunPathDir *) t->priv;
+    dir->names = run_scan_dir ( dir->path, dir->is_homedir, &( dir->num_names ) );
+}
+
+/**
+ * @param dirs The PATH directories, each with a sorted list of names.
+ * @param num_dirs The number of directories.
+ * @param length Set to the length of the merged list.
+ *
+ * Merge the sorted lists of the directories into one sorted list without duplicates.
+ *
+ * @returns the merged list, the strings are not copied.
+ */
+static char **run_merge_dirs ( const RunPathDir *dirs, unsigned int num_dirs, unsigned int *length )
+{
+    unsigned int total = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        total += dirs[i].num_names;
+    }
+    char         **retv = g_malloc_n ( total + 1, sizeof ( char* ) );
+    unsigned int pos[num_dirs + 1];
+    memset ( pos, 0, sizeof ( pos ) );
+    *length = 0;
+    while ( TRUE ) {
+        // Pick the smallest head, PATH has few directories so a linear scan is fine.
+        int min = -1;
+        for ( unsigned int i = 0; i < num_dirs; i++ ) {
+            if ( pos[i] < dirs[i].num_names &&
+                 ( min < 0 || sort_func ( &( dirs[i].names[pos[i]] ), &( dirs[min].names[pos[min]] ), NULL ) < 0 ) ) {
+                min = i;
             }
         }
+        if ( min < 0 ) {
+            break;
+        }
+        char *name = dirs[min].names[pos[min]++];
+        if ( ( *length ) == 0 || strcmp ( retv[( *length ) - 1], name ) != 0 ) {
+            retv[( *length )++] = name;
+        }
+    }
+    retv[( *length )] = NULL;
+    return retv;
+}
+
+/**
+ * @param cache The cache to fill in.
+ * @param filename The cache file.
+ *
+ * Map and validate the executable cache file.
+ *
+ * @returns TRUE when the cache was loaded.
+ */
+static int run_path_cache_load ( RunPathCache *cache, const char *filename )
+{
+    struct stat st;
+    memset ( cache, 0, sizeof ( *cache ) );
+    int         fd = open ( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        return FALSE;
+    }
+    if ( fstat ( fd, &st ) != 0 || (size_t) st.st_size < sizeof ( RunPathCacheHeader ) ) {
+        close ( fd );
+        return FALSE;
+    }
+    char *map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close ( fd );
+    if ( map == MAP_FAILED ) {
+        return FALSE;
+    }
+    cache->map    = map;
+    cache->size   = st.st_size;
+    cache->header = (const RunPathCacheHeader *) map;
+
+    const RunPathCacheHeader *h = cache->header;
+    uint64_t                 expected = sizeof ( RunPathCacheHeader ) + (uint64_t) h->num_dirs * sizeof ( RunPathCacheDir ) +
+                                        ( (uint64_t) h->num_dir_names + h->num_merged ) * sizeof ( uint32_t ) + h->strings_size;
+    if ( memcmp ( h->magic, RUN_PATH_CACHE_MAGIC, 4 ) != 0 || h->version != RUN_PATH_CACHE_VERSION ||
+         expected != cache->size || h->strings_size == 0 ) {
+        goto invalid;
+    }
+    cache->dirs      = (const RunPathCacheDir *) ( map + sizeof ( RunPathCacheHeader ) );
+    cache->dir_names = (const uint32_t *) ( cache->dirs + h->num_dirs );
+    cache->merged    = cache->dir_names + h->num_dir_names;
+    cache->strings   = (const char *) ( cache->merged + h->num_merged );
+    if ( cache->strings[h->strings_size - 1] != '\0' ) {
+        goto invalid;
+    }
+    for ( uint32_t i = 0; i < h->num_dirs; i++ ) {
+        if ( cache->dirs[i].path >= h->strings_size ||
+             (uint64_t) cache->dirs[i].first_name + cache->dirs[i].num_names > h->num_dir_names ) {
+            goto invalid;
+        }
+    }
+    for ( uint32_t i = 0; i < ( h->num_dir_names + h->num_merged ); i++ ) {
+        if ( cache->dir_names[i] >= h->strings_size ) {
+            goto invalid;
+        }
+    }
+    return TRUE;
+invalid:
+    fprintf ( stderr, "Ignoring invalid executable cache: %s\n", filename );
+    munmap ( map, cache->size );
+    memset ( cache, 0, sizeof ( *cache ) );
+    return FALSE;
+}
+
+/**
+ * @param cache The cache to free.
+ *
+ * Unmap the cache file.
+ */
+static void run_path_cache_free ( RunPathCache *cache )
+{
+    if ( cache->map != NULL ) {
+        munmap ( cache->map, cache->size );
+    }
+    memset ( cache, 0, sizeof ( *cache ) );
+}
+
+/**
+ * @param cache The cache.
+ * @param index The position of the directory in PATH.
+ * @param dir The directory.
+ *
+ * Find the (still valid) cached entry of a PATH directory.
+ *
+ * @returns the cached directory or NULL when it has to be rescanned.
+ */
+static const RunPathCacheDir *run_path_cache_find ( const RunPathCache *cache, unsigned int index, const RunPathDir *dir )
+{
+    const RunPathCacheDir *cd = NULL;
+    if ( cache->map == NULL ) {
+        return NULL;
+    }
+    if ( index < cache->header->num_dirs && strcmp ( cache->strings + cache->dirs[index].path, dir->path ) == 0 ) {
+        cd = &( cache->dirs[index] );
+    }
+    for ( uint32_t i = 0; cd == NULL && i < cache->header->num_dirs; i++ ) {
+        if ( strcmp ( cache->strings + cache->dirs[i].path, dir->path ) == 0 ) {
+            cd = &( cache->dirs[i] );
+        }
+    }
+    if ( cd == NULL ) {
+        return NULL;
+    }
+    if ( !dir->valid ) {
+        return cd->mtime_sec == -1 ? cd : NULL;
+    }
+    if ( cd->dev != (uint64_t) dir->st.st_dev || cd->ino != (uint64_t) dir->st.st_ino ||
+         cd->mtime_sec != (int64_t) dir->st.st_mtim.tv_sec || cd->mtime_nsec != (int64_t) dir->st.st_mtim.tv_nsec ) {
+        return NULL;
+    }
+    return cd;
+}
+
+/**
+ * @param strings The string area.
+ * @param offsets Table mapping strings to their offset + 1.
+ * @param str The string to add.
+ *
+ * @returns the offset of str in the string area.
+ */
+static uint32_t run_path_cache_add_string ( GString *strings, GHashTable *offsets, const char *str )
+{
+    gpointer value = g_hash_table_lookup ( offsets, str );
+    if ( value != NULL ) {
+        return GPOINTER_TO_UINT ( value ) - 1;
+    }
+    uint32_t offset = strings->len;
+    g_string_append_len ( strings, str, strlen ( str ) + 1 );
+    g_hash_table_insert ( offsets, (gpointer) str, GUINT_TO_POINTER ( offset + 1 ) );
+    return offset;
+}
+
+/**
+ * @param filename The cache file.
+ * @param dirs The PATH directories.
+ * @param num_dirs The number of directories.
+ * @param merged The merged list of executables.
+ * @param num_merged The length of the merged list.
+ *
+ * Write the executable cache file, the file is replaced atomically.
+ *
+ * @returns TRUE when the cache was written.
+ */
+static int run_path_cache_write ( const char *filename, const RunPathDir *dirs, unsigned int num_dirs, char **merged, unsigned int num_merged )
+{
+    GHashTable         *offsets   = g_hash_table_new ( g_str_hash, g_str_equal );
+    GString            *strings   = g_string_sized_new ( 65536 );
+    RunPathCacheDir    *cdirs     = g_malloc0_n ( num_dirs + 1, sizeof ( RunPathCacheDir ) );
+    unsigned int       num_names  = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        num_names += dirs[i].num_names;
+    }
+    uint32_t           *dir_names = g_malloc_n ( num_names + num_merged + 1, sizeof ( uint32_t ) );
+    uint32_t           *cmerged   = dir_names + num_names;
+    unsigned int       n          = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        cdirs[i].path       = run_path_cache_add_string ( strings, offsets, dirs[i].path );
+        cdirs[i].first_name = n;
+        cdirs[i].num_names  = dirs[i].num_names;
+        if ( dirs[i].valid ) {
+            cdirs[i].dev        = dirs[i].st.st_dev;
+            cdirs[i].ino        = dirs[i].st.st_ino;
+            cdirs[i].mtime_sec  = dirs[i].st.st_mtim.tv_sec;
+            cdirs[i].mtime_nsec = dirs[i].st.st_mtim.tv_nsec;
+        }
+        else {
+            cdirs[i].mtime_sec = -1;
+        }
+        for ( unsigned int j = 0; j < dirs[i].num_names; j++ ) {
+            dir_names[n++] = run_path_cache_add_string ( strings, offsets, dirs[i].names[j] );
+        }
+    }
+    for ( unsigned int i = 0; i < num_merged; i++ ) {
+        cmerged[i] = run_path_cache_add_string ( strings, offsets, merged[i] );
+    }
+    if ( strings->len == 0 ) {
+        g_string_append_c ( strings, '\0' );
+    }
+
+    RunPathCacheHeader header;
+    memset ( &header, 0, sizeof ( header ) );
+    memcpy ( header.magic, RUN_PATH_CACHE_MAGIC, 4 );
+    header.version       = RUN_PATH_CACHE_VERSION;
+    header.num_dirs      = num_dirs;
+    header.num_dir_names = num_names;
+    header.num_merged    = num_merged;
+    header.strings_size  = strings->len;
+
+    int  retv     = FALSE;
+    char *tmpname = g_strdup_printf ( "%s.XXXXXX", filename );
+    int  fd       = g_mkstemp ( tmpname );
+    if ( fd >= 0 ) {
+        FILE *fp = fdopen ( fd, "w" );
+        if ( fp != NULL ) {
+            int ok = fwrite ( &header, sizeof ( header ), 1, fp ) == 1;
+            ok = ok && ( num_dirs == 0 || fwrite ( cdirs, sizeof ( RunPathCacheDir ), num_dirs, fp ) == num_dirs );
+            ok = ok && ( ( num_names + num_merged ) == 0 ||
+                         fwrite ( dir_names, sizeof ( uint32_t ), num_names + num_merged, fp ) == ( num_names + num_merged ) );
+            ok = ok && fwrite ( strings->str, 1, strings->len, fp ) == strings->len;
+            ok = ( fclose ( fp ) == 0 ) && ok;
+            retv = ok && rename ( tmpname, filename ) == 0;
+        }
+        else {
+            close ( fd );
+        }
+        if ( !retv ) {
+            fprintf ( stderr, "Failed to write executable cache: %s: %s\n", filename, strerror ( errno ) );
+            unlink ( tmpname );
+        }
     }
-    retv[( *length ) ] = NULL;
+    g_free ( tmpname );
+    g_free ( dir_names );
+    g_free ( cdirs );
+    g_string_free ( strings, TRUE );
+    g_hash_table_destroy ( offsets );
     return retv;
 }
 
 /**
- * Internal spider used to get list of executables.
+ * @param pd The run mode private data, the cache mapping is kept there.
+ * @param length Set to the length of the returned list.
+ *
+ * Get the executables in PATH, plus the history entries in front.
+ * The PATH directories are cached in RUN_PATH_CACHE_FILE, only directories whose mtime changed are re-read.
+ * Entries after the favorites point into the cache mapping where possible.
+ * Note that for directories in the home directory, a change of executable bit is only noticed
+ * when the directory changes.
+ *
+ * @returns the list of commands.
  */
-static char ** get_apps ( unsigned int *length )
+static char ** get_apps ( RunModePrivateData *pd, unsigned int *length )
 {
     GError       *error        = NULL;
     char         **retv        = NULL;
@@ -251,105 +901,144 @@ static char ** get_apps ( unsigned int *length )
         fprintf ( stderr, "Failed to convert homedir to UTF-8: %s\n", error->message );
         g_clear_error ( &error );
         g_free ( homedir );
-        return NULL;
+        g_free ( path );
+        return retv;
     }
+    // Set of the favorites, so they can be dropped from the rest of the list.
+    GHashTable *favorites = history_index ( retv, num_favorites );
 
-    const char *const sep = ":";
+    RunPathDir       *dirs    = NULL;
+    unsigned int     num_dirs = 0;
+    const char *const sep     = ":";
     for ( const char *dirname = strtok ( path, sep ); dirname != NULL; dirname = strtok ( NULL, sep ) ) {
-        DIR *dir = opendir ( dirname );
-
-        if ( dir != NULL ) {
-            struct dirent *dent;
-            gsize         dirn_len = 0;
-            gchar         *dirn    = g_locale_to_utf8 ( dirname, -1, NULL, &dirn_len, &error );
-            if ( error != NULL ) {
-                fprintf ( stderr, "Failed to convert directory name to UTF-8: %s\n", error->message );
-                g_clear_error ( &error );
-                continue;
-            }
-            gboolean is_homedir = g_str_has_prefix ( dirn, homedir );
-            g_free ( dirn );
-
-            while ( ( dent = readdir ( dir ) ) != NULL ) {
-                if ( dent->d_type != DT_REG && dent->d_type != DT_LNK && dent->d_type != DT_UNKNOWN ) {
-                    continue;
-                }
-                // Skip dot files.
-                if ( dent->d_name[0] == '.' ) {
-                    continue;
-                }
-                if ( is_homedir ) {
-                    gchar    *fpath = g_build_filename ( dirname, dent->d_name, NULL );
-                    gboolean b      = g_file_test ( fpath, G_FILE_TEST_IS_EXECUTABLE );
-                    g_free ( fpath );
-                    if ( !b ) {
-                        continue;
-                    }
-                }
-
-                gsize name_len;
-                gchar *name = g_filename_to_utf8 ( dent->d_name, -1, NULL, &name_len, &error );
-                if ( error != NULL ) {
-                    fprintf ( stderr, "Failed to convert filename to UTF-8: %s\n", error->message );
-                    g_clear_error ( &error );
-                    g_free ( name );
-                    continue;
-                }
-                // This is a nice little penalty, but doable? time will tell.
-                // given num_favorites is max 25.
-                int found = 0;
-                for ( unsigned int j = 0; found == 0 && j < num_favorites; j++ ) {
-                    if ( g_strcmp0 ( name, retv[j] ) == 0 ) {
-                        found = 1;
-                    }
-                }
-
-                if ( found == 1 ) {
-                    continue;
-                }
+        dirs = g_realloc ( dirs, ( num_dirs + 1 ) * sizeof ( RunPathDir ) );
+        memset ( &( dirs[num_dirs] ), 0, sizeof ( RunPathDir ) );
+        dirs[num_dirs].path  = dirname;
+        dirs[num_dirs].valid = ( stat ( dirname, &( dirs[num_dirs].st ) ) == 0 && S_ISDIR ( dirs[num_dirs].st.st_mode ) );
+        num_dirs++;
+    }
+    TICK_N ( "stat path" );
 
-                retv                  = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                retv[( *length )]     = name;
-                retv[( *length ) + 1] = NULL;
-                ( *length )++;
+    char         *cache_path = g_build_filename ( cache_dir, RUN_PATH_CACHE_FILE, NULL );
+    RunPathCache cache;
+    run_path_cache_load ( &cache, cache_path );
+    int          cache_hit = ( cache.map != NULL && cache.header->num_dirs == num_dirs );
+    unsigned int num_scan  = 0;
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        const RunPathCacheDir *cd = run_path_cache_find ( &cache, i, &( dirs[i] ) );
+        if ( cd != NULL ) {
+            if ( cd != &( cache.dirs[i] ) ) {
+                cache_hit = FALSE;
             }
-
-            closedir ( dir );
+            dirs[i].num_names = cd->num_names;
+            dirs[i].names     = g_malloc_n ( cd->num_names + 1, sizeof ( char* ) );
+            for ( uint32_t j = 0; j < cd->num_names; j++ ) {
+                dirs[i].names[j] = (char *) ( cache.strings + cache.dir_names[cd->first_name + j] );
+            }
+            continue;
         }
+        cache_hit = FALSE;
+        if ( !dirs[i].valid ) {
+            continue;
+        }
+        gsize    dirn_len = 0;
+        gchar    *dirn    = g_locale_to_utf8 ( dirs[i].path, -1, NULL, &dirn_len, &error );
+        if ( error != NULL ) {
+            fprintf ( stderr, "Failed to convert directory name to UTF-8: %s\n", error->message );
+            g_clear_error ( &error );
+            continue;
+        }
+        dirs[i].is_homedir = g_str_has_prefix ( dirn, homedir );
+        dirs[i].scanned    = TRUE;
+        num_scan++;
+        g_free ( dirn );
     }
     g_free ( homedir );
-
-    // Get external apps.
-    if ( config.run_list_command != NULL && config.run_list_command[0] != '\0' ) {
-        retv = get_apps_external ( retv, length, num_favorites );
+    if ( num_scan > 0 ) {
+        // Read the changed directories in parallel, one job per directory.
+        thread_state states[num_scan];
+        unsigned int n = 0;
+        for ( unsigned int i = 0; i < num_dirs; i++ ) {
+            if ( dirs[i].scanned ) {
+                memset ( &( states[n] ), 0, sizeof ( thread_state ) );
+                states[n].priv     = &( dirs[i] );
+                states[n].callback = run_scan_dir_job;
+                n++;
+            }
+        }
+        rofi_view_run_jobs ( states, num_scan );
     }
-    // No sorting needed.
-    if ( ( *length ) == 0 ) {
-        return retv;
+    TICK_N ( "scan path" );
+
+    if ( !cache_hit ) {
+        // Merge the directories, write a new cache and use that.
+        unsigned int num_merged = 0;
+        char         **merged   = run_merge_dirs ( dirs, num_dirs, &num_merged );
+        RunPathCache new_cache;
+        if ( !run_path_cache_write ( cache_path, dirs, num_dirs, merged, num_merged ) ||
+             !run_path_cache_load ( &new_cache, cache_path ) ) {
+            // No cache, keep copies of the names.
+            for ( unsigned int i = 0; i < num_merged; i++ ) {
+                merged[i] = g_strdup ( merged[i] );
+            }
+            memset ( &new_cache, 0, sizeof ( new_cache ) );
+        }
+        for ( unsigned int i = 0; i < num_dirs; i++ ) {
+            if ( dirs[i].scanned ) {
+                for ( unsigned int j = 0; j < dirs[i].num_names; j++ ) {
+                    g_free ( dirs[i].names[j] );
+                }
+            }
+        }
+        run_path_cache_free ( &cache );
+        cache = new_cache;
+        if ( cache.map == NULL ) {
+            retv = g_realloc ( retv, ( ( *length ) + num_merged + 1 ) * sizeof ( char* ) );
+            for ( unsigned int i = 0; i < num_merged; i++ ) {
+                retv[( *length )++] = merged[i];
+            }
+            retv[( *length )] = NULL;
+        }
+        g_free ( merged );
+        TICK_N ( "write cache" );
     }
-    // TODO: check this is still fast enough. (takes 1ms on laptop.)
-    if ( ( *length ) > num_favorites ) {
-        g_qsort_with_data ( &retv[num_favorites], ( *length ) - num_favorites, sizeof ( char* ), sort_func, NULL );
+    for ( unsigned int i = 0; i < num_dirs; i++ ) {
+        g_free ( dirs[i].names );
     }
+    g_free ( dirs );
+    g_free ( cache_path );
     g_free ( path );
 
-    unsigned int removed = 0;
-    for ( unsigned int index = num_favorites; index < ( ( *length ) - 1 ); index++ ) {
-        if ( g_strcmp0 ( retv[index], retv[index + 1] ) == 0 ) {
-            g_free ( retv[index] );
-            retv[index] = NULL;
-            removed++;
+    if ( cache.map != NULL ) {
+        retv = g_realloc ( retv, ( ( *length ) + cache.header->num_merged + 1 ) * sizeof ( char* ) );
+        for ( uint32_t i = 0; i < cache.header->num_merged; i++ ) {
+            char *name = (char *) ( cache.strings + cache.merged[i] );
+            if ( !g_hash_table_contains ( favorites, name ) ) {
+                retv[( *length )++] = name;
+            }
         }
+        retv[( *length )] = NULL;
+        pd->cache_map      = cache.map;
+        pd->cache_map_size = cache.size;
     }
-
-    if ( ( *length ) > num_favorites ) {
-        g_qsort_with_data ( &retv[num_favorites], ( *length ) - num_favorites, sizeof ( char* ),
-                            sort_func,
-                            NULL );
+    else {
+        // Without cache, drop the favorites from the list.
+        unsigned int j = num_favorites;
+        for ( unsigned int i = num_favorites; i < ( *length ); i++ ) {
+            if ( g_hash_table_contains ( favorites, retv[i] ) ) {
+                g_free ( retv[i] );
+                continue;
+            }
+            retv[j++] = retv[i];
+        }
+        ( *length ) = j;
+        if ( retv != NULL ) {
+            retv[( *length )] = NULL;
+        }
     }
-    // Reduce array length;
-    ( *length ) -= removed;
 
+    g_hash_table_destroy ( favorites );
+    pd->num_favorites = num_favorites;
     TICK_N ( "stop" );
     return retv;
 }
@@ -358,8 +1047,14 @@ static int run_mode_init ( Mode *sw )
 {
     if ( sw->private_data == NULL ) {
         RunModePrivateData *pd = g_malloc0 ( sizeof ( *pd ) );
-        sw->private_data = (void *) pd;
-        pd->cmd_list     = get_apps ( &( pd->cmd_list_length ) );
+        sw->private_data  = (void *) pd;
+        pd->external_fd   = -1;
+        pd->cmd_list      = get_apps ( pd, &( pd->cmd_list_length ) );
+        pd->cmd_list_size = pd->cmd_list ? ( pd->cmd_list_length + 1 ) : 0;
+        // Get external apps, these are appended while the window is shown.
+        if ( config.run_list_command != NULL && config.run_list_command[0] != '\0' ) {
+            run_external_start ( sw );
+        }
     }
 
     return TRUE;
@@ -368,7 +1063,16 @@ static void run_mode_destroy ( Mode *sw )
 {
     RunModePrivateData *rmpd = (RunModePrivateData *) sw->private_data;
     if ( rmpd != NULL ) {
-        g_strfreev ( rmpd->cmd_list );
+        run_external_stop ( rmpd );
+        for ( unsigned int i = 0; rmpd->cmd_list != NULL && i < rmpd->cmd_list_length; i++ ) {
+            if ( !run_is_cached_entry ( rmpd, rmpd->cmd_list[i] ) ) {
+                g_free ( rmpd->cmd_list[i] );
+            }
+        }
+        g_free ( rmpd->cmd_list );
+        if ( rmpd->cache_map != NULL ) {
+            munmap ( rmpd->cache_map, rmpd->cache_map_size );
+        }
         g_free ( rmpd );
         sw->private_data = NULL;
     }
@@ -41,23 +41,25 @@
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
 #include <helper.h>
 
 #include "rofi.h"
 #include "settings.h"
 #include "history.h"
+#include "ssh-hosts.h"
 #include "dialogs/ssh.h"
 
 /**
  * Name of the history file where previously choosen hosts are stored.
  */
-#define SSH_CACHE_FILE     "rofi-2.sshcache"
+#define SSH_CACHE_FILE           "rofi-2.sshcache"
 
 /**
- * Used in get_ssh() when splitting lines from the user's
- * SSH config file into tokens.
+ * Name of the cache file holding the hosts read from the ssh and hosts files.
  */
-#define SSH_TOKEN_DELIM    "= \t\r\n"
+#define SSH_HOSTS_CACHE_FILE     "rofi.sshhosts"
 
 /**
  * @param host The host to connect too
@@ -73,7 +75,7 @@ static inline int execshssh ( const char *host )
     helper_parse_setup ( config.ssh_command, &args, &argsv, "{host}", host, NULL );
 
     GError *error = NULL;
-    g_spawn_async ( NULL, args, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL, NULL, &error );
+    helper_spawn ( args, &error );
 
     if ( error != NULL ) {
         char *msg = g_strdup_printf ( "Failed to execute: 'ssh %s'\nError: '%s'", host, error->message );
@@ -106,10 +108,9 @@ static void exec_ssh ( const char *host )
         return;
     }
 
-    //  This happens in non-critical time (After launching app)
-    //  It is allowed to be a bit slower.
+    //  The app is launched, write the history in the background while rofi closes.
     char *path = g_build_filename ( cache_dir, SSH_CACHE_FILE, NULL );
-    history_set ( path, host );
+    history_set_deferred ( path, host );
     g_free ( path );
 }
 
@@ -128,233 +129,35 @@ static void delete_ssh ( const char *host )
     g_free ( path );
 }
 
-/**
- * @param retv list of hosts
- * @param length pointer to length of list [in][out]
- *
- * Read 'known_hosts' file when entries are not hashsed.
- *
- * @returns updated list of hosts.
- */
-static char **read_known_hosts_file ( char ** retv, unsigned int *length )
-{
-    char *path = g_build_filename ( g_getenv ( "HOME" ), ".ssh", "known_hosts", NULL );
-    FILE *fd   = fopen ( path, "r" );
-    if ( fd != NULL ) {
-        char   *buffer       = NULL;
-        size_t buffer_length = 0;
-        // Reading one line per time.
-        while ( getline ( &buffer, &buffer_length, fd ) > 0 ) {
-            char *sep = strstr ( buffer, "," );
-
-            if ( sep != NULL ) {
-                *sep = '\0';
-                // Is this host name already in the list?
-                // We often get duplicates in hosts file, so lets check this.
-                int found = 0;
-                for ( unsigned int j = 0; j < ( *length ); j++ ) {
-                    if ( !g_ascii_strcasecmp ( buffer, retv[j] ) ) {
-                        found = 1;
-                        break;
-                    }
-                }
-
-                if ( !found ) {
-                    // Add this host name to the list.
-                    retv                  = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                    retv[( *length )]     = g_strdup ( buffer );
-                    retv[( *length ) + 1] = NULL;
-                    ( *length )++;
-                }
-            }
-        }
-        if ( buffer != NULL ) {
-            free ( buffer );
-        }
-        if ( fclose ( fd ) != 0 ) {
-            fprintf ( stderr, "Failed to close hosts file: '%s'\n", strerror ( errno ) );
-        }
-    }
-
-    g_free ( path );
-    return retv;
-}
-
-/**
- * @param retv The list of hosts to update.
- * @param length The length of the list retv [in][out]
- *
- * Read `/etc/hosts` and appends them to the list retv
- *
- * @returns an updated list with the added hosts.
- */
-static char **read_hosts_file ( char ** retv, unsigned int *length )
-{
-    // Read the hosts file.
-    FILE *fd = fopen ( "/etc/hosts", "r" );
-    if ( fd != NULL ) {
-        char   *buffer       = NULL;
-        size_t buffer_length = 0;
-        // Reading one line per time.
-        while ( getline ( &buffer, &buffer_length, fd ) > 0 ) {
-            // Evaluate one line.
-            unsigned int index  = 0, ti = 0;
-            char         *token = buffer;
-
-            // Tokenize it.
-            do {
-                char c = buffer[index];
-                // Break on space, tab, newline and \0.
-                if ( c == ' ' || c == '\t' || c == '\n' || c == '\0' || c == '#' ) {
-                    buffer[index] = '\0';
-                    // Ignore empty tokens
-                    if ( token[0] != '\0' ) {
-                        ti++;
-                        // and first token.
-                        if ( ti > 1 ) {
-                            // Is this host name already in the list?
-                            // We often get duplicates in hosts file, so lets check this.
-                            int found = 0;
-                            for ( unsigned int j = 0; j < ( *length ); j++ ) {
-                                if ( !g_ascii_strcasecmp ( token, retv[j] ) ) {
-                                    found = 1;
-                                    break;
-                                }
-                            }
-
-                            if ( !found ) {
-                                // Add this host name to the list.
-                                retv = g_realloc ( retv,
-                                                   ( ( *length ) + 2 ) * sizeof ( char* ) );
-                                retv[( *length )]     = g_strdup ( token );
-                                retv[( *length ) + 1] = NULL;
-                                ( *length )++;
-                            }
-                        }
-                    }
-                    // Set start to next element.
-                    token = &buffer[index + 1];
-                    // Everything after comment ignore.
-                    if ( c == '#' ) {
-                        break;
-                    }
-                }
-                // Skip to the next entry.
-                index++;
-            } while ( buffer[index] != '\0' && buffer[index] != '#' );
-        }
-        if ( buffer != NULL ) {
-            free ( buffer );
-        }
-        if ( fclose ( fd ) != 0 ) {
-            fprintf ( stderr, "Failed to close hosts file: '%s'\n", strerror ( errno ) );
-        }
-    }
-
-    return retv;
-}
-
 /**
  * @param length The number of found ssh hosts [out]
  *
- * Gets the list available SSH hosts.
+ * Gets the list available SSH hosts, the hosts read from the ssh files are cached in SSH_HOSTS_CACHE_FILE.
  *
  * @return an array of strings containing all the hosts.
  */
 static char ** get_ssh (  unsigned int *length )
 {
-    char         **retv        = NULL;
-    unsigned int num_favorites = 0;
-    char         *path;
-
-    if ( getenv ( "HOME" ) == NULL ) {
+    const char *home = g_getenv ( "HOME" );
+    *length = 0;
+    if ( home == NULL ) {
         return NULL;
     }
-
-    path = g_build_filename ( cache_dir, SSH_CACHE_FILE, NULL );
-    retv = history_get_list ( path, length );
+    TICK_N ( "start" );
+    unsigned int flags       = ( config.parse_known_hosts == TRUE ? SSH_HOSTS_CACHE_PARSE_KNOWN_HOSTS : 0 ) |
+                               ( config.parse_hosts == TRUE ? SSH_HOSTS_CACHE_PARSE_HOSTS : 0 );
+    unsigned int num_hosts   = 0;
+    char         *cache_path = g_build_filename ( cache_dir, SSH_HOSTS_CACHE_FILE, NULL );
+    char         **hosts     = ssh_hosts_read ( home, cache_path, flags, &num_hosts, NULL );
+    g_free ( cache_path );
+    TICK_N ( "read hosts" );
+
+    // The favorites go in front.
+    char *path  = g_build_filename ( cache_dir, SSH_CACHE_FILE, NULL );
+    char **retv = history_get_list ( path, length );
     g_free ( path );
-    num_favorites = ( *length );
-
-    if ( config.parse_known_hosts == TRUE ) {
-        retv = read_known_hosts_file ( retv, length );
-    }
-    if ( config.parse_hosts == TRUE ) {
-        retv = read_hosts_file ( retv, length );
-    }
-
-    FILE       *fd = NULL;
-    const char *hd = getenv ( "HOME" );
-    path = g_build_filename ( hd, ".ssh", "config", NULL );
-    fd   = fopen ( path, "r" );
-
-    if ( fd != NULL ) {
-        char   *buffer       = NULL;
-        size_t buffer_length = 0;
-        while ( getline ( &buffer, &buffer_length, fd ) > 0 ) {
-            // Each line is either empty, a comment line starting with a '#'
-            // character or of the form "keyword [=] arguments", where there may
-            // be multiple (possibly quoted) arguments separated by whitespace.
-            // The keyword is separated from its arguments by whitespace OR by
-            // optional whitespace and a '=' character.
-            char *token = strtok ( buffer, SSH_TOKEN_DELIM );
-
-            // Skip empty lines and comment lines. Also skip lines where the
-            // keyword is not "Host".
-            if ( !token || *token == '#' || g_ascii_strcasecmp ( token, "Host" ) ) {
-                continue;
-            }
-
-            // Now we know that this is a "Host" line.
-            // The "Host" keyword is followed by one more host names separated
-            // by whitespace; while host names may be quoted with double quotes
-            // to represent host names containing spaces, we don't support this
-            // (how many host names contain spaces?).
-            while ( ( token = strtok ( NULL, SSH_TOKEN_DELIM ) ) ) {
-                // We do not want to show wildcard entries, as you cannot ssh to them.
-                const char *const sep = "*?";
-                if ( *token == '!' || strpbrk ( token, sep ) ) {
-                    continue;
-                }
-
-                // If comment, skip from now on.
-                if ( *token == '#' ) {
-                    break;
-                }
-
-                // Is this host name already in the history file?
-                // This is a nice little penalty, but doable? time will tell.
-                // given num_favorites is max 25.
-                int found = 0;
-                for ( unsigned int j = 0; j < num_favorites; j++ ) {
-                    if ( !g_ascii_strcasecmp ( token, retv[j] ) ) {
-                        found = 1;
-                        break;
-                    }
-                }
-
-                if ( found ) {
-                    continue;
-                }
-
-                // Add this host name to the list.
-                retv                  = g_realloc ( retv, ( ( *length ) + 2 ) * sizeof ( char* ) );
-                retv[( *length )]     = g_strdup ( token );
-                retv[( *length ) + 1] = NULL;
-                ( *length )++;
-            }
-        }
-        if ( buffer != NULL ) {
-            free ( buffer );
-        }
-
-        if ( fclose ( fd ) != 0 ) {
-            fprintf ( stderr, "Failed to close ssh configuration file: '%s'\n", strerror ( errno ) );
-        }
-    }
-
-    g_free ( path );
-
+    retv = ssh_hosts_merge ( retv, length, hosts, num_hosts );
+    TICK_N ( "stop" );
     return retv;
 }
 
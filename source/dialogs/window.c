@@ -29,6 +29,7 @@
 #ifdef WINDOW_MODE
 
 #include <stdlib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <strings.h>
@@ -73,6 +74,8 @@ typedef struct
     int                               active;
     int                               demands;
     long                              hint_flags;
+    /** _NET_WM_DESKTOP, 0xFFFFFFFF if on all desktops. */
+    uint32_t                          wmdesktop;
 } client;
 
 // window lists
@@ -81,10 +84,58 @@ typedef struct
     xcb_window_t *array;
     client       **data;
     int          len;
+    /** Open addressing hash table from window to position in array plus one, 0 marks a free slot. */
+    int          *index;
+    /** Size of index, always a power of two. */
+    unsigned int index_size;
 } winlist;
 
 winlist *cache_client = NULL;
 
+/**
+ * @param w The window.
+ *
+ * Window ids are mostly sequential, multiply by a large odd constant to spread them over the table.
+ *
+ * @returns the hash of the window.
+ */
+static inline unsigned int winlist_hash ( xcb_window_t w )
+{
+    return (unsigned int) ( w * 2654435761u );
+}
+
+/**
+ * @param l The winlist.
+ * @param pos The position in the array to add to the index.
+ *
+ * Add the entry at pos to the index, replacing an earlier entry for the same window.
+ */
+static void winlist_index_insert ( winlist *l, int pos )
+{
+    unsigned int mask = l->index_size - 1;
+    unsigned int i    = winlist_hash ( l->array[pos] ) & mask;
+    while ( l->index[i] != 0 && l->array[l->index[i] - 1] != l->array[pos] ) {
+        i = ( i + 1 ) & mask;
+    }
+    l->index[i] = pos + 1;
+}
+
+/**
+ * @param l The winlist.
+ * @param size The new size of the index, a power of two.
+ *
+ * Rebuild the index with size slots.
+ */
+static void winlist_index_resize ( winlist *l, unsigned int size )
+{
+    g_free ( l->index );
+    l->index_size = size;
+    l->index      = g_malloc0_n ( size, sizeof ( int ) );
+    for ( int i = 0; i < l->len; i++ ) {
+        winlist_index_insert ( l, i );
+    }
+}
+
 /**
  * Create a window list, pre-seeded with WINLIST entries.
  *
@@ -93,9 +144,11 @@ winlist *cache_client = NULL;
 static winlist* winlist_new ()
 {
     winlist *l = g_malloc ( sizeof ( winlist ) );
-    l->len   = 0;
-    l->array = g_malloc_n ( WINLIST + 1, sizeof ( xcb_window_t ) );
-    l->data  = g_malloc_n ( WINLIST + 1, sizeof ( client* ) );
+    l->len        = 0;
+    l->array      = g_malloc_n ( WINLIST + 1, sizeof ( xcb_window_t ) );
+    l->data       = g_malloc_n ( WINLIST + 1, sizeof ( client* ) );
+    l->index_size = 2 * WINLIST;
+    l->index      = g_malloc0_n ( l->index_size, sizeof ( int ) );
     return l;
 }
 
@@ -120,36 +173,44 @@ static int winlist_append ( winlist *l, xcb_window_t w, client *d )
         return 0;
     }
 
-    l->data[l->len]    = d;
-    l->array[l->len++] = w;
+    l->data[l->len]  = d;
+    l->array[l->len] = w;
+    // Keep the load factor of the index below one half.
+    if ( 2 * (unsigned int) ( l->len + 1 ) > l->index_size ) {
+        winlist_index_resize ( l, 2 * l->index_size );
+    }
+    winlist_index_insert ( l, l->len );
+    l->len++;
     return l->len - 1;
 }
 
-static void winlist_empty ( winlist *l )
+/**
+ * @param c The client to free.
+ *
+ * Free the client and its strings.
+ */
+static void client_free ( client *c )
 {
-    while ( l->len > 0 ) {
-        client *c = l->data[--l->len];
-        if ( c != NULL ) {
-            g_free ( c->title );
-            g_free ( c->class );
-            g_free ( c->name );
-            g_free ( c->role );
-            g_free ( c );
-        }
+    if ( c != NULL ) {
+        g_free ( c->title );
+        g_free ( c->class );
+        g_free ( c->name );
+        g_free ( c->role );
+        g_free ( c );
     }
 }
 
 /**
  * @param l The winlist entry
  *
- * Free the winlist.
+ * Free the winlist. The data pointers are not freed.
  */
 static void winlist_free ( winlist *l )
 {
     if ( l != NULL ) {
-        winlist_empty ( l );
         g_free ( l->array );
         g_free ( l->data );
+        g_free ( l->index );
         g_free ( l );
     }
 }
@@ -162,18 +223,14 @@ static void winlist_free ( winlist *l )
  *
  * @returns -1 if failed, index is successful.
  */
-static int winlist_find ( winlist *l, xcb_window_t w )
+static int winlist_find ( const winlist *l, xcb_window_t w )
 {
-// iterate backwards. Theory is: windows most often accessed will be
-// nearer the end. Testing with kcachegrind seems to support this...
-    int i;
-
-    for ( i = ( l->len - 1 ); i >= 0; i-- ) {
-        if ( l->array[i] == w ) {
-            return i;
+    unsigned int mask = l->index_size - 1;
+    for ( unsigned int i = winlist_hash ( w ) & mask; l->index[i] != 0; i = ( i + 1 ) & mask ) {
+        if ( l->array[l->index[i] - 1] == w ) {
+            return l->index[i] - 1;
         }
     }
-
     return -1;
 }
 /**
@@ -191,28 +248,15 @@ static void x11_cache_create ( void )
  */
 static void x11_cache_free ( void )
 {
+    if ( cache_client != NULL ) {
+        for ( int i = 0; i < cache_client->len; i++ ) {
+            client_free ( cache_client->data[i] );
+        }
+    }
     winlist_free ( cache_client );
     cache_client = NULL;
 }
 
-/**
- * @param d Display connection to X server
- * @param w window
- *
- * Get window attributes.
- * This functions uses caching.
- *
- * @returns a XWindowAttributes
- */
-static xcb_get_window_attributes_reply_t * window_get_attributes ( xcb_window_t w )
-{
-    xcb_get_window_attributes_cookie_t c  = xcb_get_window_attributes ( xcb->connection, w );
-    xcb_get_window_attributes_reply_t  *r = xcb_get_window_attributes_reply ( xcb->connection, c, NULL );
-    if ( r ) {
-        return r;
-    }
-    return NULL;
-}
 // _NET_WM_STATE_*
 static int client_has_state ( client *c, xcb_atom_t state )
 {
@@ -235,64 +279,125 @@ static int client_has_window_type ( client *c, xcb_atom_t type )
     return 0;
 }
 
-static client* window_client ( xcb_window_t win )
+/**
+ * The requests sent for one window, the replies are collected by window_client_reply().
+ */
+typedef struct
 {
-    if ( win == XCB_WINDOW_NONE ) {
-        return NULL;
-    }
+    xcb_window_t                       window;
+    xcb_get_window_attributes_cookie_t attributes;
+    xcb_get_property_cookie_t          state;
+    xcb_get_property_cookie_t          window_type;
+    xcb_get_property_cookie_t          net_wm_name;
+    xcb_get_property_cookie_t          wm_name;
+    xcb_get_property_cookie_t          role;
+    xcb_get_property_cookie_t          wm_class;
+    xcb_get_property_cookie_t          wm_hints;
+    xcb_get_property_cookie_t          desktop;
+} client_request;
 
-    int idx = winlist_find ( cache_client, win );
-
-    if ( idx >= 0 ) {
-        return cache_client->data[idx];
-    }
+/**
+ * @param win The window.
+ * @param req The requests to fill in.
+ *
+ * Send all requests needed to build the client, without waiting for the replies.
+ */
+static void window_client_request ( xcb_window_t win, client_request *req )
+{
+    req->window      = win;
+    req->attributes  = xcb_get_window_attributes ( xcb->connection, win );
+    req->state       = xcb_ewmh_get_wm_state ( &xcb->ewmh, win );
+    req->window_type = xcb_ewmh_get_wm_window_type ( &xcb->ewmh, win );
+    req->net_wm_name = xcb_get_property ( xcb->connection, 0, win, xcb->ewmh._NET_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
+    req->wm_name     = xcb_get_property ( xcb->connection, 0, win, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
+    req->role        = xcb_get_property ( xcb->connection, 0, win, netatoms[WM_WINDOW_ROLE], XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
+    req->wm_class    = xcb_icccm_get_wm_class ( xcb->connection, win );
+    req->wm_hints    = xcb_icccm_get_wm_hints ( xcb->connection, win );
+    req->desktop     = xcb_get_property ( xcb->connection, 0, win, xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0, 1 );
+    // Get told when the properties change, so the list can be kept up to date.
+    uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes ( xcb->connection, win, XCB_CW_EVENT_MASK, &mask );
+}
 
+/**
+ * @param req The requests sent by window_client_request().
+ *
+ * Collect the replies and build the client.
+ *
+ * @returns the client, or NULL if the window is gone.
+ */
+static client* window_client_reply ( const client_request *req )
+{
     // if this fails, we're up that creek
-    xcb_get_window_attributes_reply_t *attr = window_get_attributes ( win );
+    xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply ( xcb->connection, req->attributes, NULL );
 
     if ( !attr ) {
+        xcb_discard_reply ( xcb->connection, req->state.sequence );
+        xcb_discard_reply ( xcb->connection, req->window_type.sequence );
+        xcb_discard_reply ( xcb->connection, req->net_wm_name.sequence );
+        xcb_discard_reply ( xcb->connection, req->wm_name.sequence );
+        xcb_discard_reply ( xcb->connection, req->role.sequence );
+        xcb_discard_reply ( xcb->connection, req->wm_class.sequence );
+        xcb_discard_reply ( xcb->connection, req->wm_hints.sequence );
+        xcb_discard_reply ( xcb->connection, req->desktop.sequence );
         return NULL;
     }
     client *c = g_malloc0 ( sizeof ( client ) );
-    c->window = win;
+    c->window = req->window;
 
     // copy xattr so we don't have to care when stuff is freed
     memmove ( &c->xattr, attr, sizeof ( xcb_get_window_attributes_reply_t ) );
 
-    xcb_get_property_cookie_t  cky = xcb_ewmh_get_wm_state ( &xcb->ewmh, win );
     xcb_ewmh_get_atoms_reply_t states;
-    if ( xcb_ewmh_get_wm_state_reply ( &xcb->ewmh, cky, &states, NULL ) ) {
+    if ( xcb_ewmh_get_wm_state_reply ( &xcb->ewmh, req->state, &states, NULL ) ) {
         c->states = MIN ( CLIENTSTATE, states.atoms_len );
         memcpy ( c->state, states.atoms, MIN ( CLIENTSTATE, states.atoms_len ) * sizeof ( xcb_atom_t ) );
         xcb_ewmh_get_atoms_reply_wipe ( &states );
     }
-    cky = xcb_ewmh_get_wm_window_type ( &xcb->ewmh, win );
-    if ( xcb_ewmh_get_wm_window_type_reply ( &xcb->ewmh, cky, &states, NULL ) ) {
+    if ( xcb_ewmh_get_wm_window_type_reply ( &xcb->ewmh, req->window_type, &states, NULL ) ) {
         c->window_types = MIN ( CLIENTWINDOWTYPE, states.atoms_len );
         memcpy ( c->window_type, states.atoms, MIN ( CLIENTWINDOWTYPE, states.atoms_len ) * sizeof ( xcb_atom_t ) );
         xcb_ewmh_get_atoms_reply_wipe ( &states );
     }
 
-    c->title = window_get_text_prop ( c->window, xcb->ewmh._NET_WM_NAME );
+    c->title = window_get_text_prop_reply ( xcb_get_property_reply ( xcb->connection, req->net_wm_name, NULL ) );
     if ( c->title == NULL ) {
-        c->title = window_get_text_prop ( c->window, XCB_ATOM_WM_NAME );
+        c->title = window_get_text_prop_reply ( xcb_get_property_reply ( xcb->connection, req->wm_name, NULL ) );
+    }
+    else {
+        xcb_discard_reply ( xcb->connection, req->wm_name.sequence );
     }
 
-    c->role = window_get_text_prop ( c->window, netatoms[WM_WINDOW_ROLE] );
+    c->role = window_get_text_prop_reply ( xcb_get_property_reply ( xcb->connection, req->role, NULL ) );
 
-    cky = xcb_icccm_get_wm_class ( xcb->connection, c->window );
     xcb_icccm_get_wm_class_reply_t wcr;
-    if ( xcb_icccm_get_wm_class_reply ( xcb->connection, cky, &wcr, NULL ) ) {
+    if ( xcb_icccm_get_wm_class_reply ( xcb->connection, req->wm_class, &wcr, NULL ) ) {
         c->class = rofi_latin_to_utf8_strdup ( wcr.class_name, -1 );
         c->name  = rofi_latin_to_utf8_strdup ( wcr.instance_name, -1 );
         xcb_icccm_get_wm_class_reply_wipe ( &wcr );
     }
 
-    xcb_get_property_cookie_t cc = xcb_icccm_get_wm_hints ( xcb->connection, c->window );
-    xcb_icccm_wm_hints_t      r;
-    if ( xcb_icccm_get_wm_hints_reply ( xcb->connection, cc, &r, NULL ) ) {
+    xcb_icccm_wm_hints_t r;
+    if ( xcb_icccm_get_wm_hints_reply ( xcb->connection, req->wm_hints, &r, NULL ) ) {
         c->hint_flags = r.flags;
     }
+    if ( client_has_state ( c, xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION ) ) {
+        c->demands = TRUE;
+    }
+    if ( ( c->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY ) != 0 ) {
+        c->demands = TRUE;
+    }
+
+    // find client's desktop.
+    xcb_get_property_reply_t *dr = xcb_get_property_reply ( xcb->connection, req->desktop, NULL );
+    if ( dr && dr->type == XCB_ATOM_CARDINAL && xcb_get_property_value_length ( dr ) >= 4 ) {
+        c->wmdesktop = *( (uint32_t *) xcb_get_property_value ( dr ) );
+    }
+    else if ( dr && dr->type != XCB_ATOM_CARDINAL ) {
+        // Assume the client is on all desktops.
+        c->wmdesktop = 0xFFFFFFFF;
+    }
+    free ( dr );
 
     /** Do UTF-8 Check, should not be needed, does not hurt here to be paranoid. */
     {
@@ -302,11 +407,56 @@ static client* window_client ( xcb_window_t win )
         c->role  = rofi_force_utf8 ( c->role );
     }
 
-    winlist_append ( cache_client, c->window, c );
     g_free ( attr );
     return c;
 }
 
+static client* window_client ( xcb_window_t win )
+{
+    if ( win == XCB_WINDOW_NONE ) {
+        return NULL;
+    }
+
+    int idx = winlist_find ( cache_client, win );
+
+    if ( idx >= 0 ) {
+        return cache_client->data[idx];
+    }
+
+    client_request req;
+    window_client_request ( win, &req );
+    client         *c = window_client_reply ( &req );
+    if ( c != NULL ) {
+        winlist_append ( cache_client, c->window, c );
+    }
+    return c;
+}
+
+/**
+ * @param wins The windows.
+ * @param nwins The number of windows.
+ *
+ * Fill the cache for all windows. All requests are sent before the first reply is
+ * waited for, so this takes about one round trip to the X server, not one per property.
+ */
+static void window_client_prefetch ( const xcb_window_t *wins, int nwins )
+{
+    client_request *reqs = g_malloc_n ( MAX ( nwins, 1 ), sizeof ( client_request ) );
+    int            n     = 0;
+    for ( int i = 0; i < nwins; i++ ) {
+        if ( wins[i] != XCB_WINDOW_NONE && winlist_find ( cache_client, wins[i] ) < 0 ) {
+            window_client_request ( wins[i], &( reqs[n++] ) );
+        }
+    }
+    for ( int i = 0; i < n; i++ ) {
+        client *c = window_client_reply ( &( reqs[i] ) );
+        if ( c != NULL ) {
+            winlist_append ( cache_client, c->window, c );
+        }
+    }
+    g_free ( reqs );
+}
+
 typedef struct
 {
     unsigned int id;
@@ -317,19 +467,262 @@ typedef struct
     // Current window.
     unsigned int index;
     char         *cache;
+    // Only show the windows on the current desktop.
+    unsigned int cd;
+    unsigned int current_desktop;
+    // Width of the class column.
+    unsigned int classfield;
+    // Pattern for printing the line.
+    char         pattern[50];
 } ModeModePrivateData;
 
+/**
+ * @param pd The window mode.
+ * @param c The client.
+ *
+ * @returns TRUE if the client gets a row in the list.
+ */
+static gboolean window_mode_client_shown ( const ModeModePrivateData *pd, client *c )
+{
+    if ( c->xattr.override_redirect
+         || client_has_window_type ( c, xcb->ewmh._NET_WM_WINDOW_TYPE_DOCK )
+         || client_has_window_type ( c, xcb->ewmh._NET_WM_WINDOW_TYPE_DESKTOP )
+         || client_has_state ( c, xcb->ewmh._NET_WM_STATE_SKIP_PAGER )
+         || client_has_state ( c, xcb->ewmh._NET_WM_STATE_SKIP_TASKBAR ) ) {
+        return FALSE;
+    }
+    // Only show the clients on the current desktop, or on all desktops.
+    if ( !pd->config_i3_mode && pd->cd && c->wmdesktop != 0xFFFFFFFF && c->wmdesktop != pd->current_desktop ) {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @param pd The window mode.
+ *
+ * Create the pattern for printing the lines, from the width of the class column.
+ */
+static void window_mode_set_pattern ( ModeModePrivateData *pd )
+{
+    if ( pd->config_i3_mode ) {
+        snprintf ( pd->pattern, sizeof ( pd->pattern ), "%%-%ds   %%s", MAX ( 5, pd->classfield ) );
+    }
+    else{
+        unsigned int              desktops = 0;
+        xcb_get_property_cookie_t c        = xcb_ewmh_get_number_of_desktops ( &xcb->ewmh, xcb->screen_nbr );
+        if ( !xcb_ewmh_get_number_of_desktops_reply ( &xcb->ewmh, c, &desktops, NULL ) ) {
+            desktops = 1;
+        }
+        snprintf ( pd->pattern, sizeof ( pd->pattern ), "%%-%ds  %%-%ds   %%s", desktops < 10 ? 1 : 2,
+                   MAX ( 5, pd->classfield ) );
+    }
+}
+
+/**
+ * @param pd The window mode.
+ * @param c The client.
+ *
+ * @returns the line to show for the client.
+ */
+static char * window_mode_format_line ( const ModeModePrivateData *pd, const client *c )
+{
+    // final line format
+    char   desktop[5];
+    desktop[0] = 0;
+    size_t len =
+        ( ( c->title != NULL ) ? strlen ( c->title ) : 0 ) + ( c->class ? strlen ( c->class ) : 0 ) + pd->classfield + 50;
+    char   *line = g_malloc ( len );
+    if ( !pd->config_i3_mode ) {
+        if ( c->wmdesktop < 0xFFFFFFFF ) {
+            snprintf ( desktop, 5, "%u", (uint32_t) c->wmdesktop );
+        }
+
+        snprintf ( line, len, pd->pattern, desktop, c->class ? c->class : "", c->title ? c->title : "" );
+    }
+    else{
+        snprintf ( line, len, pd->pattern, c->class ? c->class : "", c->title ? c->title : "" );
+    }
+    return line;
+}
+
+/**
+ * @param pd The window mode.
+ * @param c The client.
+ *
+ * Widen the class column if the class of the client does not fit.
+ *
+ * @returns TRUE if the column was widened, all lines need formatting again.
+ */
+static gboolean window_mode_fit_class ( ModeModePrivateData *pd, const client *c )
+{
+    unsigned int len = ( c->class != NULL ) ? strlen ( c->class ) : 0;
+    if ( len > pd->classfield ) {
+        pd->classfield = len;
+        window_mode_set_pattern ( pd );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @param pd The window mode.
+ *
+ * Format all lines again.
+ */
+static void window_mode_format_lines ( ModeModePrivateData *pd )
+{
+    for ( unsigned int i = 0; i < pd->cmd_list_length; i++ ) {
+        g_free ( pd->cmd_list[i] );
+        pd->cmd_list[i] = window_mode_format_line ( pd, pd->ids->data[i] );
+    }
+}
+
+/**
+ * @param pd The window mode.
+ * @param c The client to add.
+ *
+ * Add a row for the client at the end of the list.
+ */
+static void window_mode_append_row ( ModeModePrivateData *pd, client *c )
+{
+    winlist_append ( pd->ids, c->window, c );
+    pd->cmd_list                        = g_realloc_n ( pd->cmd_list, pd->cmd_list_length + 2, sizeof ( char* ) );
+    pd->cmd_list[pd->cmd_list_length++] = window_mode_format_line ( pd, c );
+    pd->cmd_list[pd->cmd_list_length]   = NULL;
+}
+
+/**
+ * @param pd The window mode.
+ * @param row The row to remove.
+ *
+ * Remove a row, the rows after it move up.
+ */
+static void window_mode_remove_row ( ModeModePrivateData *pd, unsigned int row )
+{
+    winlist *l = pd->ids;
+    g_free ( pd->cmd_list[row] );
+    memmove ( &( pd->cmd_list[row] ), &( pd->cmd_list[row + 1] ), ( pd->cmd_list_length - row ) * sizeof ( char* ) );
+    pd->cmd_list_length--;
+    memmove ( &( l->array[row] ), &( l->array[row + 1] ), ( l->len - row - 1 ) * sizeof ( xcb_window_t ) );
+    memmove ( &( l->data[row] ), &( l->data[row + 1] ), ( l->len - row - 1 ) * sizeof ( client* ) );
+    l->len--;
+    winlist_index_resize ( l, l->index_size );
+}
+
+/**
+ * @param wins Set to the list of windows, free with g_free().
+ *
+ * Get the managed windows, bottom to top in stacking order if the window manager supports it.
+ *
+ * @returns the number of windows.
+ */
+static int window_get_client_list ( xcb_window_t **wins )
+{
+    int                          nwins = 0;
+    xcb_get_property_cookie_t    c     = xcb_ewmh_get_client_list_stacking ( &xcb->ewmh, 0 );
+    xcb_ewmh_get_windows_reply_t clients;
+    *wins = NULL;
+    if ( xcb_ewmh_get_client_list_stacking_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
+        nwins = clients.windows_len;
+        *wins = g_memdup ( clients.windows, nwins * sizeof ( xcb_window_t ) );
+        xcb_ewmh_get_windows_reply_wipe ( &clients );
+    }
+    else {
+        c = xcb_ewmh_get_client_list ( &xcb->ewmh, xcb->screen_nbr );
+        if  ( xcb_ewmh_get_client_list_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
+            nwins = clients.windows_len;
+            *wins = g_memdup ( clients.windows, nwins * sizeof ( xcb_window_t ) );
+            xcb_ewmh_get_windows_reply_wipe ( &clients );
+        }
+    }
+    return nwins;
+}
+
+/**
+ * @param wins Set to the list of windows, free with g_free().
+ *
+ * Get the windows from the i3 layout tree, and add the ones that are not cached to the cache.
+ * Title, class and role come from the tree, so no requests are sent to the X server per window.
+ * The windows are ordered like _NET_CLIENT_LIST_STACKING, bottom to top, so the most recently
+ * focused windows come first. Windows missing from it are put at the bottom, in the order of the tree.
+ *
+ * @returns the number of windows, or -1 when the tree could not be read.
+ */
+static int window_get_i3_client_list ( xcb_window_t **wins )
+{
+    // Send the request first, the reply is read once the tree is in.
+    xcb_get_property_cookie_t cookie = xcb_ewmh_get_client_list_stacking ( &xcb->ewmh, 0 );
+    unsigned int              num;
+    I3Window                  *tree = i3_support_get_windows ( &num );
+    if ( tree == NULL ) {
+        xcb_discard_reply ( xcb->connection, cookie.sequence );
+        return -1;
+    }
+    // Maps the window to its position in the tree, plus one.
+    GHashTable *lookup = g_hash_table_new ( g_direct_hash, g_direct_equal );
+    for ( unsigned int i = 0; i < num; i++ ) {
+        g_hash_table_insert ( lookup, GUINT_TO_POINTER ( tree[i].window ), GUINT_TO_POINTER ( i + 1 ) );
+        if ( winlist_find ( cache_client, tree[i].window ) >= 0 ) {
+            continue;
+        }
+        client *c = g_malloc0 ( sizeof ( client ) );
+        c->window    = tree[i].window;
+        c->title     = rofi_force_utf8 ( tree[i].title );
+        c->class     = rofi_force_utf8 ( tree[i].class );
+        c->name      = rofi_force_utf8 ( tree[i].instance );
+        c->role      = rofi_force_utf8 ( tree[i].role );
+        c->demands   = tree[i].urgent;
+        c->wmdesktop = 0xFFFFFFFF;
+        // The strings are owned by the client now.
+        tree[i].title    = NULL;
+        tree[i].class    = NULL;
+        tree[i].instance = NULL;
+        tree[i].role     = NULL;
+        // Get told when the properties change, like window_client_request() does.
+        uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+        xcb_change_window_attributes ( xcb->connection, c->window, XCB_CW_EVENT_MASK, &mask );
+        winlist_append ( cache_client, c->window, c );
+    }
+
+    xcb_window_t                 *stacked = g_malloc_n ( MAX ( num, 1 ), sizeof ( xcb_window_t ) );
+    unsigned int                 nstacked = 0;
+    gboolean                     *placed  = g_malloc0_n ( MAX ( num, 1 ), sizeof ( gboolean ) );
+    xcb_ewmh_get_windows_reply_t clients;
+    if ( xcb_ewmh_get_client_list_stacking_reply ( &xcb->ewmh, cookie, &clients, NULL ) ) {
+        for ( unsigned int i = 0; i < clients.windows_len; i++ ) {
+            unsigned int pos = GPOINTER_TO_UINT ( g_hash_table_lookup ( lookup, GUINT_TO_POINTER ( clients.windows[i] ) ) );
+            if ( pos > 0 && !placed[pos - 1] ) {
+                placed[pos - 1]     = TRUE;
+                stacked[nstacked++] = clients.windows[i];
+            }
+        }
+        xcb_ewmh_get_windows_reply_wipe ( &clients );
+    }
+    *wins = g_malloc_n ( MAX ( num, 1 ), sizeof ( xcb_window_t ) );
+    unsigned int n = 0;
+    // The list is shown from the end, keep the order of the tree for the unstacked windows.
+    for ( unsigned int i = num; i > 0; i-- ) {
+        if ( !placed[i - 1] ) {
+            ( *wins )[n++] = tree[i - 1].window;
+        }
+    }
+    memcpy ( &( ( *wins )[n] ), stacked, nstacked * sizeof ( xcb_window_t ) );
+    g_free ( placed );
+    g_free ( stacked );
+    g_hash_table_destroy ( lookup );
+    i3_tree_free ( tree, num );
+    return num;
+}
+
 static int window_match ( const Mode *sw, char **tokens,
                           __attribute__( ( unused ) ) int not_ascii,
                           int case_sensitive, unsigned int index )
 {
     ModeModePrivateData *rmpd = (ModeModePrivateData *) mode_get_private_data ( sw );
     int                 match = 1;
-    const winlist       *ids  = ( winlist * ) rmpd->ids;
     // Want to pull directly out of cache, X calls are not thread safe.
-    int                 idx = winlist_find ( cache_client, ids->array[index] );
-    g_assert ( idx >= 0 );
-    client              *c = cache_client->data[idx];
+    const client        *c = rmpd->ids->data[index];
 
     if ( tokens ) {
         for ( int j = 0; match && tokens != NULL && tokens[j] != NULL; j++ ) {
@@ -374,140 +767,252 @@ static void _window_mode_load_data ( Mode *sw, unsigned int cd )
     ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( sw );
     // find window list
     int                 nwins = 0;
-    xcb_window_t        wins[100];
+    xcb_window_t        *wins = NULL;
     xcb_window_t        curr_win_id;
     // Create cache
 
     x11_cache_create ();
     // Check for i3
     pd->config_i3_mode = i3_support_initialize ( xcb );
+    pd->cd             = cd;
     xcb_get_property_cookie_t c = xcb_ewmh_get_active_window ( &( xcb->ewmh ), xcb->screen_nbr );
     if ( !xcb_ewmh_get_active_window_reply ( &xcb->ewmh, c, &curr_win_id, NULL ) ) {
         curr_win_id = 0;
     }
 
     // Get the current desktop.
-    unsigned int current_desktop = 0;
-    c = xcb_ewmh_get_current_desktop ( &xcb->ewmh, xcb->screen_nbr );
-    if ( !xcb_ewmh_get_current_desktop_reply ( &xcb->ewmh, c, &current_desktop, NULL ) ) {
-        current_desktop = 0;
+    pd->current_desktop = 0;
+    c                   = xcb_ewmh_get_current_desktop ( &xcb->ewmh, xcb->screen_nbr );
+    if ( !xcb_ewmh_get_current_desktop_reply ( &xcb->ewmh, c, &( pd->current_desktop ), NULL ) ) {
+        pd->current_desktop = 0;
     }
 
-    c = xcb_ewmh_get_client_list_stacking ( &xcb->ewmh, 0 );
-    xcb_ewmh_get_windows_reply_t clients;
-    if ( xcb_ewmh_get_client_list_stacking_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
-        nwins = MIN ( 100, clients.windows_len );
-        memcpy ( wins, clients.windows, nwins * sizeof ( xcb_window_t ) );
-        xcb_ewmh_get_windows_reply_wipe ( &clients );
+    // Get told when the client list changes.
+    uint32_t mask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes ( xcb->connection, xcb_stuff_get_root_window ( xcb ), XCB_CW_EVENT_MASK, &mask );
+
+    // i3 lists all windows with their properties in one reply.
+    if ( pd->config_i3_mode ) {
+        nwins = window_get_i3_client_list ( &wins );
     }
-    else {
-        c = xcb_ewmh_get_client_list ( &xcb->ewmh, xcb->screen_nbr );
-        if  ( xcb_ewmh_get_client_list_reply ( &xcb->ewmh, c, &clients, NULL ) ) {
-            nwins = MIN ( 100, clients.windows_len );
-            memcpy ( wins, clients.windows, nwins * sizeof ( xcb_window_t ) );
-            xcb_ewmh_get_windows_reply_wipe ( &clients );
-        }
+    if ( nwins < 0 || !pd->config_i3_mode ) {
+        nwins = window_get_client_list ( &wins );
     }
+    // windows we actually display. May be slightly different to _NET_CLIENT_LIST_STACKING
+    // if we happen to have a window destroyed while we're working...
+    pd->ids      = winlist_new ();
+    pd->cmd_list = g_malloc0_n ( 1, sizeof ( char* ) );
     if (  nwins > 0 ) {
-        char         pattern[50];
-        int          i;
-        unsigned int classfield = 0;
-        unsigned int desktops   = 0;
-        // windows we actually display. May be slightly different to _NET_CLIENT_LIST_STACKING
-        // if we happen to have a window destroyed while we're working...
-        pd->ids = winlist_new ();
+        window_client_prefetch ( wins, nwins );
 
         // calc widths of fields
-        for ( i = nwins - 1; i > -1; i-- ) {
+        for ( int i = nwins - 1; i > -1; i-- ) {
             client *c = window_client ( wins[i] );
-            if ( ( c != NULL )
-                 && !c->xattr.override_redirect
-                 && !client_has_window_type ( c, xcb->ewmh._NET_WM_WINDOW_TYPE_DOCK )
-                 && !client_has_window_type ( c, xcb->ewmh._NET_WM_WINDOW_TYPE_DESKTOP )
-                 && !client_has_state ( c, xcb->ewmh._NET_WM_STATE_SKIP_PAGER )
-                 && !client_has_state ( c, xcb->ewmh._NET_WM_STATE_SKIP_TASKBAR ) ) {
-                classfield = MAX ( classfield, ( c->class != NULL ) ? ( strlen ( c->class ) ) : 0 );
-
-                if ( client_has_state ( c, xcb->ewmh._NET_WM_STATE_DEMANDS_ATTENTION ) ) {
-                    c->demands = TRUE;
-                }
-                if ( ( c->hint_flags & XCB_ICCCM_WM_HINT_X_URGENCY ) != 0 ) {
-                    c->demands = TRUE;
-                }
-
+            if ( ( c != NULL ) && window_mode_client_shown ( pd, c ) ) {
+                pd->classfield = MAX ( pd->classfield, ( c->class != NULL ) ? ( strlen ( c->class ) ) : 0 );
                 if ( c->window == curr_win_id ) {
                     c->active = TRUE;
                 }
-                winlist_append ( pd->ids, c->window, NULL );
+                winlist_append ( pd->ids, c->window, c );
             }
         }
 
-        // Create pattern for printing the line.
-        xcb_get_property_cookie_t c = xcb_ewmh_get_number_of_desktops ( &xcb->ewmh, xcb->screen_nbr );
-        if ( !xcb_ewmh_get_number_of_desktops_reply ( &xcb->ewmh, c, &desktops, NULL ) ) {
-            desktops = 1;
+        window_mode_set_pattern ( pd );
+        pd->cmd_list = g_realloc_n ( pd->cmd_list, ( pd->ids->len + 1 ), sizeof ( char* ) );
+
+        // build the actual list
+        for ( int i = 0; i < ( pd->ids->len ); i++ ) {
+            pd->cmd_list[pd->cmd_list_length++] = window_mode_format_line ( pd, pd->ids->data[i] );
         }
+        pd->cmd_list[pd->cmd_list_length] = NULL;
+    }
+    g_free ( wins );
+}
+
+/**
+ * @param sw The window mode.
+ *
+ * The rows are only updated while the view shows the mode itself. When the mode is part of combi,
+ * the combined list keeps the position and number of its rows, changing them would break it.
+ *
+ * @returns TRUE if the rows of the mode can be updated.
+ */
+static gboolean window_mode_is_live ( Mode *sw )
+{
+    RofiViewState *state = rofi_view_get_active ();
+    return state != NULL && rofi_view_get_mode ( state ) == sw;
+}
+
+/**
+ * @param reload The rows changed in a way that needs all rows matched again.
+ * @param rows The rows that changed in place.
+ * @param num The number of rows.
+ *
+ * Tell the view about the changed rows, only call this for a mode that is live.
+ */
+static void window_mode_update_view ( gboolean reload, const unsigned int *rows, unsigned int num )
+{
+    RofiViewState *state = rofi_view_get_active ();
+    if ( reload ) {
+        rofi_view_reload ( state );
+    }
+    else if ( num > 0 ) {
+        rofi_view_reload_lines ( state, rows, num );
+    }
+    else {
+        // Rows added to the end, a no-op when nothing changed.
+        rofi_view_reload_appended ( state );
+    }
+}
 
-        if ( pd->config_i3_mode ) {
-            snprintf ( pattern, 50, "%%-%ds   %%s", MAX ( 5, classfield ) );
+/**
+ * The window modes, both share the client cache.
+ */
+static Mode *window_modes[] = { &window_mode, &window_mode_cd };
+
+/**
+ * Read the client list again, add rows for new windows and remove the rows of closed windows.
+ */
+static void window_mode_update_clients ( void )
+{
+    xcb_window_t *wins  = NULL;
+    int          nwins  = window_get_client_list ( &wins );
+    winlist      *alive = winlist_new ();
+    for ( int i = 0; i < nwins; i++ ) {
+        winlist_append ( alive, wins[i], NULL );
+    }
+    window_client_prefetch ( wins, nwins );
+
+    // Set when a mode keeps rows that point to closed windows.
+    gboolean stale = FALSE;
+    for ( unsigned int m = 0; m < G_N_ELEMENTS ( window_modes ); m++ ) {
+        ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( window_modes[m] );
+        if ( pd == NULL || pd->ids == NULL ) {
+            continue;
         }
-        else{
-            snprintf ( pattern, 50, "%%-%ds  %%-%ds   %%s", desktops < 10 ? 1 : 2,
-                       MAX ( 5, classfield ) );
+        if ( !window_mode_is_live ( window_modes[m] ) ) {
+            stale = TRUE;
+            continue;
         }
-        pd->cmd_list = g_malloc0_n ( ( pd->ids->len + 1 ), sizeof ( char* ) );
-
-        // build the actual list
-        for ( i = 0; i < ( pd->ids->len ); i++ ) {
-            xcb_window_t w = pd->ids->array[i];
-            client       *c;
-
-            if ( ( c = window_client ( w ) ) ) {
-                // final line format
-                char   desktop[5];
-                desktop[0] = 0;
-                size_t len =
-                    ( ( c->title != NULL ) ? strlen ( c->title ) : 0 ) + ( c->class ? strlen ( c->class ) : 0 ) + classfield + 50;
-                char   *line = g_malloc ( len );
-                if ( !pd->config_i3_mode ) {
-                    uint32_t                  wmdesktop = 0;
-                    // find client's desktop.
-                    xcb_get_property_cookie_t cookie;
-                    xcb_get_property_reply_t  *r;
-
-                    cookie =
-                        xcb_get_property ( xcb->connection, 0, c->window, xcb->ewmh._NET_WM_DESKTOP, XCB_ATOM_CARDINAL, 0,
-                                           1 );
-                    r = xcb_get_property_reply ( xcb->connection, cookie, NULL );
-                    if ( r && r->type == XCB_ATOM_CARDINAL ) {
-                        wmdesktop = *( (uint32_t *) xcb_get_property_value ( r ) );
-                    }
-                    if ( r && r->type != XCB_ATOM_CARDINAL ) {
-                        // Assume the client is on all desktops.
-                        wmdesktop = 0xFFFFFFFF;
-                    }
-                    else if ( cd && wmdesktop != current_desktop ) {
-                        g_free ( line );
-                        free ( r );
-                        continue;
-                    }
-                    free ( r );
-
-                    if ( wmdesktop < 0xFFFFFFFF ) {
-                        snprintf ( desktop, 5, "%u", (uint32_t) wmdesktop );
-                    }
-
-                    snprintf ( line, len, pattern, desktop, c->class ? c->class : "", c->title ? c->title : "" );
-                }
-                else{
-                    snprintf ( line, len, pattern, c->class ? c->class : "", c->title ? c->title : "" );
+        gboolean reload = FALSE;
+        for ( int row = pd->ids->len - 1; row >= 0; row-- ) {
+            if ( winlist_find ( alive, pd->ids->array[row] ) < 0 ) {
+                window_mode_remove_row ( pd, row );
+                reload = TRUE;
+            }
+        }
+        for ( int i = nwins - 1; i > -1; i-- ) {
+            int idx = winlist_find ( cache_client, wins[i] );
+            if ( idx >= 0 && winlist_find ( pd->ids, wins[i] ) < 0 && window_mode_client_shown ( pd, cache_client->data[idx] ) ) {
+                if ( window_mode_fit_class ( pd, cache_client->data[idx] ) ) {
+                    window_mode_format_lines ( pd );
+                    reload = TRUE;
                 }
-
-                pd->cmd_list[pd->cmd_list_length++] = line;
+                window_mode_append_row ( pd, cache_client->data[idx] );
             }
         }
+        window_mode_update_view ( reload, NULL, 0 );
     }
+
+    if ( stale ) {
+        winlist_free ( alive );
+        g_free ( wins );
+        return;
+    }
+    // Drop the closed windows from the cache, no row points to them anymore.
+    winlist *cache = winlist_new ();
+    for ( int i = 0; i < cache_client->len; i++ ) {
+        if ( winlist_find ( alive, cache_client->array[i] ) >= 0 ) {
+            winlist_append ( cache, cache_client->array[i], cache_client->data[i] );
+        }
+        else {
+            client_free ( cache_client->data[i] );
+        }
+    }
+    winlist_free ( cache_client );
+    cache_client = cache;
+    winlist_free ( alive );
+    g_free ( wins );
 }
+
+/**
+ * @param c The client to update.
+ *
+ * Read the properties of the client again, and update the rows that show it.
+ */
+static void window_mode_update_client ( client *c )
+{
+    client_request req;
+    window_client_request ( c->window, &req );
+    client         *n = window_client_reply ( &req );
+    if ( n == NULL ) {
+        // The window is gone, the client list update removes it.
+        return;
+    }
+    // Rows point to the client, so update it in place.
+    n->active = c->active;
+    g_free ( c->title );
+    g_free ( c->class );
+    g_free ( c->name );
+    g_free ( c->role );
+    *c = *n;
+    g_free ( n );
+
+    for ( unsigned int m = 0; m < G_N_ELEMENTS ( window_modes ); m++ ) {
+        ModeModePrivateData *pd = (ModeModePrivateData *) mode_get_private_data ( window_modes[m] );
+        if ( pd == NULL || pd->ids == NULL || !window_mode_is_live ( window_modes[m] ) ) {
+            continue;
+        }
+        int      row    = winlist_find ( pd->ids, c->window );
+        gboolean shown  = window_mode_client_shown ( pd, c );
+        gboolean reload = FALSE;
+        if ( row < 0 && !shown ) {
+            continue;
+        }
+        if ( shown && window_mode_fit_class ( pd, c ) ) {
+            window_mode_format_lines ( pd );
+            reload = TRUE;
+        }
+        if ( row < 0 ) {
+            window_mode_append_row ( pd, c );
+            window_mode_update_view ( reload, NULL, 0 );
+        }
+        else if ( !shown ) {
+            window_mode_remove_row ( pd, row );
+            window_mode_update_view ( TRUE, NULL, 0 );
+        }
+        else {
+            unsigned int line = row;
+            g_free ( pd->cmd_list[line] );
+            pd->cmd_list[line] = window_mode_format_line ( pd, c );
+            window_mode_update_view ( reload, &line, 1 );
+        }
+    }
+}
+
+void window_mode_property_notify ( xcb_property_notify_event_t *ev )
+{
+    if ( cache_client == NULL ) {
+        return;
+    }
+    if ( ev->window == xcb_stuff_get_root_window ( xcb ) ) {
+        if ( ev->atom == xcb->ewmh._NET_CLIENT_LIST_STACKING || ev->atom == xcb->ewmh._NET_CLIENT_LIST ) {
+            window_mode_update_clients ();
+        }
+        return;
+    }
+    // Only the properties that are shown or used for filtering, others like _NET_WM_USER_TIME change a lot.
+    if ( ev->atom != xcb->ewmh._NET_WM_NAME && ev->atom != XCB_ATOM_WM_NAME && ev->atom != XCB_ATOM_WM_CLASS
+         && ev->atom != XCB_ATOM_WM_HINTS && ev->atom != xcb->ewmh._NET_WM_STATE && ev->atom != xcb->ewmh._NET_WM_DESKTOP
+         && ev->atom != xcb->ewmh._NET_WM_WINDOW_TYPE && ev->atom != netatoms[WM_WINDOW_ROLE] ) {
+        return;
+    }
+    int idx = winlist_find ( cache_client, ev->window );
+    if ( idx >= 0 ) {
+        window_mode_update_client ( cache_client->data[idx] );
+    }
+}
+
 static int window_mode_init ( Mode *sw )
 {
     if ( mode_get_private_data ( sw ) == NULL ) {
@@ -610,10 +1115,11 @@ static void window_mode_destroy ( Mode *sw )
 static char *_get_display_value ( const Mode *sw, unsigned int selected_line, int *state, int get_entry )
 {
     ModeModePrivateData *rmpd = mode_get_private_data ( sw );
-    if ( window_client ( rmpd->ids->array[selected_line] )->demands ) {
+    const client        *c    = rmpd->ids->data[selected_line];
+    if ( c->demands ) {
         *state |= URGENT;
     }
-    if ( window_client ( rmpd->ids->array[selected_line] )->active ) {
+    if ( c->active ) {
         *state |= ACTIVE;
     }
     return get_entry ? g_strdup ( rmpd->cmd_list[selected_line] ) : NULL;
@@ -622,11 +1128,8 @@ static char *_get_display_value ( const Mode *sw, unsigned int selected_line, in
 static int window_is_not_ascii ( const Mode *sw, unsigned int index )
 {
     const ModeModePrivateData *rmpd = mode_get_private_data ( sw );
-    const winlist             *ids  = ( winlist * ) rmpd->ids;
     // Want to pull directly out of cache, X calls are not thread safe.
-    int                       idx = winlist_find ( cache_client, ids->array[index] );
-    g_assert ( idx >= 0 );
-    client                    *c = cache_client->data[idx];
+    const client              *c = rmpd->ids->data[index];
     if ( c->role && !g_str_is_ascii ( c->role ) ) {
         return TRUE;
     }
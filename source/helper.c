@@ -39,6 +39,9 @@
 #include <sys/stat.h>
 #include <pwd.h>
 #include <ctype.h>
+#include <dirent.h>
+#include <signal.h>
+#include <spawn.h>
 #include <xcb/xcb.h>
 #include <pango/pango.h>
 #include <pango/pango-fontmap.h>
@@ -61,31 +64,101 @@ void cmd_set_arguments ( int argc, char **argv )
 }
 
 /**
- * @param info To Match information on.
- * @param res  The string being generated.
- * @param data User data
+ * A command template, split once into literal text and {key} placeholders, so launching
+ * only needs to concatenate the parts.
+ */
+typedef struct
+{
+    /** Literal text and placeholders (with braces) alternating, starting and ending with text. */
+    char         **parts;
+    /** The number of parts, always odd. */
+    unsigned int num_parts;
+} HelperTemplate;
+
+/** The compiled command templates of the configuration, keyed on the template. */
+static GHashTable *helper_templates = NULL;
+/** The environment of launched processes. */
+static char       **helper_spawn_env = NULL;
+
+/**
+ * @param c The character to check.
  *
- * Replace the entries. This function gets called by g_regex_replace_eval.
+ * Characters allowed in a placeholder name, as matched by {[-\w]+}: bytes of
+ * multi-byte UTF-8 sequences count as word characters.
  *
- * @returns TRUE to stop replacement, FALSE to continue
+ * @returns TRUE if c can be part of a placeholder name.
  */
-static gboolean helper_eval_cb ( const GMatchInfo *info, GString *res, gpointer data )
-{
-    gchar *match;
-    // Get the match
-    match = g_match_info_fetch ( info, 0 );
-    if ( match != NULL ) {
-        // Lookup the match, so we can replace it.
-        gchar *r = g_hash_table_lookup ( (GHashTable *) data, match );
-        if ( r != NULL ) {
-            // Append the replacement to the string.
-            g_string_append ( res, r );
-        }
-        // Free match.
-        g_free ( match );
-    }
-    // Continue replacement.
-    return FALSE;
+static gboolean helper_is_key_char ( char c )
+{
+    return g_ascii_isalnum ( c ) || c == '_' || c == '-' || ( c & 0x80 ) != 0;
+}
+
+/**
+ * @param string The template.
+ *
+ * Split the template into literal text and placeholders.
+ *
+ * @returns the compiled template, free with helper_template_free().
+ */
+static HelperTemplate * helper_template_compile ( const char *string )
+{
+    GPtrArray  *parts = g_ptr_array_new ();
+    const char *text  = string;
+    const char *iter  = string;
+    while ( ( iter = strchr ( iter, '{' ) ) != NULL ) {
+        const char *end = iter + 1;
+        while ( helper_is_key_char ( *end ) ) {
+            end++;
+        }
+        if ( *end == '}' && end > ( iter + 1 ) ) {
+            g_ptr_array_add ( parts, g_strndup ( text, iter - text ) );
+            g_ptr_array_add ( parts, g_strndup ( iter, end + 1 - iter ) );
+            text = iter = end + 1;
+        }
+        else {
+            iter++;
+        }
+    }
+    g_ptr_array_add ( parts, g_strdup ( text ) );
+
+    HelperTemplate *t = g_malloc ( sizeof ( HelperTemplate ) );
+    t->num_parts = parts->len;
+    g_ptr_array_add ( parts, NULL );
+    t->parts = (char * *) g_ptr_array_free ( parts, FALSE );
+    return t;
+}
+
+static void helper_template_free ( gpointer data )
+{
+    HelperTemplate *t = (HelperTemplate *) data;
+    g_strfreev ( t->parts );
+    g_free ( t );
+}
+
+void helper_launch_setup ( void )
+{
+    const char *templates[] = { config.run_command, config.run_shell_command, config.ssh_command };
+    if ( helper_templates == NULL ) {
+        helper_templates = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, helper_template_free );
+    }
+    for ( unsigned int i = 0; i < G_N_ELEMENTS ( templates ); i++ ) {
+        if ( templates[i] != NULL && !g_hash_table_contains ( helper_templates, templates[i] ) ) {
+            g_hash_table_insert ( helper_templates, g_strdup ( templates[i] ), helper_template_compile ( templates[i] ) );
+        }
+    }
+    if ( helper_spawn_env == NULL ) {
+        helper_spawn_env = g_get_environ ();
+    }
+}
+
+void helper_launch_cleanup ( void )
+{
+    if ( helper_templates != NULL ) {
+        g_hash_table_destroy ( helper_templates );
+        helper_templates = NULL;
+    }
+    g_strfreev ( helper_spawn_env );
+    helper_spawn_env = NULL;
 }
 
 int helper_parse_setup ( char * string, char ***output, int *length, ... )
@@ -112,19 +185,32 @@ int helper_parse_setup ( char * string, char ***output, int *length, ... )
     }
     va_end ( ap );
 
-    // Replace hits within {-\w+}.
-    GRegex *reg = g_regex_new ( "{[-\\w]+}", 0, 0, NULL );
-    char   *res = g_regex_replace_eval ( reg, string, -1, 0, 0, helper_eval_cb, h, NULL );
-    // Free regex.
-    g_regex_unref ( reg );
+    // Use the template compiled at startup, or compile it for this call.
+    HelperTemplate *compiled = NULL;
+    HelperTemplate *t        = ( helper_templates != NULL ) ? g_hash_table_lookup ( helper_templates, string ) : NULL;
+    if ( t == NULL ) {
+        t = compiled = helper_template_compile ( string );
+    }
+    // Replace the placeholders, unknown ones are dropped.
+    GString *res = g_string_new ( t->parts[0] );
+    for ( unsigned int i = 1; i < t->num_parts; i += 2 ) {
+        const char *value = g_hash_table_lookup ( h, t->parts[i] );
+        if ( value != NULL ) {
+            g_string_append ( res, value );
+        }
+        g_string_append ( res, t->parts[i + 1] );
+    }
+    if ( compiled != NULL ) {
+        helper_template_free ( compiled );
+    }
     // Destroy key-value storage.
     g_hash_table_destroy ( h );
     // Parse the string into shell arguments.
-    if ( g_shell_parse_argv ( res, length, output, &error ) ) {
-        g_free ( res );
+    if ( g_shell_parse_argv ( res->str, length, output, &error ) ) {
+        g_string_free ( res, TRUE );
         return TRUE;
     }
-    g_free ( res );
+    g_string_free ( res, TRUE );
     // Throw error if shell parsing fails.
     if ( error ) {
         char *msg = g_strdup_printf ( "Failed to parse: '%s'\nError: '%s'", string, error->message );
@@ -136,6 +222,70 @@ int helper_parse_setup ( char * string, char ***output, int *length, ... )
     return FALSE;
 }
 
+/**
+ * Mark the open file descriptors close-on-exec, so the launched process does not inherit
+ * them (like the locked pid file). posix_spawn does not close them, unlike g_spawn.
+ */
+static void helper_spawn_set_cloexec ( void )
+{
+    DIR *dir = opendir ( "/proc/self/fd" );
+    if ( dir != NULL ) {
+        struct dirent *entry;
+        while ( ( entry = readdir ( dir ) ) != NULL ) {
+            int fd = atoi ( entry->d_name );
+            if ( fd > 2 && fd != dirfd ( dir ) ) {
+                fcntl ( fd, F_SETFD, fcntl ( fd, F_GETFD ) | FD_CLOEXEC );
+            }
+        }
+        closedir ( dir );
+        return;
+    }
+    // No /proc, check them all.
+    long max = sysconf ( _SC_OPEN_MAX );
+    for ( int fd = 3; fd < max; fd++ ) {
+        int flags = fcntl ( fd, F_GETFD );
+        if ( flags >= 0 && !( flags & FD_CLOEXEC ) ) {
+            fcntl ( fd, F_SETFD, flags | FD_CLOEXEC );
+        }
+    }
+}
+
+static void helper_spawn_reap ( GPid pid, G_GNUC_UNUSED gint status, G_GNUC_UNUSED gpointer data )
+{
+    g_spawn_close_pid ( pid );
+}
+
+gboolean helper_spawn ( char **args, GError **error )
+{
+    if ( args == NULL || args[0] == NULL ) {
+        g_set_error ( error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED, "No command to execute" );
+        return FALSE;
+    }
+    if ( helper_spawn_env == NULL ) {
+        helper_spawn_env = g_get_environ ();
+    }
+    helper_spawn_set_cloexec ();
+
+    // Do not pass on signals blocked by rofi.
+    posix_spawnattr_t attr;
+    sigset_t          mask;
+    pid_t             pid;
+    posix_spawnattr_init ( &attr );
+    sigemptyset ( &mask );
+    posix_spawnattr_setsigmask ( &attr, &mask );
+    posix_spawnattr_setflags ( &attr, POSIX_SPAWN_SETSIGMASK );
+    int err = posix_spawnp ( &pid, args[0], NULL, &attr, args, helper_spawn_env );
+    posix_spawnattr_destroy ( &attr );
+    if ( err != 0 ) {
+        g_set_error ( error, G_SPAWN_ERROR, G_SPAWN_ERROR_FAILED, "Failed to execute child process \"%s\" (%s)",
+                      args[0], g_strerror ( err ) );
+        return FALSE;
+    }
+    // The process is a child of rofi now, reap it if it exits before rofi does.
+    g_child_watch_add ( pid, helper_spawn_reap, NULL );
+    return TRUE;
+}
+
 char *token_collate_key ( const char *token, int case_sensitive )
 {
     char *tmp, *compk;
@@ -28,8 +28,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -37,223 +42,536 @@
 #include "history.h"
 #include "settings.h"
 
-#define HISTORY_MAX_ENTRIES    25
+/** A use counts for half after this many seconds. */
+#define HISTORY_HALF_LIFE       ( 14 * 24 * 60 * 60 )
+/** The journal is compacted when the records appended since the last compaction grow beyond this size,
+ * and beyond the size of the compacted entries. */
+#define HISTORY_COMPACT_SIZE    8192
+/** Journal record: the entry was used, followed by the time of use. */
+#define HISTORY_RECORD_SET      '+'
+/** Journal record: the entry was removed. */
+#define HISTORY_RECORD_REMOVE   '-'
+/** Compacted entry: the score, the time of the last use and the name. */
+#define HISTORY_RECORD_ENTRY    '='
+/** First line of a compacted file: the size of the compacted entries that follow. */
+#define HISTORY_RECORD_HEADER   '#'
+
+/**
+ * A use queued by history_set_deferred().
+ */
+typedef struct
+{
+    char *filename;
+    char *entry;
+} _history_use;
+
+/** Writes the queued uses, one at a time and in order. */
+static GThreadPool *history_writer = NULL;
 
 typedef struct __element
 {
-    long int index;
+    /** The time-decayed use count, at the time of the last use. */
+    double   score;
+    /** The time of the last use. */
+    gint64   last;
+    /** The order the entry was last folded in, breaks ties. */
+    long int seq;
+    /** The score decayed to the time the history is loaded. */
+    double   rank;
     char     *name;
 }_element;
 
+/**
+ * The history, folded from the file.
+ */
+typedef struct
+{
+    /** Maps the name to the element, the table owns the elements. */
+    GHashTable *lookup;
+    /** The time used for entries written without one, by older versions. */
+    gint64     legacy_time;
+    /** The number of lines folded. */
+    long int   seq;
+} _history;
+
 static int __element_sort_func ( const void *ea, const void *eb, void *data __attribute__( ( unused ) ) )
 {
     _element *a = *(_element * *) ea;
     _element *b = *(_element * *) eb;
-    return b->index - a->index;
+    if ( a->rank != b->rank ) {
+        return ( a->rank < b->rank ) ? 1 : -1;
+    }
+    if ( a->last != b->last ) {
+        return ( a->last < b->last ) ? 1 : -1;
+    }
+    return ( a->seq < b->seq ) ? 1 : ( a->seq > b->seq ) ? -1 : 0;
 }
 
-static void __history_write_element_list ( FILE *fd, _element **list, unsigned int length )
+static void __element_free ( gpointer data )
 {
-    if ( list == NULL || length == 0 ) {
-        return;
-    }
-    // Sort the list before writing out.
-    g_qsort_with_data ( list, length, sizeof ( _element* ), __element_sort_func, NULL );
+    _element *e = (_element *) data;
+    g_free ( e->name );
+    g_free ( e );
+}
 
-    // Get minimum index.
-    int min_value = list[length - 1]->index;
+static void __history_init ( _history *h )
+{
+    h->lookup      = g_hash_table_new_full ( g_str_hash, g_str_equal, NULL, __element_free );
+    h->legacy_time = time ( NULL );
+    h->seq         = 0;
+}
 
-    // Set the max length of the list.
-    length = ( length > HISTORY_MAX_ENTRIES ) ? HISTORY_MAX_ENTRIES : length;
+static void __history_clear ( _history *h )
+{
+    g_hash_table_destroy ( h->lookup );
+}
 
-    // Write out entries.
-    for ( unsigned int iter = 0; iter < length; iter++ ) {
-        fprintf ( fd, "%ld %s\n", list[iter]->index - min_value, list[iter]->name );
-    }
+/**
+ * @param age The time since the use, in seconds.
+ *
+ * @returns the weight of a use age seconds ago: 1 now, halving every #HISTORY_HALF_LIFE.
+ */
+static double __history_decay ( gint64 age )
+{
+    return ( age > 0 ) ? exp2 ( -(double) age / HISTORY_HALF_LIFE ) : 1.0;
 }
 
-static _element ** __history_get_element_list ( FILE *fd, unsigned int *length )
+/**
+ * @param h The history.
+ * @param name The name, terminated at length.
+ * @param length The length of name.
+ *
+ * @returns the element for name, added with score 0 if not in the history yet.
+ */
+static _element * __history_get ( _history *h, const char *name, size_t length )
 {
-    _element **retv = NULL;
+    _element *e = g_hash_table_lookup ( h->lookup, name );
+    if ( e == NULL ) {
+        e       = g_malloc0 ( sizeof ( _element ) );
+        e->name = g_strndup ( name, length );
+        g_hash_table_insert ( h->lookup, e->name, e );
+    }
+    return e;
+}
 
-    if  ( length == NULL ) {
-        return NULL;
+/**
+ * @param h The history.
+ * @param name The name, terminated at length.
+ * @param length The length of name.
+ * @param when The time of the use.
+ *
+ * Count a use of the entry: the score is decayed to the time of the use, and incremented.
+ */
+static void __history_use ( _history *h, const char *name, size_t length, gint64 when )
+{
+    _element *e = __history_get ( h, name, length );
+    if ( when >= e->last ) {
+        e->score = e->score * __history_decay ( when - e->last ) + 1.0;
+        e->last  = when;
     }
-    *length = 0;
+    else {
+        // Appended after a later use by a concurrent writer.
+        e->score += __history_decay ( e->last - when );
+    }
+    e->seq = ++( h->seq );
+}
 
-    if ( fd == NULL ) {
-        return NULL;
+/**
+ * @param h The history.
+ * @param name The name, terminated at length.
+ * @param length The length of name.
+ * @param score The score at the time of the last use.
+ * @param last The time of the last use.
+ *
+ * Add a compacted entry. These are written most used first, earlier lines win ties.
+ */
+static void __history_set_entry ( _history *h, const char *name, size_t length, double score, gint64 last )
+{
+    _element *e = __history_get ( h, name, length );
+    e->score = score;
+    e->last  = last;
+    e->seq   = -( ++( h->seq ) );
+}
+
+/**
+ * @param h The history.
+ * @param line A line of the history file, without newline.
+ * @param l The length of the line.
+ *
+ * Fold one line into the history: a compacted entry, a journal record, or a "count name"
+ * line written before the journal.
+ */
+static void __history_fold_line ( _history *h, char *line, size_t l )
+{
+    char *end = NULL;
+    if ( line[0] == HISTORY_RECORD_HEADER ) {
+        return;
     }
-    char    *buffer       = NULL;
-    size_t  buffer_length = 0;
-    ssize_t l             = 0;
-    while ( ( l = getline ( &buffer, &buffer_length, fd ) ) > 0 ) {
-        char * start = NULL;
-        // Skip empty lines.
-        if ( l <= 1 ) {
-            continue;
+    // Names shorter than two characters were never read back, keep it that way.
+    if ( line[0] == HISTORY_RECORD_REMOVE && line[1] == ' ' ) {
+        if ( l >= 4 ) {
+            g_hash_table_remove ( h->lookup, line + 2 );
         }
-
-        long int index = strtol ( buffer, &start, 10 );
-        if ( start == buffer || *start == '\0' ) {
-            continue;
+        return;
+    }
+    if ( line[0] == HISTORY_RECORD_SET && line[1] == ' ' ) {
+        // Record without time.
+        if ( l >= 4 ) {
+            __history_use ( h, line + 2, l - 2, h->legacy_time );
+        }
+        return;
+    }
+    if ( line[0] == HISTORY_RECORD_SET && g_ascii_isdigit ( line[1] ) ) {
+        gint64 when = g_ascii_strtoll ( line + 1, &end, 10 );
+        if ( *end == ' ' && ( l - ( end + 1 - line ) ) >= 2 ) {
+            __history_use ( h, end + 1, l - ( end + 1 - line ), when );
         }
-        start++;
-        if ( ( l - ( start - buffer ) ) < 3 ) {
-            continue;
+        return;
+    }
+    if ( line[0] == HISTORY_RECORD_ENTRY ) {
+        double score = g_ascii_strtod ( line + 1, &end );
+        // Also refuses nan and inf.
+        if ( end == line + 1 || *end != ' ' || !( score >= 0.0 && score <= G_MAXDOUBLE ) ) {
+            return;
         }
-        // Resize and check.
-        retv = g_realloc ( retv, ( *length + 2 ) * sizeof ( _element* ) );
-
-        retv[( *length )] = g_malloc ( sizeof ( _element ) );
-
-        // remove trailing \n
-        buffer[l - 1] = '\0';
-        // Parse the number of times.
-        retv[( *length )]->index = index;
-        retv[( *length )]->name  = g_strndup ( start, l - 1 - ( start - buffer ) );
-        // Force trailing '\0'
-        retv[( *length ) + 1] = NULL;
+        char   *name = NULL;
+        gint64 last  = g_ascii_strtoll ( end + 1, &name, 10 );
+        if ( name == end + 1 || *name != ' ' || ( l - ( name + 1 - line ) ) < 2 ) {
+            return;
+        }
+        __history_set_entry ( h, name + 1, l - ( name + 1 - line ), score, last );
+        return;
+    }
 
-        ( *length )++;
+    long int index = strtol ( line, &end, 10 );
+    if ( end == line || *end == '\0' ) {
+        return;
     }
-    if ( buffer != NULL  ) {
-        free ( buffer );
-        buffer = NULL;
+    end++;
+    if ( ( l - ( end - line ) ) < 2 ) {
+        return;
     }
-    return retv;
+    __history_set_entry ( h, end, l - ( end - line ), MAX ( index, 0 ), h->legacy_time );
 }
 
-void history_set ( const char *filename, const char *entry )
+/**
+ * @param h The history.
+ * @param length Set to the number of entries returned.
+ *
+ * Rank the entries on their score decayed to now, and keep the #_Settings::max_history_size best.
+ *
+ * @returns the ranked entries, owned by the history. Free the array with g_free().
+ */
+static _element ** __history_rank ( _history *h, unsigned int *length )
 {
-    if ( config.disable_history ) {
-        return;
+    gint64         now  = time ( NULL );
+    unsigned int   size = g_hash_table_size ( h->lookup );
+    _element       **list = g_malloc ( ( size + 1 ) * sizeof ( _element* ) );
+    GHashTableIter iter;
+    gpointer       value;
+    unsigned int   index = 0;
+    g_hash_table_iter_init ( &iter, h->lookup );
+    while ( g_hash_table_iter_next ( &iter, NULL, &value ) ) {
+        _element *e = (_element *) value;
+        e->rank       = e->score * __history_decay ( now - e->last );
+        list[index++] = e;
     }
-    int          found  = 0;
-    unsigned int curr   = 0;
-    unsigned int length = 0;
-    _element     **list = NULL;
-    // Open file for reading and writing.
-    FILE         *fd = g_fopen ( filename, "r" );
-    if ( fd != NULL ) {
-        // Get list.
-        list = __history_get_element_list ( fd, &length );
-        // Close file, if fails let user know on stderr.
-        if ( fclose ( fd ) != 0 ) {
-            fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
+    g_qsort_with_data ( list, size, sizeof ( _element* ), __element_sort_func, NULL );
+    *length = MIN ( size, config.max_history_size );
+    return list;
+}
+
+/**
+ * @param fd The history file.
+ * @param h The history to fold the file into.
+ * @param offset The position to start reading, set to the end of the last complete line.
+ *
+ * Fold the file from offset on into the history. An incomplete last line, left by an
+ * interrupted write, is ignored.
+ *
+ * @returns FALSE if the file could not be read.
+ */
+static gboolean __history_load ( int fd, _history *h, off_t *offset )
+{
+    GString     *data = g_string_new ( NULL );
+    char        buffer[4096];
+    ssize_t     r;
+    struct stat st;
+    if ( *offset == 0 && fstat ( fd, &st ) == 0 ) {
+        // Entries written without a time count as used when the file was last written.
+        h->legacy_time = st.st_mtime;
+    }
+    while ( ( r = pread ( fd, buffer, sizeof ( buffer ), *offset + data->len ) ) != 0 ) {
+        if ( r < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            fprintf ( stderr, "Failed to read history file: %s\n", strerror ( errno ) );
+            g_string_free ( data, TRUE );
+            return FALSE;
         }
+        g_string_append_len ( data, buffer, r );
     }
-    // Look if the entry exists.
-    for ( unsigned int iter = 0; !found && iter < length; iter++ ) {
-        if ( strcmp ( list[iter]->name, entry ) == 0 ) {
-            curr  = iter;
-            found = 1;
+    char *line = data->str;
+    char *end;
+    while ( ( end = memchr ( line, '\n', data->len - ( line - data->str ) ) ) != NULL ) {
+        *end = '\0';
+        // Skip empty lines.
+        if ( end > line ) {
+            __history_fold_line ( h, line, end - line );
         }
+        line = end + 1;
+    }
+    *offset += line - data->str;
+    g_string_free ( data, TRUE );
+    return TRUE;
+}
+
+/**
+ * @param fd The history file.
+ * @param record The record type.
+ * @param entry The entry.
+ *
+ * Append one record to the journal, in a single write so records of concurrent writers do not interleave.
+ * A use is recorded with the current time.
+ */
+static void __history_append_record ( int fd, char record, const char *entry )
+{
+    char    *line = ( record == HISTORY_RECORD_SET )
+                    ? g_strdup_printf ( "%c%" G_GINT64_FORMAT " %s\n", record, (gint64) time ( NULL ), entry )
+                    : g_strdup_printf ( "%c %s\n", record, entry );
+    size_t  length = strlen ( line );
+    ssize_t r;
+    do {
+        r = write ( fd, line, length );
+    } while ( r < 0 && errno == EINTR );
+    if ( r != (ssize_t) length ) {
+        fprintf ( stderr, "Failed to write history file: %s\n", r < 0 ? strerror ( errno ) : "short write" );
+    }
+    g_free ( line );
+}
+
+/**
+ * @param fd The file to write to.
+ * @param list The ranked entries.
+ * @param length The number of entries.
+ *
+ * Write the compacted history: a header with the size of the entries, so a writer can tell how
+ * much was appended since, followed by the entries.
+ *
+ * @returns TRUE if the file was written and synced.
+ */
+static gboolean __history_write_element_list ( FILE *fd, _element * const *list, unsigned int length )
+{
+    GString *entries = g_string_new ( NULL );
+    char    score[G_ASCII_DTOSTR_BUF_SIZE];
+    for ( unsigned int iter = 0; iter < length; iter++ ) {
+        g_string_append_printf ( entries, "%c%s %" G_GINT64_FORMAT " %s\n", HISTORY_RECORD_ENTRY,
+                                 g_ascii_dtostr ( score, sizeof ( score ), list[iter]->score ), list[iter]->last, list[iter]->name );
     }
+    fprintf ( fd, "%c%" G_GSIZE_FORMAT "\n", HISTORY_RECORD_HEADER, entries->len );
+    fwrite ( entries->str, 1, entries->len, fd );
+    g_string_free ( entries, TRUE );
+    return !ferror ( fd ) && fflush ( fd ) == 0 && fsync ( fileno ( fd ) ) == 0;
+}
 
-    if ( found ) {
-        // If exists, increment list index number
-        list[curr]->index++;
+/**
+ * @param fd The history file.
+ *
+ * @returns the size of the compacted part of the file, read from its header, or -1 if the file
+ * was not written by a compaction.
+ */
+static off_t __history_compacted_size ( int fd )
+{
+    char    buffer[32];
+    ssize_t r = pread ( fd, buffer, sizeof ( buffer ) - 1, 0 );
+    if ( r <= 0 || buffer[0] != HISTORY_RECORD_HEADER ) {
+        return -1;
+    }
+    buffer[r] = '\0';
+    char   *end = NULL;
+    gint64 size = g_ascii_strtoll ( buffer + 1, &end, 10 );
+    if ( end == buffer + 1 || *end != '\n' || size < 0 ) {
+        return -1;
     }
-    else{
-        // If not exists, add it.
-        // Increase list by one
-        list         = g_realloc ( list, ( length + 2 ) * sizeof ( _element* ) );
-        list[length] = g_malloc ( sizeof ( _element ) );
-        // Copy name
-        if ( list[length] != NULL ) {
-            list[length]->name = g_strdup ( entry );
-            // set # hits
-            list[length]->index = 1;
+    return ( end + 1 - buffer ) + size;
+}
+
+/**
+ * @param filename The filename of the history cache.
+ * @param fd The opened history file.
+ *
+ * @returns TRUE if fd is still the file at filename, and not replaced by a compaction.
+ */
+static gboolean __history_is_current ( const char *filename, int fd )
+{
+    struct stat fst, pst;
+    return fstat ( fd, &fst ) == 0 && g_stat ( filename, &pst ) == 0 && fst.st_ino == pst.st_ino && fst.st_dev == pst.st_dev;
+}
 
-            length++;
-            list[length] = NULL;
+/**
+ * @param filename The filename of the history cache.
+ * @param flags The extra open flags.
+ *
+ * Open the history file to append a record. The file is locked shared, so records are never
+ * appended to a file that is being replaced by a compaction.
+ *
+ * @returns the locked file descriptor, or -1 on failure.
+ */
+static int __history_open_append ( const char *filename, int flags )
+{
+    for ( unsigned int retry = 0; retry < 8; retry++ ) {
+        int fd = g_open ( filename, O_RDWR | O_APPEND | O_CLOEXEC | flags, 0666 );
+        if ( fd < 0 ) {
+            fprintf ( stderr, "Failed to open file: %s\n", strerror ( errno ) );
+            return -1;
+        }
+        if ( flock ( fd, LOCK_SH ) == 0 && __history_is_current ( filename, fd ) ) {
+            return fd;
         }
+        // Compacted while we waited for the lock, open the new file.
+        close ( fd );
     }
+    fprintf ( stderr, "Failed to lock history file: %s\n", filename );
+    return -1;
+}
 
-    fd = fopen ( filename, "w" );
-    if ( fd == NULL ) {
-        fprintf ( stderr, "Failed to open file: %s\n", strerror ( errno ) );
+/**
+ * @param filename The filename of the history cache.
+ * @param fd The history file, open for reading.
+ *
+ * Replace the journal by the folded history, written to a temporary file that is renamed over it.
+ * Only the #_Settings::max_history_size best ranked entries are kept.
+ * Writers hold a shared lock while appending, the exclusive lock makes sure no record is
+ * appended to the old file after it is read. If the lock is taken, compaction is left for later.
+ */
+static void __history_compact ( const char *filename, int fd )
+{
+    if ( flock ( fd, LOCK_EX | LOCK_NB ) != 0 ) {
+        return;
     }
-    else {
-        // Write list.
-        __history_write_element_list ( fd, list, length );
-        // Close file, if fails let user know on stderr.
-        if ( fclose ( fd ) != 0 ) {
-            fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
-        }
+    // Another process compacted it already.
+    if ( !__history_is_current ( filename, fd ) ) {
+        flock ( fd, LOCK_UN );
+        return;
     }
-    // Free the list.
-    for ( unsigned int iter = 0; iter < length; iter++ ) {
-        g_free ( list[iter]->name );
-        g_free ( list[iter] );
+
+    _history h;
+    off_t    offset = 0;
+    __history_init ( &h );
+    if ( __history_load ( fd, &h, &offset ) ) {
+        char *tmpfile = g_strdup_printf ( "%s.XXXXXX", filename );
+        int  tfd      = g_mkstemp ( tmpfile );
+        FILE *fp      = ( tfd >= 0 ) ? fdopen ( tfd, "w" ) : NULL;
+        if ( fp == NULL ) {
+            fprintf ( stderr, "Failed to write history file: %s\n", strerror ( errno ) );
+            if ( tfd >= 0 ) {
+                close ( tfd );
+                g_unlink ( tmpfile );
+            }
+        }
+        else {
+            unsigned int length;
+            _element     **list = __history_rank ( &h, &length );
+            gboolean     ok     = __history_write_element_list ( fp, list, length );
+            g_free ( list );
+            if ( fclose ( fp ) != 0 || !ok || g_rename ( tmpfile, filename ) != 0 ) {
+                fprintf ( stderr, "Failed to write history file: %s\n", strerror ( errno ) );
+                g_unlink ( tmpfile );
+            }
+        }
+        g_free ( tmpfile );
     }
-    g_free ( list );
+    __history_clear ( &h );
+    flock ( fd, LOCK_UN );
 }
 
-void history_remove ( const char *filename, const char *entry )
+void history_set ( const char *filename, const char *entry )
 {
     if ( config.disable_history ) {
         return;
     }
-    _element     ** list = NULL;
-    int          found   = 0;
-    unsigned int curr    = 0;
-    unsigned int length  = 0;
-    // Open file for reading and writing.
-    FILE         *fd = g_fopen ( filename, "r" );
-    if ( fd == NULL ) {
-        fprintf ( stderr, "Failed to open file: %s\n", strerror ( errno ) );
+    // Only append a record, the history is folded when it is read.
+    int fd = __history_open_append ( filename, O_CREAT );
+    if ( fd < 0 ) {
         return;
     }
-    // Get list.
-    list = __history_get_element_list ( fd, &length );
+    __history_append_record ( fd, HISTORY_RECORD_SET, entry );
 
+    // Compact when the journal outgrows the compacted entries, so a write costs amortized constant time.
+    // A file without header, new or written by an older version, is compacted right away.
+    struct stat st;
+    off_t       compacted = __history_compacted_size ( fd );
+    gboolean    compact   = FALSE;
+    if ( fstat ( fd, &st ) == 0 ) {
+        off_t journal = st.st_size - compacted;
+        compact = compacted < 0 || ( journal > HISTORY_COMPACT_SIZE && journal > compacted );
+    }
+    flock ( fd, LOCK_UN );
+    if ( compact ) {
+        __history_compact ( filename, fd );
+    }
     // Close file, if fails let user know on stderr.
-    if ( fclose ( fd ) != 0 ) {
+    if ( close ( fd ) != 0 ) {
         fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
     }
-    // Find entry.
-    for ( unsigned int iter = 0; !found && iter < length; iter++ ) {
-        if ( strcmp ( list[iter]->name, entry ) == 0 ) {
-            curr  = iter;
-            found = 1;
+}
+
+static void __history_write_use ( gpointer data, G_GNUC_UNUSED gpointer user_data )
+{
+    _history_use *use = (_history_use *) data;
+    history_set ( use->filename, use->entry );
+    g_free ( use->filename );
+    g_free ( use->entry );
+    g_free ( use );
+}
+
+void history_set_deferred ( const char *filename, const char *entry )
+{
+    if ( config.disable_history ) {
+        return;
+    }
+    if ( history_writer == NULL ) {
+        GError *error = NULL;
+        history_writer = g_thread_pool_new ( __history_write_use, NULL, 1, FALSE, &error );
+        if ( error != NULL ) {
+            fprintf ( stderr, "Failed to start history writer: %s\n", error->message );
+            g_error_free ( error );
+            history_writer = NULL;
+            history_set ( filename, entry );
+            return;
         }
     }
+    _history_use *use = g_malloc ( sizeof ( _history_use ) );
+    use->filename = g_strdup ( filename );
+    use->entry    = g_strdup ( entry );
+    g_thread_pool_push ( history_writer, use, NULL );
+}
 
-    // If found, remove it and write out new file.
-    if ( found ) {
-        // Remove the entry.
-        g_free ( list[curr]->name );
-        g_free ( list[curr] );
-        // Swap last to here (if list is size 1, we just swap empty sets).
-        list[curr] = list[length - 1];
-        // Empty last.
-        list[length - 1] = NULL;
-        length--;
-
-        fd = g_fopen ( filename, "w" );
-        // Clear list.
-        if ( fd != NULL ) {
-            // Write list.
-            __history_write_element_list ( fd, list, length );
-            // Close file, if fails let user know on stderr.
-            if ( fclose ( fd ) != 0 ) {
-                fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
-            }
-        }
-        else{
-            fprintf ( stderr, "Failed to open file: %s\n", strerror ( errno ) );
-        }
+void history_flush ( void )
+{
+    if ( history_writer != NULL ) {
+        // Wait for the queued uses to be written.
+        g_thread_pool_free ( history_writer, FALSE, TRUE );
+        history_writer = NULL;
     }
+}
 
-    // Free the list.
-    for ( unsigned int iter = 0; iter < length; iter++ ) {
-        g_free ( list[iter]->name );
-        g_free ( list[iter] );
+void history_remove ( const char *filename, const char *entry )
+{
+    if ( config.disable_history ) {
+        return;
     }
-    if ( list != NULL ) {
-        g_free ( list );
+    // Keep the records in order.
+    history_flush ();
+    int fd = __history_open_append ( filename, 0 );
+    if ( fd < 0 ) {
+        return;
+    }
+    __history_append_record ( fd, HISTORY_RECORD_REMOVE, entry );
+    // Close file, if fails let user know on stderr.
+    if ( close ( fd ) != 0 ) {
+        fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
     }
 }
 
@@ -264,11 +582,12 @@ char ** history_get_list ( const char *filename, unsigned int *length )
     if ( config.disable_history ) {
         return NULL;
     }
-    _element **list = NULL;
-    char     **retv = NULL;
+    // Include the uses still queued.
+    history_flush ();
+    char **retv = NULL;
     // Open file.
-    FILE     *fd = g_fopen ( filename, "r" );
-    if ( fd == NULL ) {
+    int  fd = g_open ( filename, O_RDONLY | O_CLOEXEC, 0 );
+    if ( fd < 0 ) {
         // File that does not exists is not an error, so ignore it.
         // Everything else? panic.
         if ( errno != ENOENT ) {
@@ -277,23 +596,37 @@ char ** history_get_list ( const char *filename, unsigned int *length )
         return NULL;
     }
     // Get list.
-    list = __history_get_element_list ( fd, length );
-
-    // Copy list in right format.
-    // Lists are always short, so performance should not be an issue.
-    if ( ( *length ) > 0 ) {
-        retv = g_malloc ( ( ( *length ) + 1 ) * sizeof ( char * ) );
-        for ( unsigned int iter = 0; iter < ( *length ); iter++ ) {
-            retv[iter] = ( list[iter]->name );
-            g_free ( list[iter] );
+    _history h;
+    off_t    offset = 0;
+    __history_init ( &h );
+    __history_load ( fd, &h, &offset );
+
+    // Rank once, and copy list in right format.
+    unsigned int num;
+    _element     **list = __history_rank ( &h, &num );
+    if ( num > 0 ) {
+        retv = g_malloc ( ( num + 1 ) * sizeof ( char * ) );
+        for ( unsigned int iter = 0; iter < num; iter++ ) {
+            retv[iter] = g_strdup ( list[iter]->name );
         }
-        retv[( *length )] = NULL;
-        g_free ( list );
+        retv[num] = NULL;
+        *length   = num;
     }
+    g_free ( list );
+    __history_clear ( &h );
 
     // Close file, if fails let user know on stderr.
-    if ( fclose ( fd ) != 0 ) {
+    if ( close ( fd ) != 0 ) {
         fprintf ( stderr, "Failed to close history file: %s\n", strerror ( errno ) );
     }
     return retv;
 }
+
+GHashTable * history_index ( char * const *entries, unsigned int length )
+{
+    GHashTable *retv = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, NULL );
+    for ( unsigned int iter = 0; iter < length; iter++ ) {
+        g_hash_table_add ( retv, g_strdup ( entries[iter] ) );
+    }
+    return retv;
+}
@@ -45,70 +45,180 @@
 #ifdef HAVE_I3_IPC_H
 #include <i3/ipc.h>
 // Path to HAVE_I3_IPC_H socket.
-char *i3_socket_path = NULL;
-void i3_support_focus_window ( xcb_window_t id )
+char       *i3_socket_path = NULL;
+// Connection to i3, kept open between requests.
+static int i3_socket = -1;
+
+/**
+ * Open the connection to i3, if not already open.
+ *
+ * @returns TRUE if connected.
+ */
+static gboolean i3_support_connect ( void )
 {
-    i3_ipc_header_t    head;
-    int                s;
-    ssize_t            t;
     struct sockaddr_un remote;
     size_t             upm = sizeof ( remote.sun_path );
-    char               command[upm];
 
-    if ( strlen ( i3_socket_path ) > upm ) {
-        fprintf ( stderr, "Socket path is too long. %zu > %zu\n", strlen ( i3_socket_path ), upm );
-        return;
+    if ( i3_socket >= 0 ) {
+        return TRUE;
+    }
+    if ( i3_socket_path == NULL ) {
+        return FALSE;
+    }
+    if ( strlen ( i3_socket_path ) >= upm ) {
+        fprintf ( stderr, "Socket path is too long. %zu >= %zu\n", strlen ( i3_socket_path ), upm );
+        return FALSE;
     }
 
-    if ( ( s = socket ( AF_UNIX, SOCK_STREAM, 0 ) ) == -1 ) {
+    if ( ( i3_socket = socket ( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 ) ) == -1 ) {
         fprintf ( stderr, "Failed to open connection to I3: %s\n", strerror ( errno ) );
-        return;
+        return FALSE;
     }
 
     remote.sun_family = AF_UNIX;
     g_strlcpy ( remote.sun_path, i3_socket_path, upm );
 
-    if ( connect ( s, ( struct sockaddr * ) &remote, sizeof ( struct sockaddr_un ) ) == -1 ) {
+    if ( connect ( i3_socket, ( struct sockaddr * ) &remote, sizeof ( struct sockaddr_un ) ) == -1 ) {
         fprintf ( stderr, "Failed to connect to I3 (%s): %s\n", i3_socket_path, strerror ( errno ) );
-        close ( s );
-        return;
+        close ( i3_socket );
+        i3_socket = -1;
+        return FALSE;
     }
+    return TRUE;
+}
 
-    // Formulate command
-    snprintf ( command, upm, "[id=\"%u\"] focus", id );
-    // Prepare header.
-    memcpy ( head.magic, I3_IPC_MAGIC, 6 );
-    head.size = strlen ( command );
-    head.type = I3_IPC_MESSAGE_TYPE_COMMAND;
-    // Send header.
-    t = send ( s, &head, sizeof ( i3_ipc_header_t ), 0 );
-    if ( t == -1 ) {
-        char *msg = g_strdup_printf ( "Failed to send message header to i3: %s\n", strerror ( errno ) );
-        rofi_view_error_dialog ( msg, FALSE );
-        g_free ( msg );
-        close ( s );
-        return;
+static void i3_support_disconnect ( void )
+{
+    if ( i3_socket >= 0 ) {
+        close ( i3_socket );
+        i3_socket = -1;
     }
-    // Send message
-    t = send ( s, command, strlen ( command ), 0 );
-    if ( t == -1 ) {
-        char *msg = g_strdup_printf ( "Failed to send message body to i3: %s\n", strerror ( errno ) );
-        rofi_view_error_dialog ( msg, FALSE  );
-        g_free ( msg );
-        close ( s );
-        return;
+}
+
+/**
+ * @param data The data to send.
+ * @param length The length of data.
+ *
+ * @returns TRUE if all data was sent.
+ */
+static gboolean i3_support_send ( const void *data, size_t length )
+{
+    const char *p = data;
+    while ( length > 0 ) {
+        // Do not get killed by SIGPIPE when i3 restarted.
+        ssize_t t = send ( i3_socket, p, length, MSG_NOSIGNAL );
+        if ( t == -1 && errno == EINTR ) {
+            continue;
+        }
+        if ( t <= 0 ) {
+            return FALSE;
+        }
+        p      += t;
+        length -= t;
     }
-    // Receive header.
-    t = recv ( s, &head, sizeof ( head ), 0 );
+    return TRUE;
+}
 
-    if ( t == sizeof ( head ) ) {
-        t = recv ( s, command, head.size, 0 );
-        if ( t == head.size ) {
-            // Response.
+/**
+ * @param data The buffer to fill.
+ * @param length The number of bytes to read.
+ *
+ * @returns TRUE if length bytes were read.
+ */
+static gboolean i3_support_recv ( void *data, size_t length )
+{
+    char *p = data;
+    while ( length > 0 ) {
+        ssize_t t = recv ( i3_socket, p, length, 0 );
+        if ( t == -1 && errno == EINTR ) {
+            continue;
         }
+        if ( t <= 0 ) {
+            return FALSE;
+        }
+        p      += t;
+        length -= t;
     }
+    return TRUE;
+}
 
-    close ( s );
+/**
+ * @param type The message type.
+ * @param payload The message.
+ * @param length Set to the length of the reply.
+ *
+ * Send a message to i3 over the (persistent) connection and wait for the reply.
+ * If the connection was closed since the last message, e.g. because i3 restarted,
+ * it is opened again once.
+ *
+ * @returns the reply (NUL terminated), free with g_free(), or NULL on failure.
+ */
+static char *i3_support_message ( uint32_t type, const char *payload, uint32_t *length )
+{
+    for ( int attempt = 0; attempt < 2; attempt++ ) {
+        gboolean        reused = ( i3_socket >= 0 );
+        i3_ipc_header_t head;
+        if ( !i3_support_connect () ) {
+            return NULL;
+        }
+        // Prepare header.
+        memcpy ( head.magic, I3_IPC_MAGIC, 6 );
+        head.size = strlen ( payload );
+        head.type = type;
+        if ( i3_support_send ( &head, sizeof ( i3_ipc_header_t ) ) && i3_support_send ( payload, head.size )
+             && i3_support_recv ( &head, sizeof ( head ) ) ) {
+            if ( memcmp ( head.magic, I3_IPC_MAGIC, 6 ) != 0 || head.type != type ) {
+                fprintf ( stderr, "Unexpected reply from i3.\n" );
+                i3_support_disconnect ();
+                return NULL;
+            }
+            char *reply = g_malloc ( head.size + 1 );
+            if ( i3_support_recv ( reply, head.size ) ) {
+                reply[head.size] = '\0';
+                *length          = head.size;
+                return reply;
+            }
+            g_free ( reply );
+        }
+        int err = errno;
+        i3_support_disconnect ();
+        if ( !reused ) {
+            fprintf ( stderr, "Failed to talk to i3: %s\n", strerror ( err ) );
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+void i3_support_focus_window ( xcb_window_t id )
+{
+    char     command[128];
+    uint32_t length;
+
+    // Formulate command
+    snprintf ( command, sizeof ( command ), "[id=\"%u\"] focus", id );
+    char *reply = i3_support_message ( I3_IPC_MESSAGE_TYPE_COMMAND, command, &length );
+    if ( reply == NULL ) {
+        rofi_view_error_dialog ( "Failed to send message to i3.", FALSE );
+        return;
+    }
+    g_free ( reply );
+}
+
+I3Window * i3_support_get_windows ( unsigned int *num )
+{
+    uint32_t length;
+    *num = 0;
+    char     *reply = i3_support_message ( I3_IPC_MESSAGE_TYPE_GET_TREE, "", &length );
+    if ( reply == NULL ) {
+        return NULL;
+    }
+    I3Window *windows = i3_tree_parse ( reply, length, num );
+    if ( windows == NULL ) {
+        fprintf ( stderr, "Failed to parse the layout tree from i3.\n" );
+    }
+    g_free ( reply );
+    return windows;
 }
 
 int i3_support_initialize ( xcb_stuff *xcb )
@@ -124,6 +234,7 @@ int i3_support_initialize ( xcb_stuff *xcb )
 
 void i3_support_free_internals ( void )
 {
+    i3_support_disconnect ();
     g_free ( i3_socket_path );
     i3_socket_path = NULL;
 }
@@ -139,6 +250,12 @@ void i3_support_free_internals ( void )
 {
 }
 
+I3Window * i3_support_get_windows ( unsigned int *num )
+{
+    *num = 0;
+    return NULL;
+}
+
 int i3_support_initialize ( G_GNUC_UNUSED xcb_stuff *xcb )
 {
     return FALSE;
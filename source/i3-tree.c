@@ -0,0 +1,532 @@
+/**
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright 2013-2016 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include "i3-tree.h"
+
+/** Containers nested deeper than this make the reply invalid. */
+#define I3_TREE_MAX_DEPTH    128
+
+/**
+ * Position in the JSON text.
+ */
+typedef struct
+{
+    const char   *p;
+    const char   *end;
+    unsigned int depth;
+} JsonReader;
+
+static void json_skip_ws ( JsonReader *r )
+{
+    while ( r->p < r->end && ( *r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r' ) ) {
+        r->p++;
+    }
+}
+
+/**
+ * @param r The reader.
+ * @param c The character.
+ *
+ * Consume c if it is the next character after whitespace.
+ *
+ * @returns TRUE if c was consumed.
+ */
+static gboolean json_accept ( JsonReader *r, char c )
+{
+    json_skip_ws ( r );
+    if ( r->p < r->end && *r->p == c ) {
+        r->p++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @param r The reader.
+ * @param word The literal.
+ *
+ * @returns TRUE if the literal (true, false, null) was consumed.
+ */
+static gboolean json_accept_literal ( JsonReader *r, const char *word )
+{
+    size_t len = strlen ( word );
+    json_skip_ws ( r );
+    if ( (size_t) ( r->end - r->p ) >= len && memcmp ( r->p, word, len ) == 0 ) {
+        r->p += len;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * @param r The reader, positioned after the opening quote.
+ * @param out Buffer to append the unescaped string to, NULL to skip the string.
+ *
+ * @returns TRUE if the string was read up to and including the closing quote.
+ */
+static gboolean json_read_string_body ( JsonReader *r, GString *out )
+{
+    while ( r->p < r->end ) {
+        const char *start = r->p;
+        while ( r->p < r->end && *r->p != '"' && *r->p != '\\' ) {
+            r->p++;
+        }
+        if ( out != NULL ) {
+            g_string_append_len ( out, start, r->p - start );
+        }
+        if ( r->p >= r->end ) {
+            return FALSE;
+        }
+        if ( *r->p == '"' ) {
+            r->p++;
+            return TRUE;
+        }
+        // Escape sequence.
+        if ( r->end - r->p < 2 ) {
+            return FALSE;
+        }
+        char c = r->p[1];
+        r->p += 2;
+        if ( c == 'u' ) {
+            gunichar u = 0;
+            for ( int pass = 0; pass < 2; pass++ ) {
+                if ( r->end - r->p < 4 ) {
+                    return FALSE;
+                }
+                gunichar v = 0;
+                for ( int i = 0; i < 4; i++ ) {
+                    int d = g_ascii_xdigit_value ( r->p[i] );
+                    if ( d < 0 ) {
+                        return FALSE;
+                    }
+                    v = ( v << 4 ) | d;
+                }
+                r->p += 4;
+                if ( pass == 0 ) {
+                    u = v;
+                    // A high surrogate should be followed by an escaped low surrogate.
+                    if ( u < 0xD800 || u > 0xDBFF || r->end - r->p < 2 || r->p[0] != '\\' || r->p[1] != 'u' ) {
+                        break;
+                    }
+                    r->p += 2;
+                }
+                else if ( v >= 0xDC00 && v <= 0xDFFF ) {
+                    u = 0x10000 + ( ( u - 0xD800 ) << 10 ) + ( v - 0xDC00 );
+                }
+                else {
+                    return FALSE;
+                }
+            }
+            if ( out != NULL ) {
+                // Lone surrogates can not be encoded.
+                g_string_append_unichar ( out, ( u >= 0xD800 && u <= 0xDFFF ) ? 0xFFFD : u );
+            }
+            continue;
+        }
+        switch ( c )
+        {
+        case '"':
+        case '\\':
+        case '/':
+            break;
+        case 'b':
+            c = '\b';
+            break;
+        case 'f':
+            c = '\f';
+            break;
+        case 'n':
+            c = '\n';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        default:
+            return FALSE;
+        }
+        if ( out != NULL ) {
+            g_string_append_c ( out, c );
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @param r The reader.
+ * @param ok Set to FALSE on a syntax error.
+ *
+ * Read a string or null.
+ *
+ * @returns the unescaped string, or NULL for null or on error.
+ */
+static char *json_read_string ( JsonReader *r, gboolean *ok )
+{
+    if ( json_accept_literal ( r, "null" ) ) {
+        return NULL;
+    }
+    if ( !json_accept ( r, '"' ) ) {
+        *ok = FALSE;
+        return NULL;
+    }
+    GString *str = g_string_new ( NULL );
+    if ( !json_read_string_body ( r, str ) ) {
+        g_string_free ( str, TRUE );
+        *ok = FALSE;
+        return NULL;
+    }
+    return g_string_free ( str, FALSE );
+}
+
+/**
+ * @param r The reader.
+ * @param ok Set to FALSE on a syntax error.
+ *
+ * @returns the value of true or false.
+ */
+static gboolean json_read_boolean ( JsonReader *r, gboolean *ok )
+{
+    if ( json_accept_literal ( r, "true" ) ) {
+        return TRUE;
+    }
+    if ( !json_accept_literal ( r, "false" ) ) {
+        *ok = FALSE;
+    }
+    return FALSE;
+}
+
+/**
+ * @param r The reader.
+ * @param key Set to the start of the key, it is not unescaped.
+ * @param length Set to the length of the key.
+ * @param first The first member of the object.
+ * @param ok Set to FALSE on a syntax error.
+ *
+ * Read the next key of an object, and the colon after it. Call after the '{', or after a value.
+ *
+ * @returns FALSE at the end of the object, or on error.
+ */
+static gboolean json_next_member ( JsonReader *r, const char **key, size_t *length, gboolean first, gboolean *ok )
+{
+    if ( json_accept ( r, '}' ) ) {
+        return FALSE;
+    }
+    if ( !first && !json_accept ( r, ',' ) ) {
+        *ok = FALSE;
+        return FALSE;
+    }
+    if ( !json_accept ( r, '"' ) ) {
+        *ok = FALSE;
+        return FALSE;
+    }
+    *key = r->p;
+    if ( !json_read_string_body ( r, NULL ) ) {
+        *ok = FALSE;
+        return FALSE;
+    }
+    // Without the closing quote.
+    *length = r->p - 1 - *key;
+    if ( !json_accept ( r, ':' ) ) {
+        *ok = FALSE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @param r The reader.
+ * @param first The first element of the array.
+ * @param ok Set to FALSE on a syntax error.
+ *
+ * Move to the next element of an array. Call after the '[', or after a value.
+ *
+ * @returns FALSE at the end of the array, or on error.
+ */
+static gboolean json_next_element ( JsonReader *r, gboolean first, gboolean *ok )
+{
+    if ( json_accept ( r, ']' ) ) {
+        return FALSE;
+    }
+    if ( !first && !json_accept ( r, ',' ) ) {
+        *ok = FALSE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean json_skip_value ( JsonReader *r );
+
+/**
+ * @param r The reader, after the '{'.
+ *
+ * @returns TRUE if the rest of the object was skipped.
+ */
+static gboolean json_skip_object ( JsonReader *r )
+{
+    gboolean   ok = TRUE;
+    const char *key;
+    size_t     length;
+    for ( gboolean first = TRUE; json_next_member ( r, &key, &length, first, &ok ); first = FALSE ) {
+        if ( !json_skip_value ( r ) ) {
+            return FALSE;
+        }
+    }
+    return ok;
+}
+
+/**
+ * @param r The reader.
+ *
+ * Skip over the next value, whatever its type.
+ *
+ * @returns TRUE if a valid value was skipped.
+ */
+static gboolean json_skip_value ( JsonReader *r )
+{
+    gboolean ok = TRUE;
+    json_skip_ws ( r );
+    if ( r->p >= r->end ) {
+        return FALSE;
+    }
+    switch ( *r->p )
+    {
+    case '"':
+        r->p++;
+        return json_read_string_body ( r, NULL );
+    case '{':
+        if ( ++r->depth > I3_TREE_MAX_DEPTH ) {
+            return FALSE;
+        }
+        r->p++;
+        ok = json_skip_object ( r );
+        r->depth--;
+        return ok;
+    case '[':
+        if ( ++r->depth > I3_TREE_MAX_DEPTH ) {
+            return FALSE;
+        }
+        r->p++;
+        for ( gboolean first = TRUE; json_next_element ( r, first, &ok ); first = FALSE ) {
+            if ( !json_skip_value ( r ) ) {
+                return FALSE;
+            }
+        }
+        r->depth--;
+        return ok;
+    case 't':
+        return json_accept_literal ( r, "true" );
+    case 'f':
+        return json_accept_literal ( r, "false" );
+    case 'n':
+        return json_accept_literal ( r, "null" );
+    default:
+    {
+        // Number.
+        const char *start = r->p;
+        while ( r->p < r->end && ( g_ascii_isdigit ( *r->p ) || *r->p == '-' || *r->p == '+' || *r->p == '.' || *r->p == 'e' || *r->p == 'E' ) ) {
+            r->p++;
+        }
+        return r->p > start;
+    }
+    }
+}
+
+/**
+ * @param key The key read by json_next_member().
+ * @param length The length of key.
+ * @param name The name to compare with.
+ *
+ * @returns TRUE if the key is name.
+ */
+static inline gboolean json_key_is ( const char *key, size_t length, const char *name )
+{
+    return strlen ( name ) == length && memcmp ( key, name, length ) == 0;
+}
+
+/**
+ * @param r The reader, after the '{' of the window_properties object.
+ * @param win The window to fill in.
+ *
+ * @returns TRUE if the object was read.
+ */
+static gboolean i3_tree_read_properties ( JsonReader *r, I3Window *win )
+{
+    gboolean   ok = TRUE;
+    const char *key;
+    size_t     length;
+    for ( gboolean first = TRUE; ok && json_next_member ( r, &key, &length, first, &ok ); first = FALSE ) {
+        char **field = NULL;
+        if ( json_key_is ( key, length, "class" ) ) {
+            field = &( win->class );
+        }
+        else if ( json_key_is ( key, length, "instance" ) ) {
+            field = &( win->instance );
+        }
+        else if ( json_key_is ( key, length, "window_role" ) ) {
+            field = &( win->role );
+        }
+        if ( field != NULL ) {
+            g_free ( *field );
+            *field = json_read_string ( r, &ok );
+        }
+        else {
+            ok = json_skip_value ( r );
+        }
+    }
+    return ok;
+}
+
+static gboolean i3_tree_read_nodes ( JsonReader *r, GArray *windows, gboolean dock );
+
+/**
+ * @param r The reader, after the '{' of the container.
+ * @param windows The array to add the windows to.
+ * @param dock The container is inside a dock area.
+ *
+ * Read a container, and all containers in it.
+ *
+ * @returns TRUE if the container was read.
+ */
+static gboolean i3_tree_read_container ( JsonReader *r, GArray *windows, gboolean dock )
+{
+    gboolean   ok   = TRUE;
+    gboolean   skip = dock;
+    I3Window   win;
+    const char *key;
+    size_t     length;
+    memset ( &win, 0, sizeof ( win ) );
+    if ( ++r->depth > I3_TREE_MAX_DEPTH ) {
+        return FALSE;
+    }
+    for ( gboolean first = TRUE; ok && json_next_member ( r, &key, &length, first, &ok ); first = FALSE ) {
+        if ( json_key_is ( key, length, "window" ) ) {
+            json_skip_ws ( r );
+            if ( !json_accept_literal ( r, "null" ) ) {
+                const char *start = r->p;
+                guint64    value  = 0;
+                while ( r->p < r->end && g_ascii_isdigit ( *r->p ) && value <= UINT32_MAX ) {
+                    value = value * 10 + ( *r->p - '0' );
+                    r->p++;
+                }
+                ok         = ( r->p > start && value <= UINT32_MAX );
+                win.window = (uint32_t) value;
+            }
+        }
+        else if ( json_key_is ( key, length, "name" ) ) {
+            g_free ( win.title );
+            win.title = json_read_string ( r, &ok );
+        }
+        else if ( json_key_is ( key, length, "urgent" ) ) {
+            win.urgent = json_read_boolean ( r, &ok );
+        }
+        else if ( json_key_is ( key, length, "focused" ) ) {
+            win.focused = json_read_boolean ( r, &ok );
+        }
+        else if ( json_key_is ( key, length, "type" ) || json_key_is ( key, length, "window_type" ) ) {
+            char *type = json_read_string ( r, &ok );
+            // i3 lists the type before the child nodes, so dock clients can be skipped while reading them.
+            if ( g_strcmp0 ( type, "dockarea" ) == 0 || g_strcmp0 ( type, "dock" ) == 0 || g_strcmp0 ( type, "desktop" ) == 0 ) {
+                skip = TRUE;
+            }
+            g_free ( type );
+        }
+        else if ( json_key_is ( key, length, "window_properties" ) ) {
+            ok = json_accept ( r, '{' ) && i3_tree_read_properties ( r, &win );
+        }
+        else if ( json_key_is ( key, length, "nodes" ) || json_key_is ( key, length, "floating_nodes" ) ) {
+            ok = i3_tree_read_nodes ( r, windows, skip );
+        }
+        else {
+            ok = json_skip_value ( r );
+        }
+    }
+    r->depth--;
+    if ( ok && win.window != 0 && !skip ) {
+        g_array_append_val ( windows, win );
+    }
+    else {
+        g_free ( win.title );
+        g_free ( win.class );
+        g_free ( win.instance );
+        g_free ( win.role );
+    }
+    return ok;
+}
+
+/**
+ * @param r The reader, at the array of nodes.
+ * @param windows The array to add the windows to.
+ * @param dock The nodes are inside a dock area.
+ *
+ * @returns TRUE if the array was read.
+ */
+static gboolean i3_tree_read_nodes ( JsonReader *r, GArray *windows, gboolean dock )
+{
+    gboolean ok = TRUE;
+    if ( json_accept_literal ( r, "null" ) ) {
+        return TRUE;
+    }
+    if ( !json_accept ( r, '[' ) ) {
+        return FALSE;
+    }
+    for ( gboolean first = TRUE; ok && json_next_element ( r, first, &ok ); first = FALSE ) {
+        ok = json_accept ( r, '{' ) && i3_tree_read_container ( r, windows, dock );
+    }
+    return ok;
+}
+
+I3Window * i3_tree_parse ( const char *data, size_t length, unsigned int *num )
+{
+    JsonReader r       = { data, data + length, 0 };
+    // Reserve space, so an empty tree does not return NULL.
+    GArray     *windows = g_array_sized_new ( FALSE, FALSE, sizeof ( I3Window ), 16 );
+    gboolean   ok       = json_accept ( &r, '{' ) && i3_tree_read_container ( &r, windows, FALSE );
+    json_skip_ws ( &r );
+    *num = windows->len;
+    I3Window *retv = (I3Window *) g_array_free ( windows, FALSE );
+    if ( !ok || r.p != r.end ) {
+        i3_tree_free ( retv, *num );
+        *num = 0;
+        return NULL;
+    }
+    return retv;
+}
+
+void i3_tree_free ( I3Window *windows, unsigned int num )
+{
+    for ( unsigned int i = 0; i < num; i++ ) {
+        g_free ( windows[i].title );
+        g_free ( windows[i].class );
+        g_free ( windows[i].instance );
+        g_free ( windows[i].role );
+    }
+    g_free ( windows );
+}
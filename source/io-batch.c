@@ -0,0 +1,477 @@
+/**
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright 2013-2016 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+#include <config.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <glib.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+#include "io-batch.h"
+
+/** The real group id and the supplementary groups of the process. */
+static gid_t        *io_batch_groups    = NULL;
+/** Number of entries in io_batch_groups. */
+static unsigned int io_batch_num_groups = 0;
+
+/**
+ * Fetch the groups of the process once, io_batch_is_executable() is called for every file.
+ */
+static void io_batch_groups_init ( void )
+{
+    static gsize initialized = 0;
+    if ( g_once_init_enter ( &initialized ) ) {
+        int n = getgroups ( 0, NULL );
+        if ( n < 0 ) {
+            n = 0;
+        }
+        io_batch_groups    = g_malloc0_n ( n + 1, sizeof ( gid_t ) );
+        io_batch_groups[0] = getgid ();
+        if ( n > 0 ) {
+            n = getgroups ( n, &( io_batch_groups[1] ) );
+        }
+        io_batch_num_groups = 1 + ( n > 0 ? n : 0 );
+        g_once_init_leave ( &initialized, 1 );
+    }
+}
+
+gboolean io_batch_is_executable ( const IOBatchRequest *req )
+{
+    if ( req->error != 0 || !S_ISREG ( req->mode ) ) {
+        return FALSE;
+    }
+    // Same rules as access ( X_OK ), it uses the real user and group ids.
+    uid_t uid = getuid ();
+    if ( uid == 0 ) {
+        return ( req->mode & ( S_IXUSR | S_IXGRP | S_IXOTH ) ) != 0;
+    }
+    if ( uid == req->uid ) {
+        return ( req->mode & S_IXUSR ) != 0;
+    }
+    io_batch_groups_init ();
+    for ( unsigned int i = 0; i < io_batch_num_groups; i++ ) {
+        if ( io_batch_groups[i] == req->gid ) {
+            return ( req->mode & S_IXGRP ) != 0;
+        }
+    }
+    return ( req->mode & S_IXOTH ) != 0;
+}
+
+/**
+ * @param req The request to stat.
+ *
+ * Plain syscall fallback for io_batch_stat().
+ */
+static void io_batch_plain_stat ( IOBatchRequest *req )
+{
+    struct stat st;
+    if ( stat ( req->path, &st ) < 0 ) {
+        req->error = errno;
+        return;
+    }
+    req->mode  = st.st_mode;
+    req->uid   = st.st_uid;
+    req->gid   = st.st_gid;
+    req->size  = st.st_size;
+    req->mtime = st.st_mtim;
+}
+
+/**
+ * @param req The request to read.
+ *
+ * Plain syscall fallback for io_batch_read().
+ */
+static void io_batch_plain_read ( IOBatchRequest *req )
+{
+    struct stat st;
+    int         fd = open ( req->path, O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 ) {
+        req->error = errno;
+        return;
+    }
+    if ( fstat ( fd, &st ) < 0 ) {
+        req->error = errno;
+        close ( fd );
+        return;
+    }
+    req->mode  = st.st_mode;
+    req->uid   = st.st_uid;
+    req->gid   = st.st_gid;
+    req->size  = st.st_size;
+    req->mtime = st.st_mtim;
+    if ( !S_ISREG ( st.st_mode ) ) {
+        req->error = EINVAL;
+        close ( fd );
+        return;
+    }
+    req->data   = g_malloc ( st.st_size + 1 );
+    req->length = 0;
+    while ( req->length < (size_t) st.st_size ) {
+        ssize_t r = read ( fd, req->data + req->length, st.st_size - req->length );
+        if ( r < 0 && errno == EINTR ) {
+            continue;
+        }
+        if ( r < 0 ) {
+            req->error = errno;
+            g_free ( req->data );
+            req->data = NULL;
+            break;
+        }
+        if ( r == 0 ) {
+            break;
+        }
+        req->length += r;
+    }
+    if ( req->data != NULL ) {
+        req->data[req->length] = '\0';
+    }
+    close ( fd );
+}
+
+#ifdef HAVE_LIBURING
+/**
+ * The operation an io_uring slot is waiting on.
+ */
+typedef enum
+{
+    IO_BATCH_STEP_STAT,
+    IO_BATCH_STEP_OPEN,
+    IO_BATCH_STEP_READ,
+    IO_BATCH_STEP_CLOSE
+} IOBatchStep;
+
+/**
+ * One in-flight request, each slot has at most one operation submitted.
+ */
+typedef struct
+{
+    IOBatchRequest *req;
+    IOBatchStep    step;
+    int            fd;
+    struct statx   stx;
+} IOBatchSlot;
+
+/**
+ * Check once if the kernel supports all the operations we need.
+ * Older kernels can setup a ring but fail every statx or openat in it.
+ *
+ * @returns TRUE if io_uring can be used.
+ */
+static gboolean io_batch_uring_supported ( void )
+{
+    static gsize supported = 0;
+    if ( g_once_init_enter ( &supported ) ) {
+        gsize                 retv   = 1;
+        struct io_uring_probe *probe = io_uring_get_probe ();
+        if ( probe != NULL ) {
+            if ( io_uring_opcode_supported ( probe, IORING_OP_STATX ) &&
+                 io_uring_opcode_supported ( probe, IORING_OP_OPENAT ) &&
+                 io_uring_opcode_supported ( probe, IORING_OP_READ ) &&
+                 io_uring_opcode_supported ( probe, IORING_OP_CLOSE ) ) {
+                retv = 2;
+            }
+            io_uring_free_probe ( probe );
+        }
+        g_once_init_leave ( &supported, retv );
+    }
+    return supported == 2;
+}
+
+/**
+ * @param ring The ring.
+ *
+ * Get a free submission queue entry. When the queue is full, the queued entries are submitted first.
+ *
+ * @returns the entry, or NULL if the queue is still full.
+ */
+static struct io_uring_sqe *io_batch_uring_get_sqe ( struct io_uring *ring )
+{
+    struct io_uring_sqe *sqe = io_uring_get_sqe ( ring );
+    if ( sqe == NULL ) {
+        io_uring_submit ( ring );
+        sqe = io_uring_get_sqe ( ring );
+    }
+    return sqe;
+}
+
+/**
+ * @param req  The request.
+ * @param want_data If the content of the file should be read.
+ *
+ * Do the request with plain syscalls, when it can not be queued on the ring.
+ */
+static void io_batch_uring_plain ( IOBatchRequest *req, gboolean want_data )
+{
+    g_free ( req->data );
+    req->data   = NULL;
+    req->length = 0;
+    req->error  = 0;
+    if ( want_data ) {
+        io_batch_plain_read ( req );
+    }
+    else {
+        io_batch_plain_stat ( req );
+    }
+}
+
+/**
+ * @param ring The ring.
+ * @param slot The free slot.
+ * @param req  The request to start.
+ * @param want_data If the content of the file should be read.
+ *
+ * Queue the statx that starts every request. If the queue is full, the request is done
+ * with plain syscalls instead.
+ *
+ * @returns TRUE if the request was queued in the slot.
+ */
+static gboolean io_batch_uring_start ( struct io_uring *ring, IOBatchSlot *slot, IOBatchRequest *req, gboolean want_data )
+{
+    struct io_uring_sqe *sqe = io_batch_uring_get_sqe ( ring );
+    if ( sqe == NULL ) {
+        io_batch_uring_plain ( req, want_data );
+        return FALSE;
+    }
+    slot->req  = req;
+    slot->step = IO_BATCH_STEP_STAT;
+    slot->fd   = -1;
+    io_uring_prep_statx ( sqe, AT_FDCWD, req->path, 0, STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME, &( slot->stx ) );
+    io_uring_sqe_set_data ( sqe, slot );
+    return TRUE;
+}
+
+/**
+ * @param ring The ring.
+ * @param slot The slot whose operation completed.
+ * @param res  The result of the operation.
+ * @param want_data If the content of the file should be read.
+ *
+ * Move the slot to its next step. If the next operation can not be queued, the request
+ * is finished with plain syscalls.
+ *
+ * @returns TRUE if a new operation was queued for the slot, FALSE if the request is done.
+ */
+static gboolean io_batch_uring_advance ( struct io_uring *ring, IOBatchSlot *slot, int res, gboolean want_data )
+{
+    IOBatchRequest      *req = slot->req;
+    struct io_uring_sqe *sqe = NULL;
+    switch ( slot->step )
+    {
+    case IO_BATCH_STEP_STAT:
+        if ( res < 0 ) {
+            req->error = -res;
+            return FALSE;
+        }
+        req->mode          = slot->stx.stx_mode;
+        req->uid           = slot->stx.stx_uid;
+        req->gid           = slot->stx.stx_gid;
+        req->size          = slot->stx.stx_size;
+        req->mtime.tv_sec  = slot->stx.stx_mtime.tv_sec;
+        req->mtime.tv_nsec = slot->stx.stx_mtime.tv_nsec;
+        if ( !want_data ) {
+            return FALSE;
+        }
+        if ( !S_ISREG ( req->mode ) ) {
+            req->error = EINVAL;
+            return FALSE;
+        }
+        sqe = io_batch_uring_get_sqe ( ring );
+        if ( sqe == NULL ) {
+            io_batch_uring_plain ( req, want_data );
+            return FALSE;
+        }
+        io_uring_prep_openat ( sqe, AT_FDCWD, req->path, O_RDONLY | O_CLOEXEC, 0 );
+        slot->step = IO_BATCH_STEP_OPEN;
+        break;
+    case IO_BATCH_STEP_OPEN:
+        if ( res < 0 ) {
+            req->error = -res;
+            return FALSE;
+        }
+        sqe = io_batch_uring_get_sqe ( ring );
+        if ( sqe == NULL ) {
+            close ( res );
+            io_batch_uring_plain ( req, want_data );
+            return FALSE;
+        }
+        slot->fd    = res;
+        req->data   = g_malloc ( req->size + 1 );
+        req->length = 0;
+        io_uring_prep_read ( sqe, slot->fd, req->data, req->size, 0 );
+        slot->step = IO_BATCH_STEP_READ;
+        break;
+    case IO_BATCH_STEP_READ:
+        if ( res > 0 && ( req->length + res ) < (size_t) req->size ) {
+            // Short read, queue the remainder.
+            req->length += res;
+            sqe          = io_batch_uring_get_sqe ( ring );
+            if ( sqe == NULL ) {
+                close ( slot->fd );
+                slot->fd = -1;
+                io_batch_uring_plain ( req, want_data );
+                return FALSE;
+            }
+            io_uring_prep_read ( sqe, slot->fd, req->data + req->length, req->size - req->length, req->length );
+            break;
+        }
+        if ( res < 0 ) {
+            req->error = -res;
+            g_free ( req->data );
+            req->data = NULL;
+        }
+        else {
+            req->length           += res;
+            req->data[req->length] = '\0';
+        }
+        sqe = io_batch_uring_get_sqe ( ring );
+        if ( sqe == NULL ) {
+            close ( slot->fd );
+            slot->fd = -1;
+            return FALSE;
+        }
+        io_uring_prep_close ( sqe, slot->fd );
+        slot->step = IO_BATCH_STEP_CLOSE;
+        break;
+    case IO_BATCH_STEP_CLOSE:
+    default:
+        slot->fd = -1;
+        return FALSE;
+    }
+    io_uring_sqe_set_data ( sqe, slot );
+    return TRUE;
+}
+
+/**
+ * @param reqs The requests.
+ * @param num  The number of requests.
+ * @param want_data If the content of the files should be read.
+ *
+ * Run the requests through a private ring, keeping every slot busy until all requests are done.
+ *
+ * @returns FALSE if no ring could be setup and nothing was done.
+ */
+static gboolean io_batch_uring ( IOBatchRequest *reqs, unsigned int num, gboolean want_data )
+{
+    struct io_uring ring;
+    unsigned int    depth = MIN ( num, IO_BATCH_DEPTH );
+    if ( !io_batch_uring_supported () || io_uring_queue_init ( depth, &ring, 0 ) < 0 ) {
+        return FALSE;
+    }
+    IOBatchSlot  *slots  = g_malloc0_n ( depth, sizeof ( IOBatchSlot ) );
+    unsigned int next    = 0;
+    unsigned int active  = 0;
+    int          failure = 0;
+    for ( ; next < depth; next++ ) {
+        if ( io_batch_uring_start ( &ring, &( slots[next] ), &( reqs[next] ), want_data ) ) {
+            active++;
+        }
+    }
+    while ( active > 0 ) {
+        int ret = io_uring_submit_and_wait ( &ring, 1 );
+        if ( ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY ) {
+            failure = -ret;
+            break;
+        }
+        struct io_uring_cqe *cqe;
+        unsigned int        head;
+        unsigned int        seen = 0;
+        io_uring_for_each_cqe ( &ring, head, cqe )
+        {
+            IOBatchSlot *slot = (IOBatchSlot *) io_uring_cqe_get_data ( cqe );
+            seen++;
+            if ( !io_batch_uring_advance ( &ring, slot, cqe->res, want_data ) ) {
+                slot->req = NULL;
+                // Requests that can not be queued are done right away, try the next one.
+                while ( next < num && !io_batch_uring_start ( &ring, slot, &( reqs[next++] ), want_data ) ) {
+                }
+                if ( slot->req == NULL ) {
+                    active--;
+                }
+            }
+        }
+        io_uring_cq_advance ( &ring, seen );
+    }
+    io_uring_queue_exit ( &ring );
+    if ( failure != 0 ) {
+        // The ring broke down, the kernel might still own the buffers of in-flight reads,
+        // so they are left alone. Fail those requests and do the rest with plain syscalls.
+        fprintf ( stderr, "Batched file access failed: %s\n", g_strerror ( failure ) );
+        for ( unsigned int i = 0; i < depth; i++ ) {
+            if ( slots[i].req != NULL ) {
+                slots[i].req->error = failure;
+                slots[i].req->data  = NULL;
+            }
+        }
+    }
+    // Left over when the ring broke down, or when no request could be queued at all.
+    for ( ; next < num; next++ ) {
+        io_batch_uring_plain ( &( reqs[next] ), want_data );
+    }
+    g_free ( slots );
+    return TRUE;
+}
+#endif // HAVE_LIBURING
+
+void io_batch_stat ( IOBatchRequest *reqs, unsigned int num )
+{
+    for ( unsigned int i = 0; i < num; i++ ) {
+        reqs[i].error  = 0;
+        reqs[i].data   = NULL;
+        reqs[i].length = 0;
+    }
+#ifdef HAVE_LIBURING
+    if ( num > 1 && io_batch_uring ( reqs, num, FALSE ) ) {
+        return;
+    }
+#endif
+    for ( unsigned int i = 0; i < num; i++ ) {
+        io_batch_plain_stat ( &( reqs[i] ) );
+    }
+}
+
+void io_batch_read ( IOBatchRequest *reqs, unsigned int num )
+{
+    for ( unsigned int i = 0; i < num; i++ ) {
+        reqs[i].error  = 0;
+        reqs[i].data   = NULL;
+        reqs[i].length = 0;
+    }
+#ifdef HAVE_LIBURING
+    if ( num > 1 && io_batch_uring ( reqs, num, TRUE ) ) {
+        return;
+    }
+#endif
+    for ( unsigned int i = 0; i < num; i++ ) {
+        io_batch_plain_read ( &( reqs[i] ) );
+    }
+}
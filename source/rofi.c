@@ -55,6 +55,7 @@
 #include "mode.h"
 #include "rofi.h"
 #include "helper.h"
+#include "history.h"
 #include "textbox.h"
 #include "x11-helper.h"
 #include "xrmoptions.h"
@@ -280,6 +281,8 @@ static void cleanup ()
         mode_destroy ( modi[i] );
     }
     rofi_view_workers_finalize ();
+    // The window is gone, wait for the history of the launched entry.
+    history_flush ();
     if ( main_loop != NULL  ) {
         if ( main_loop_source ) {
             g_water_xcb_source_unref ( main_loop_source );
@@ -298,6 +301,7 @@ static void cleanup ()
 
     // Cleanup the custom keybinding
     cleanup_abe ();
+    helper_launch_cleanup ();
 
     g_free ( config_path );
 
@@ -461,6 +465,11 @@ static gboolean main_loop_x11_event_handler ( xcb_generic_event_t *ev, G_GNUC_UN
     if ( xcb->sndisplay != NULL ) {
         sn_xcb_display_process_event ( xcb->sndisplay, ev );
     }
+#ifdef WINDOW_MODE
+    if ( type == XCB_PROPERTY_NOTIFY ) {
+        window_mode_property_notify ( (xcb_property_notify_event_t *) ev );
+    }
+#endif // WINDOW_MODE
     if ( state != NULL ) {
         rofi_view_itterrate ( state, ev, &xkb );
         if ( rofi_view_get_completed ( state ) ) {
@@ -522,6 +531,7 @@ static gboolean startup ( G_GNUC_UNUSED gpointer data )
         return G_SOURCE_REMOVE;
     }
     TICK_N ( "Config sanity check" );
+    helper_launch_setup ();
     // Parse the keybindings.
     if ( !parse_keys_abe () ) {
         // Error dialog
@@ -614,6 +624,14 @@ int main ( int argc, char *argv[] )
     // Get the path to the cache dir.
     cache_dir = g_get_user_cache_dir ();
 
+    // Help and the dumps exit once the configuration is loaded, before the input is used.
+    int early_exit = find_arg ( "-h" ) >= 0 || find_arg ( "-help" ) >= 0 || find_arg ( "--help" ) >= 0 ||
+                     find_arg ( "-dump-xresources" ) >= 0 || find_arg ( "-dump-xresources-theme" ) >= 0;
+    if ( dmenu_mode == TRUE && !early_exit ) {
+        // Start reading the input, while we connect to X and load the configuration.
+        dmenu_prefetch_start ();
+    }
+
     // Create pid file path.
     const char *path = g_get_user_runtime_dir ();
     if ( path ) {
@@ -41,6 +41,7 @@ scrollbar *scrollbar_create ( short x, short y, short w, short h )
     sb->length     = 10;
     sb->pos        = 0;
     sb->pos_length = 4;
+    sb->update     = TRUE;
 
     // Create GC.
     return sb;
@@ -56,21 +57,27 @@ void scrollbar_free ( scrollbar *sb )
 void scrollbar_set_max_value ( scrollbar *sb, unsigned int max )
 {
     if ( sb != NULL ) {
-        sb->length = MAX ( 1u, max );
+        unsigned int length = MAX ( 1u, max );
+        sb->update |= ( length != sb->length );
+        sb->length  = length;
     }
 }
 
 void scrollbar_set_handle ( scrollbar *sb, unsigned int pos )
 {
     if ( sb != NULL ) {
-        sb->pos = MIN ( sb->length, pos );
+        pos         = MIN ( sb->length, pos );
+        sb->update |= ( pos != sb->pos );
+        sb->pos     = pos;
     }
 }
 
 void scrollbar_set_handle_length ( scrollbar *sb, unsigned int pos_length )
 {
     if ( sb != NULL ) {
-        sb->pos_length = MIN ( sb->length, MAX ( 1u, pos_length ) );
+        pos_length     = MIN ( sb->length, MAX ( 1u, pos_length ) );
+        sb->update    |= ( pos_length != sb->pos_length );
+        sb->pos_length = pos_length;
     }
 }
 
@@ -93,6 +100,7 @@ void scrollbar_draw ( scrollbar *sb, cairo_t *draw )
 
         cairo_rectangle ( draw, sb->widget.x + config.line_margin, sb->widget.y + y, sb->widget.w - config.line_margin, height );
         cairo_fill ( draw );
+        sb->update = FALSE;
     }
 }
 void scrollbar_resize ( scrollbar *sb, int w, int h )
@@ -104,6 +112,7 @@ void scrollbar_resize ( scrollbar *sb, int w, int h )
         if ( w > 0 ) {
             sb->widget.w = w;
         }
+        sb->update = TRUE;
     }
 }
 unsigned int scrollbar_clicked ( scrollbar *sb, int y )
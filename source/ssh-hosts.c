@@ -0,0 +1,832 @@
+/*
+ * rofi
+ *
+ * MIT/X11 License
+ * Copyright 2013-2016 Qball Cow <qball@gmpclient.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <pwd.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <glib.h>
+#include "ssh-hosts.h"
+
+/**
+ * Magic and version of the ssh host cache file.
+ */
+#define SSH_HOSTS_CACHE_MAGIC      "RSSH"
+#define SSH_HOSTS_CACHE_VERSION    1
+
+/** The source file exists. */
+#define SSH_SOURCE_EXISTS         1
+/** The source file is known_hosts. */
+#define SSH_SOURCE_KNOWN_HOSTS    2
+
+/**
+ * Used when splitting lines from the user's SSH config file into tokens.
+ */
+#define SSH_TOKEN_DELIM          "= \t\r\n"
+
+/**
+ * Size of the blocks the host files are read in.
+ */
+#define SSH_READ_BUFFER          65536
+
+/**
+ * Maximum nesting of Include directives in the ssh config, the same limit ssh uses.
+ */
+#define SSH_MAX_INCLUDE_DEPTH    16
+
+/**
+ * A file (or directory) the host list was built from.
+ */
+typedef struct
+{
+    char        *path;
+    /** Set when the file exists. */
+    int         exists;
+    /** Set for the known_hosts file, which can be parsed incrementally. */
+    int         known_hosts;
+    struct stat st;
+    /** Offset after the last complete line that was parsed. */
+    off_t       parsed;
+} SSHSourceFile;
+
+/**
+ * The list of hosts being built by ssh_hosts_read().
+ */
+typedef struct
+{
+    /** The hosts, NULL terminated. */
+    char         **hosts;
+    /** The number of hosts. */
+    unsigned int length;
+    /** The allocated size of hosts. */
+    unsigned int size;
+    /** The hosts in the list, compared case insensitive. The keys are owned by hosts. */
+    GHashTable   *seen;
+    /** The ssh config files read, so each file is only read once. */
+    GHashTable   *config_files;
+    /** The files the hosts were read from, SSHSourceFile. */
+    GArray       *files;
+    /** The number of hosts from known_hosts, they are in front of the list. */
+    unsigned int num_known;
+    /** Cleared when a change in the sources can not be detected from the files. */
+    int          cacheable;
+    /** The home directory, relative includes are resolved against it. */
+    const char   *home;
+} SSHHostList;
+
+/**
+ * Callback for each line of a file read by ssh_read_lines().
+ */
+typedef void ( *SSHLineFunc )( SSHHostList *list, char *line, gpointer data );
+
+/**
+ * @param key The host name.
+ *
+ * Case insensitive hash of the host name.
+ *
+ * @returns the hash value.
+ */
+static guint ssh_host_hash ( gconstpointer key )
+{
+    guint hash = 5381;
+    for ( const char *p = key; *p != '\0'; p++ ) {
+        hash = ( hash << 5 ) + hash + g_ascii_tolower ( *p );
+    }
+    return hash;
+}
+
+/**
+ * @param a The first host name.
+ * @param b The second host name.
+ *
+ * @returns TRUE if the host names are equal, ignoring case.
+ */
+static gboolean ssh_host_equal ( gconstpointer a, gconstpointer b )
+{
+    return g_ascii_strcasecmp ( a, b ) == 0;
+}
+
+/**
+ * @param list The list to initialize.
+ * @param home The home directory.
+ *
+ * Initialize an empty host list.
+ */
+static void ssh_host_list_init ( SSHHostList *list, const char *home )
+{
+    memset ( list, 0, sizeof ( *list ) );
+    list->home         = home;
+    list->seen         = g_hash_table_new ( ssh_host_hash, ssh_host_equal );
+    list->config_files = g_hash_table_new_full ( g_str_hash, g_str_equal, g_free, NULL );
+    list->files        = g_array_new ( FALSE, FALSE, sizeof ( SSHSourceFile ) );
+    list->cacheable    = TRUE;
+}
+
+/**
+ * @param list The list to clear.
+ *
+ * Free the bookkeeping of the list, the hosts themselves are kept.
+ */
+static void ssh_host_list_clear ( SSHHostList *list )
+{
+    for ( unsigned int i = 0; i < list->files->len; i++ ) {
+        g_free ( g_array_index ( list->files, SSHSourceFile, i ).path );
+    }
+    g_array_free ( list->files, TRUE );
+    g_hash_table_destroy ( list->config_files );
+    g_hash_table_destroy ( list->seen );
+}
+
+/**
+ * @param list The list of hosts.
+ * @param host The host to add, the list takes ownership.
+ *
+ * Add the host to the list, unless it is already in there, then it is freed.
+ */
+static void ssh_host_list_append ( SSHHostList *list, char *host )
+{
+    if ( g_hash_table_contains ( list->seen, host ) ) {
+        g_free ( host );
+        return;
+    }
+    if ( ( list->length + 1 ) >= list->size ) {
+        list->size  = MAX ( 2 * list->size, 64 );
+        list->hosts = g_realloc ( list->hosts, list->size * sizeof ( char* ) );
+    }
+    list->hosts[list->length]   = host;
+    g_hash_table_add ( list->seen, host );
+    list->hosts[++list->length] = NULL;
+}
+
+static void ssh_host_list_add ( SSHHostList *list, const char *host )
+{
+    if ( g_hash_table_contains ( list->seen, host ) ) {
+        return;
+    }
+    ssh_host_list_append ( list, g_strdup ( host ) );
+}
+
+/**
+ * @param list The list of hosts.
+ * @param path The file or directory.
+ * @param st The stat of the file, NULL if it does not exist.
+ * @param parsed Offset after the last complete line that was parsed.
+ *
+ * Record a file the hosts are read from, so the cache can be checked against it.
+ */
+static void ssh_host_list_add_file ( SSHHostList *list, const char *path, const struct stat *st, off_t parsed )
+{
+    SSHSourceFile file;
+    memset ( &file, 0, sizeof ( file ) );
+    file.path   = g_strdup ( path );
+    file.exists = ( st != NULL );
+    file.parsed = parsed;
+    if ( st != NULL ) {
+        file.st = *st;
+    }
+    g_array_append_val ( list->files, file );
+}
+
+/**
+ * @param list The list of hosts.
+ * @param path The file to read.
+ * @param offset The offset to start reading at.
+ * @param func Called for every line, the line is NUL terminated and can be modified.
+ * @param data User data passed to func.
+ *
+ * Read the file in blocks of #SSH_READ_BUFFER bytes and split it in lines.
+ * The file is recorded in the list of source files.
+ *
+ * @returns FALSE if the file could not be opened.
+ */
+static gboolean ssh_read_lines ( SSHHostList *list, const char *path, off_t offset, SSHLineFunc func, gpointer data )
+{
+    struct stat st;
+    int         fd = open ( path, O_RDONLY );
+    if ( fd < 0 || fstat ( fd, &st ) != 0 ) {
+        if ( fd >= 0 ) {
+            close ( fd );
+        }
+        else if ( errno != ENOENT ) {
+            list->cacheable = FALSE;
+        }
+        ssh_host_list_add_file ( list, path, NULL, 0 );
+        return FALSE;
+    }
+    if ( offset > 0 && lseek ( fd, offset, SEEK_SET ) != offset ) {
+        offset = 0;
+    }
+    gsize   size    = SSH_READ_BUFFER;
+    gsize   fill    = 0;
+    char    *buffer = g_malloc ( size );
+    ssize_t r;
+    // Keep one byte free, so the last line can always be terminated.
+    while ( ( r = read ( fd, buffer + fill, size - fill - 1 ) ) != 0 ) {
+        if ( r < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            fprintf ( stderr, "Failed to read file: %s: '%s'\n", path, strerror ( errno ) );
+            list->cacheable = FALSE;
+            break;
+        }
+        fill += r;
+        char *start = buffer;
+        char *end;
+        while ( ( end = memchr ( start, '\n', fill - ( start - buffer ) ) ) != NULL ) {
+            *end = '\0';
+            func ( list, start, data );
+            start = end + 1;
+        }
+        offset += ( start - buffer );
+        fill   -= ( start - buffer );
+        memmove ( buffer, start, fill );
+        if ( ( fill + 1 ) == size ) {
+            // Line longer than the buffer.
+            size  *= 2;
+            buffer = g_realloc ( buffer, size );
+        }
+    }
+    if ( fill > 0 ) {
+        buffer[fill] = '\0';
+        func ( list, buffer, data );
+    }
+    g_free ( buffer );
+    if ( close ( fd ) != 0 ) {
+        fprintf ( stderr, "Failed to close file: %s: '%s'\n", path, strerror ( errno ) );
+    }
+    ssh_host_list_add_file ( list, path, &st, offset );
+    return TRUE;
+}
+
+/**
+ * @param list The list of hosts.
+ * @param line The line to parse.
+ * @param data Unused.
+ *
+ * Parse a line of the 'known_hosts' file, when entries are not hashsed.
+ */
+static void ssh_parse_known_hosts_line ( SSHHostList *list, char *line, G_GNUC_UNUSED gpointer data )
+{
+    char *sep = strchr ( line, ',' );
+    if ( sep != NULL ) {
+        *sep = '\0';
+        ssh_host_list_add ( list, line );
+    }
+}
+
+/**
+ * @param list The list of hosts.
+ * @param line The line to parse.
+ * @param data Unused.
+ *
+ * Parse a line of `/etc/hosts`, all names after the address are added.
+ */
+static void ssh_parse_hosts_line ( SSHHostList *list, char *line, G_GNUC_UNUSED gpointer data )
+{
+    // Everything after comment ignore.
+    char *comment = strchr ( line, '#' );
+    if ( comment != NULL ) {
+        *comment = '\0';
+    }
+    // Skip the address.
+    char *token = strtok ( line, " \t\r" );
+    while ( token != NULL && ( token = strtok ( NULL, " \t\r" ) ) != NULL ) {
+        ssh_host_list_add ( list, token );
+    }
+}
+
+static void ssh_parse_config_file ( SSHHostList *list, const char *path, unsigned int depth );
+
+/**
+ * @param list The list of hosts.
+ * @param path The path starting with a '~'.
+ *
+ * Expand '~' to the home directory of the list, and '~user' to the home directory of that user.
+ *
+ * @returns the expanded path.
+ */
+static char *ssh_expand_home ( const SSHHostList *list, const char *path )
+{
+    const char *rest = strchr ( path, G_DIR_SEPARATOR );
+    if ( rest == NULL ) {
+        rest = path + strlen ( path );
+    }
+    if ( rest == path + 1 ) {
+        return g_strconcat ( list->home, rest, NULL );
+    }
+    char          *user = g_strndup ( path + 1, rest - path - 1 );
+    struct passwd *p    = getpwnam ( user );
+    g_free ( user );
+    if ( p == NULL ) {
+        return g_strdup ( path );
+    }
+    return g_strconcat ( p->pw_dir, rest, NULL );
+}
+
+/**
+ * @param list The list of hosts.
+ * @param line The line to parse.
+ * @param data The include depth of the file.
+ *
+ * Parse a line of the ssh config file, the names of `Host` lines are added and `Include`d files are read.
+ */
+static void ssh_parse_config_line ( SSHHostList *list, char *line, gpointer data )
+{
+    unsigned int depth = GPOINTER_TO_UINT ( data );
+    // Each line is either empty, a comment line starting with a '#'
+    // character or of the form "keyword [=] arguments", where there may
+    // be multiple (possibly quoted) arguments separated by whitespace.
+    // The keyword is separated from its arguments by whitespace OR by
+    // optional whitespace and a '=' character.
+    char *saveptr = NULL;
+    char *token   = strtok_r ( line, SSH_TOKEN_DELIM, &saveptr );
+
+    // Skip empty lines and comment lines.
+    if ( !token || *token == '#' ) {
+        return;
+    }
+    if ( g_ascii_strcasecmp ( token, "Include" ) == 0 ) {
+        // Relative paths are relative to ~/.ssh, like ssh does for the user configuration.
+        while ( ( token = strtok_r ( NULL, SSH_TOKEN_DELIM, &saveptr ) ) ) {
+            if ( *token == '#' ) {
+                break;
+            }
+            char   *pattern = NULL;
+            glob_t globbuf;
+            if ( *token == '~' ) {
+                pattern = ssh_expand_home ( list, token );
+            }
+            else if ( g_path_is_absolute ( token ) ) {
+                pattern = g_strdup ( token );
+            }
+            else {
+                pattern = g_build_filename ( list->home, ".ssh", token, NULL );
+            }
+            // New files matching the pattern show up as a change of its directory.
+            char        *dir = g_path_get_dirname ( pattern );
+            struct stat st;
+            if ( strpbrk ( dir, "*?[" ) != NULL ) {
+                list->cacheable = FALSE;
+            }
+            else {
+                ssh_host_list_add_file ( list, dir, ( stat ( dir, &st ) == 0 ) ? &st : NULL, 0 );
+            }
+            g_free ( dir );
+            if ( glob ( pattern, 0, NULL, &globbuf ) == 0 ) {
+                for ( size_t i = 0; i < globbuf.gl_pathc; i++ ) {
+                    ssh_parse_config_file ( list, globbuf.gl_pathv[i], depth + 1 );
+                }
+                globfree ( &globbuf );
+            }
+            g_free ( pattern );
+        }
+        return;
+    }
+    // Also skip lines where the keyword is not "Host".
+    if ( g_ascii_strcasecmp ( token, "Host" ) ) {
+        return;
+    }
+
+    // Now we know that this is a "Host" line.
+    // The "Host" keyword is followed by one more host names separated
+    // by whitespace; while host names may be quoted with double quotes
+    // to represent host names containing spaces, we don't support this
+    // (how many host names contain spaces?).
+    while ( ( token = strtok_r ( NULL, SSH_TOKEN_DELIM, &saveptr ) ) ) {
+        // We do not want to show wildcard entries, as you cannot ssh to them.
+        const char *const sep = "*?";
+        if ( *token == '!' || strpbrk ( token, sep ) ) {
+            continue;
+        }
+
+        // If comment, skip from now on.
+        if ( *token == '#' ) {
+            break;
+        }
+        ssh_host_list_add ( list, token );
+    }
+}
+
+/**
+ * @param list The list of hosts.
+ * @param path The ssh config file.
+ * @param depth The include depth of the file.
+ *
+ * Read a ssh config file. Files already read, and files nested deeper than
+ * #SSH_MAX_INCLUDE_DEPTH, are skipped.
+ */
+static void ssh_parse_config_file ( SSHHostList *list, const char *path, unsigned int depth )
+{
+    if ( depth > SSH_MAX_INCLUDE_DEPTH ) {
+        fprintf ( stderr, "Ignoring ssh configuration file: '%s': includes nested too deep.\n", path );
+        return;
+    }
+    if ( g_hash_table_contains ( list->config_files, path ) ) {
+        return;
+    }
+    g_hash_table_add ( list->config_files, g_strdup ( path ) );
+    ssh_read_lines ( list, path, 0, ssh_parse_config_line, GUINT_TO_POINTER ( depth ) );
+}
+
+/**
+ * Header of the ssh host cache file.
+ * It is followed by the source file records, the host offsets and the string area.
+ */
+typedef struct
+{
+    char     magic[4];
+    uint32_t version;
+    /** The sources that were parsed, SSH_HOSTS_CACHE_PARSE_*. */
+    uint32_t flags;
+    uint32_t num_files;
+    uint32_t num_hosts;
+    /** The number of hosts from known_hosts, they are in front. */
+    uint32_t num_known;
+    /** Offset of the home directory in the string area. */
+    uint32_t home;
+    uint32_t pad;
+    uint64_t strings_size;
+} SSHCacheHeader;
+
+/**
+ * A source file in the ssh host cache file.
+ */
+typedef struct
+{
+    uint64_t dev;
+    uint64_t ino;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    int64_t  size;
+    /** Offset after the last complete line that was parsed. */
+    int64_t  parsed;
+    /** Offset of the path in the string area. */
+    uint32_t path;
+    /** SSH_SOURCE_* flags. */
+    uint32_t flags;
+} SSHCacheFile;
+
+/**
+ * The mapped ssh host cache file.
+ */
+typedef struct
+{
+    char                 *map;
+    size_t               size;
+    const SSHCacheHeader *header;
+    const SSHCacheFile   *files;
+    const uint32_t       *hosts;
+    const char           *strings;
+} SSHCache;
+
+/**
+ * @param cache The cache to fill in.
+ * @param filename The cache file.
+ *
+ * Map and validate the cache file.
+ *
+ * @returns TRUE when the cache was loaded.
+ */
+static int ssh_cache_load ( SSHCache *cache, const char *filename )
+{
+    struct stat st;
+    memset ( cache, 0, sizeof ( *cache ) );
+    int         fd = open ( filename, O_RDONLY );
+    if ( fd < 0 ) {
+        return FALSE;
+    }
+    if ( fstat ( fd, &st ) != 0 || (size_t) st.st_size < sizeof ( SSHCacheHeader ) ) {
+        close ( fd );
+        return FALSE;
+    }
+    char *map = mmap ( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close ( fd );
+    if ( map == MAP_FAILED ) {
+        return FALSE;
+    }
+    cache->map    = map;
+    cache->size   = st.st_size;
+    cache->header = (const SSHCacheHeader *) map;
+
+    const SSHCacheHeader *h       = cache->header;
+    uint64_t             expected = sizeof ( SSHCacheHeader ) + (uint64_t) h->num_files * sizeof ( SSHCacheFile ) +
+                                    (uint64_t) h->num_hosts * sizeof ( uint32_t ) + h->strings_size;
+    if ( memcmp ( h->magic, SSH_HOSTS_CACHE_MAGIC, 4 ) != 0 || h->version != SSH_HOSTS_CACHE_VERSION ||
+         expected != cache->size || h->strings_size == 0 || h->num_known > h->num_hosts ) {
+        goto invalid;
+    }
+    cache->files   = (const SSHCacheFile *) ( map + sizeof ( SSHCacheHeader ) );
+    cache->hosts   = (const uint32_t *) ( cache->files + h->num_files );
+    cache->strings = (const char *) ( cache->hosts + h->num_hosts );
+    if ( cache->strings[h->strings_size - 1] != '\0' || h->home >= h->strings_size ) {
+        goto invalid;
+    }
+    for ( uint32_t i = 0; i < h->num_files; i++ ) {
+        if ( cache->files[i].path >= h->strings_size ) {
+            goto invalid;
+        }
+    }
+    for ( uint32_t i = 0; i < h->num_hosts; i++ ) {
+        if ( cache->hosts[i] >= h->strings_size ) {
+            goto invalid;
+        }
+    }
+    return TRUE;
+invalid:
+    fprintf ( stderr, "Ignoring invalid ssh host cache: %s\n", filename );
+    munmap ( map, cache->size );
+    memset ( cache, 0, sizeof ( *cache ) );
+    return FALSE;
+}
+
+/**
+ * @param cache The cache to free.
+ *
+ * Unmap the cache file.
+ */
+static void ssh_cache_free ( SSHCache *cache )
+{
+    if ( cache->map != NULL ) {
+        munmap ( cache->map, cache->size );
+    }
+    memset ( cache, 0, sizeof ( *cache ) );
+}
+
+/**
+ * @param cf The file in the cache.
+ * @param st The current stat of the file, NULL if it does not exist.
+ *
+ * @returns TRUE if the file did not change.
+ */
+static gboolean ssh_cache_file_matches ( const SSHCacheFile *cf, const struct stat *st )
+{
+    if ( st == NULL || !( cf->flags & SSH_SOURCE_EXISTS ) ) {
+        return st == NULL && !( cf->flags & SSH_SOURCE_EXISTS );
+    }
+    return cf->dev == (uint64_t) st->st_dev && cf->ino == (uint64_t) st->st_ino && cf->size == (int64_t) st->st_size &&
+           cf->mtime_sec == (int64_t) st->st_mtim.tv_sec && cf->mtime_nsec == (int64_t) st->st_mtim.tv_nsec;
+}
+
+/**
+ * @param cache The loaded cache.
+ * @param list The list to record the unchanged source files in.
+ * @param flags The sources that are parsed.
+ * @param home The home directory.
+ * @param known The index of the known_hosts file in the cache, set if SSH_CACHE_TAIL is returned.
+ *
+ * Compare the cache against the source files. Only when lines were appended to known_hosts,
+ * and nothing else changed, the cache can be updated incrementally.
+ *
+ * @returns the state of the cache.
+ */
+static SSHCacheState ssh_cache_check ( const SSHCache *cache, SSHHostList *list, uint32_t flags, const char *home, uint32_t *known )
+{
+    SSHCacheState state = SSH_CACHE_HIT;
+    if ( cache->header->flags != flags || strcmp ( cache->strings + cache->header->home, home ) != 0 ) {
+        return SSH_CACHE_MISS;
+    }
+    for ( uint32_t i = 0; i < cache->header->num_files; i++ ) {
+        const SSHCacheFile *cf     = &( cache->files[i] );
+        const char         *path   = cache->strings + cf->path;
+        struct stat        st;
+        int                exists = ( stat ( path, &st ) == 0 );
+        if ( ssh_cache_file_matches ( cf, exists ? &st : NULL ) ) {
+            ssh_host_list_add_file ( list, path, exists ? &st : NULL, cf->parsed );
+            g_array_index ( list->files, SSHSourceFile, list->files->len - 1 ).known_hosts = ( cf->flags & SSH_SOURCE_KNOWN_HOSTS ) != 0;
+            continue;
+        }
+        if ( ( cf->flags & SSH_SOURCE_KNOWN_HOSTS ) && ( cf->flags & SSH_SOURCE_EXISTS ) && exists && state == SSH_CACHE_HIT &&
+             cf->dev == (uint64_t) st.st_dev && cf->ino == (uint64_t) st.st_ino && (int64_t) st.st_size > cf->size ) {
+            // Appended to, it is parsed again from where we left off.
+            *known = i;
+            state  = SSH_CACHE_TAIL;
+            continue;
+        }
+        return SSH_CACHE_MISS;
+    }
+    return state;
+}
+
+/**
+ * @param strings The string area.
+ * @param str The string to add.
+ *
+ * @returns the offset of str in the string area.
+ */
+static uint32_t ssh_cache_add_string ( GString *strings, const char *str )
+{
+    uint32_t offset = strings->len;
+    g_string_append_len ( strings, str, strlen ( str ) + 1 );
+    return offset;
+}
+
+/**
+ * @param filename The cache file.
+ * @param flags The sources that were parsed.
+ * @param home The home directory.
+ * @param list The hosts and the files they were read from.
+ *
+ * Write the ssh host cache file, the file is replaced atomically.
+ */
+static void ssh_cache_write ( const char *filename, uint32_t flags, const char *home, const SSHHostList *list )
+{
+    GString        *strings = g_string_sized_new ( 65536 );
+    SSHCacheFile   *cfiles  = g_malloc0_n ( list->files->len + 1, sizeof ( SSHCacheFile ) );
+    uint32_t       *chosts  = g_malloc0_n ( list->length + 1, sizeof ( uint32_t ) );
+    SSHCacheHeader header;
+    memset ( &header, 0, sizeof ( header ) );
+    memcpy ( header.magic, SSH_HOSTS_CACHE_MAGIC, 4 );
+    header.version   = SSH_HOSTS_CACHE_VERSION;
+    header.flags     = flags;
+    header.num_files = list->files->len;
+    header.num_hosts = list->length;
+    header.num_known = list->num_known;
+    header.home      = ssh_cache_add_string ( strings, home );
+    for ( unsigned int i = 0; i < list->files->len; i++ ) {
+        const SSHSourceFile *file = &g_array_index ( list->files, SSHSourceFile, i );
+        SSHCacheFile        *cf   = &( cfiles[i] );
+        cf->path   = ssh_cache_add_string ( strings, file->path );
+        cf->parsed = file->parsed;
+        cf->flags  = ( file->exists ? SSH_SOURCE_EXISTS : 0 ) | ( file->known_hosts ? SSH_SOURCE_KNOWN_HOSTS : 0 );
+        if ( file->exists ) {
+            cf->dev        = file->st.st_dev;
+            cf->ino        = file->st.st_ino;
+            cf->size       = file->st.st_size;
+            cf->mtime_sec  = file->st.st_mtim.tv_sec;
+            cf->mtime_nsec = file->st.st_mtim.tv_nsec;
+        }
+    }
+    for ( unsigned int i = 0; i < list->length; i++ ) {
+        chosts[i] = ssh_cache_add_string ( strings, list->hosts[i] );
+    }
+    header.strings_size = strings->len;
+
+    int  retv     = FALSE;
+    char *tmpname = g_strdup_printf ( "%s.XXXXXX", filename );
+    int  fd       = g_mkstemp ( tmpname );
+    if ( fd >= 0 ) {
+        FILE *fp = fdopen ( fd, "w" );
+        if ( fp != NULL ) {
+            int ok = fwrite ( &header, sizeof ( header ), 1, fp ) == 1;
+            ok   = ok && ( header.num_files == 0 || fwrite ( cfiles, sizeof ( SSHCacheFile ), header.num_files, fp ) == header.num_files );
+            ok   = ok && ( header.num_hosts == 0 || fwrite ( chosts, sizeof ( uint32_t ), header.num_hosts, fp ) == header.num_hosts );
+            ok   = ok && fwrite ( strings->str, 1, strings->len, fp ) == strings->len;
+            ok   = ( fclose ( fp ) == 0 ) && ok;
+            retv = ok && rename ( tmpname, filename ) == 0;
+        }
+        else {
+            close ( fd );
+        }
+        if ( !retv ) {
+            fprintf ( stderr, "Failed to write ssh host cache: %s: %s\n", filename, strerror ( errno ) );
+            unlink ( tmpname );
+        }
+    }
+    g_free ( tmpname );
+    g_free ( chosts );
+    g_free ( cfiles );
+    g_string_free ( strings, TRUE );
+}
+
+/**
+ * @param list The list of hosts.
+ * @param path The known_hosts file.
+ * @param offset Where to start parsing.
+ *
+ * Read the hosts from the known_hosts file.
+ */
+static void ssh_read_known_hosts ( SSHHostList *list, const char *path, off_t offset )
+{
+    ssh_read_lines ( list, path, offset, ssh_parse_known_hosts_line, NULL );
+    g_array_index ( list->files, SSHSourceFile, list->files->len - 1 ).known_hosts = TRUE;
+    list->num_known = list->length;
+}
+
+/**
+ * @param list The list of hosts.
+ * @param flags The sources to parse.
+ * @param home The home directory.
+ *
+ * Read the hosts from all sources.
+ */
+static void ssh_read_sources ( SSHHostList *list, uint32_t flags, const char *home )
+{
+    char *path;
+    if ( flags & SSH_HOSTS_CACHE_PARSE_KNOWN_HOSTS ) {
+        path = g_build_filename ( home, ".ssh", "known_hosts", NULL );
+        ssh_read_known_hosts ( list, path, 0 );
+        g_free ( path );
+    }
+    if ( flags & SSH_HOSTS_CACHE_PARSE_HOSTS ) {
+        ssh_read_lines ( list, "/etc/hosts", 0, ssh_parse_hosts_line, NULL );
+    }
+
+    path = g_build_filename ( home, ".ssh", "config", NULL );
+    ssh_parse_config_file ( list, path, 0 );
+    g_free ( path );
+}
+
+char ** ssh_hosts_read ( const char *home, const char *cache_path, unsigned int flags, unsigned int *length, SSHCacheState *state )
+{
+    SSHHostList   list;
+    SSHCache      cache;
+    uint32_t      known = 0;
+    SSHCacheState found = SSH_CACHE_MISS;
+
+    ssh_host_list_init ( &list, home );
+    if ( ssh_cache_load ( &cache, cache_path ) ) {
+        found = ssh_cache_check ( &cache, &list, flags, home, &known );
+    }
+    if ( found == SSH_CACHE_HIT || found == SSH_CACHE_TAIL ) {
+        const SSHCacheHeader *h         = cache.header;
+        uint32_t             first_rest = ( found == SSH_CACHE_TAIL ) ? h->num_known : 0;
+        for ( uint32_t i = 0; i < first_rest; i++ ) {
+            ssh_host_list_add ( &list, cache.strings + cache.hosts[i] );
+        }
+        if ( found == SSH_CACHE_TAIL ) {
+            const SSHCacheFile *cf = &( cache.files[known] );
+            ssh_read_known_hosts ( &list, cache.strings + cf->path, cf->parsed );
+        }
+        else {
+            list.num_known = h->num_known;
+        }
+        for ( uint32_t i = first_rest; i < h->num_hosts; i++ ) {
+            ssh_host_list_add ( &list, cache.strings + cache.hosts[i] );
+        }
+    }
+    else {
+        for ( unsigned int i = 0; i < list.files->len; i++ ) {
+            g_free ( g_array_index ( list.files, SSHSourceFile, i ).path );
+        }
+        g_array_set_size ( list.files, 0 );
+        ssh_read_sources ( &list, flags, home );
+    }
+    ssh_cache_free ( &cache );
+    if ( found != SSH_CACHE_HIT ) {
+        if ( list.cacheable ) {
+            ssh_cache_write ( cache_path, flags, home, &list );
+        }
+        else {
+            // Changes can not be detected, do not use an old cache next time.
+            unlink ( cache_path );
+        }
+    }
+    ssh_host_list_clear ( &list );
+    if ( state != NULL ) {
+        *state = found;
+    }
+    *length = list.length;
+    return list.hosts;
+}
+
+char ** ssh_hosts_merge ( char **hosts, unsigned int *length, char **more, unsigned int num_more )
+{
+    SSHHostList list;
+    ssh_host_list_init ( &list, NULL );
+    list.hosts  = hosts;
+    list.length = ( hosts != NULL ) ? *length : 0;
+    list.size   = list.length + 1;
+    for ( unsigned int i = 0; i < list.length; i++ ) {
+        g_hash_table_add ( list.seen, list.hosts[i] );
+    }
+    for ( unsigned int i = 0; i < num_more; i++ ) {
+        ssh_host_list_append ( &list, more[i] );
+    }
+    g_free ( more );
+    ssh_host_list_clear ( &list );
+    *length = list.length;
+    return list.hosts;
+}
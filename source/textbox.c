@@ -219,11 +219,11 @@ void textbox_moveresize ( textbox *tb, int x, int y, int w, int h )
         tb->widget.y = y;
         tb->widget.h = MAX ( 1, h );
         tb->widget.w = MAX ( 1, w );
+        tb->update   = TRUE;
     }
 
     // We always want to update this
     pango_layout_set_width ( tb->layout, PANGO_SCALE * ( tb->widget.w - 2 * SIDE_MARGIN ) );
-    tb->update = TRUE;
 }
 
 // will also unmap the window if still displayed
@@ -257,14 +257,19 @@ void textbox_free ( textbox *tb )
 static void texbox_update ( textbox *tb )
 {
     if ( tb->update ) {
-        if ( tb->main_surface ) {
+        // Keep the surface as long as the size does not change, it is painted over completely.
+        if ( tb->main_surface != NULL &&
+             ( cairo_image_surface_get_width ( tb->main_surface ) != tb->widget.w ||
+               cairo_image_surface_get_height ( tb->main_surface ) != tb->widget.h ) ) {
             cairo_destroy ( tb->main_draw );
             cairo_surface_destroy ( tb->main_surface );
             tb->main_draw    = NULL;
             tb->main_surface = NULL;
         }
-        tb->main_surface = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, tb->widget.w, tb->widget.h );
-        tb->main_draw    = cairo_create ( tb->main_surface );
+        if ( tb->main_surface == NULL ) {
+            tb->main_surface = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, tb->widget.w, tb->widget.h );
+            tb->main_draw    = cairo_create ( tb->main_surface );
+        }
         cairo_set_operator ( tb->main_draw, CAIRO_OPERATOR_SOURCE );
 
         pango_cairo_update_layout ( tb->main_draw, tb->layout );
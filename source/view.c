@@ -78,6 +78,14 @@ struct
     cairo_surface_t *fake_bg;
     int             fake_bgrel;
     cairo_t         *draw;
+    /** Copy of the window content, only changed widgets are redrawn in it. */
+    cairo_surface_t *backbuffer;
+    /** The backbuffer has to be redrawn completely on the next update. */
+    int             repaint;
+    /** Part of the window that needs to be copied from the backbuffer. */
+    cairo_region_t  *damage;
+    /** The view drawn in the backbuffer. */
+    RofiViewState   *painted;
     MenuFlags       flags;
     GQueue          views;
     int             width, height;
@@ -89,6 +97,10 @@ struct
     .fake_bg     = NULL,
     .fake_bgrel  = FALSE,
     .draw        = NULL,
+    .backbuffer  = NULL,
+    .repaint     = TRUE,
+    .damage      = NULL,
+    .painted     = NULL,
     .flags       = MENU_NORMAL,
     .views       = G_QUEUE_INIT,
     .width       =               0,
@@ -228,6 +240,45 @@ static void calculate_window_position ( void )
     CacheState.y += config.y_offset;
 }
 
+/**
+ * @param x The x coordinate of the area.
+ * @param y The y coordinate of the area.
+ * @param w The width of the area.
+ * @param h The height of the area.
+ *
+ * Mark an area of the window to be copied from the backbuffer on the next update.
+ */
+static void rofi_view_damage ( int x, int y, int w, int h )
+{
+    cairo_rectangle_int_t rect = { x, y, w, h };
+    if ( CacheState.damage == NULL ) {
+        CacheState.damage = cairo_region_create ();
+    }
+    cairo_region_union_rectangle ( CacheState.damage, &rect );
+}
+
+/**
+ * Copy the damaged part of the backbuffer to the window.
+ */
+static void rofi_view_push_damage ( void )
+{
+    if ( CacheState.damage == NULL ) {
+        return;
+    }
+    cairo_rectangle_int_t window = { 0, 0, CacheState.width, CacheState.height };
+    cairo_region_intersect_rectangle ( CacheState.damage, &window );
+    int                   num = cairo_region_num_rectangles ( CacheState.damage );
+    for ( int i = 0; i < num; i++ ) {
+        cairo_rectangle_int_t rect;
+        cairo_region_get_rectangle ( CacheState.damage, i, &rect );
+        cairo_rectangle ( CacheState.draw, rect.x, rect.y, rect.width, rect.height );
+    }
+    cairo_set_source_surface ( CacheState.draw, CacheState.backbuffer, 0, 0 );
+    cairo_fill ( CacheState.draw );
+    cairo_region_destroy ( CacheState.damage );
+    CacheState.damage = NULL;
+}
+
 void rofi_view_queue_redraw ( void  )
 {
     if ( current_active_menu ) {
@@ -280,13 +331,18 @@ void rofi_view_set_selected_line ( RofiViewState *state, unsigned int selected_l
         }
     }
 
-    state->update = TRUE;
+    // The mode can have changed the state of the rows, (e.g. dmenu multi-select) re-read them.
+    state->rchanged = TRUE;
+    state->update   = TRUE;
     xcb_clear_area ( xcb->connection, CacheState.main_window, 1, 0, 0, 1, 1 );
     xcb_flush ( xcb->connection );
 }
 
 void rofi_view_free ( RofiViewState *state )
 {
+    if ( CacheState.painted == state ) {
+        CacheState.painted = NULL;
+    }
     // Do this here?
     // Wait for final release?
     textbox_free ( state->text );
@@ -418,8 +474,12 @@ void rofi_view_itterrate ( RofiViewState *state, xcb_generic_event_t *event, xkb
     switch ( type )
     {
     case XCB_EXPOSE:
+    {
+        xcb_expose_event_t *xee = (xcb_expose_event_t *) event;
+        rofi_view_damage ( xee->x, xee->y, xee->width, xee->height );
         state->update = TRUE;
         break;
+    }
     case XCB_CONFIGURE_NOTIFY:
     {
         xcb_configure_notify_event_t *xce = (xcb_configure_notify_event_t *) event;
@@ -428,6 +488,10 @@ void rofi_view_itterrate ( RofiViewState *state, xcb_generic_event_t *event, xkb
                 CacheState.x  = xce->x;
                 CacheState.y  = xce->y;
                 state->update = TRUE;
+                // The fake background depends on the position.
+                if ( config.fake_transparency ) {
+                    CacheState.repaint = TRUE;
+                }
             }
             if ( CacheState.width != xce->width || CacheState.height != xce->height ) {
                 CacheState.width  = xce->width;
@@ -462,18 +526,6 @@ static RofiViewState * __rofi_view_state_create ( void )
     return g_malloc0 ( sizeof ( RofiViewState ) );
 }
 
-typedef struct _thread_state
-{
-    RofiViewState *state;
-    char          **tokens;
-    unsigned int  start;
-    unsigned int  stop;
-    unsigned int  count;
-    GCond         *cond;
-    GMutex        *mutex;
-    unsigned int  *acount;
-    void ( *callback )( struct _thread_state *t, gpointer data );
-}thread_state;
 /**
  * @param data A thread_state object.
  * @param user_data User data to pass to thread_state callback
@@ -490,21 +542,33 @@ static void rofi_view_call_thread ( gpointer data, gpointer user_data )
     g_mutex_unlock ( t->mutex );
 }
 
+/**
+ * @param state The Menu Handle
+ * @param tokens The tokens to match.
+ * @param line The line to match.
+ *
+ * Match one line, and when sorting, calculate its distance to the input.
+ *
+ * @returns TRUE if each token matched.
+ */
+static int rofi_view_match_line ( RofiViewState *state, char **tokens, unsigned int line )
+{
+    int match = mode_token_match ( state->sw, tokens, state->lines_not_ascii[line], config.case_sensitive, line );
+    if ( match && config.levenshtein_sort ) {
+        // This is inefficient, need to fix it.
+        char * str = mode_get_completion ( state->sw, line );
+        state->distance[line] = levenshtein ( state->text->text, str );
+        g_free ( str );
+    }
+    return match;
+}
 static void filter_elements ( thread_state *t, G_GNUC_UNUSED gpointer user_data )
 {
     // input changed
     for ( unsigned int i = t->start; i < t->stop; i++ ) {
-        int match = mode_token_match ( t->state->sw, t->tokens, t->state->lines_not_ascii[i],
-                                       config.case_sensitive, i );
         // If each token was matched, add it to list.
-        if ( match ) {
+        if ( rofi_view_match_line ( t->state, t->tokens, i ) ) {
             t->state->line_map[t->start + t->count] = i;
-            if ( config.levenshtein_sort ) {
-                // This is inefficient, need to fix it.
-                char * str = mode_get_completion ( t->state->sw, i );
-                t->state->distance[i] = levenshtein ( t->state->text->text, str );
-                g_free ( str );
-            }
             t->count++;
         }
     }
@@ -896,15 +960,106 @@ static unsigned int rofi_scroll_continious ( RofiViewState * state )
     return offset;
 }
 
-static void rofi_view_draw ( RofiViewState *state, cairo_t *d )
+static unsigned int rofi_view_scroll ( RofiViewState *state )
 {
-    unsigned int i, offset = 0;
     if ( config.scroll_method == 1 ) {
-        offset = rofi_scroll_continious ( state );
+        return rofi_scroll_continious ( state );
+    }
+    return rofi_scroll_per_page ( state );
+}
+
+/**
+ * @param d The cairo context of the backbuffer.
+ *
+ * Paint the window background.
+ */
+static void rofi_view_paint_background ( cairo_t *d )
+{
+    cairo_set_operator ( d, CAIRO_OPERATOR_SOURCE );
+    if ( config.fake_transparency ) {
+        if ( CacheState.fake_bg != NULL ) {
+            if ( CacheState.fake_bgrel ) {
+                cairo_set_source_surface ( d, CacheState.fake_bg, 0.0, 0.0 );
+            }
+            else {
+                cairo_set_source_surface ( d, CacheState.fake_bg,
+                                           -(double) ( CacheState.x - CacheState.mon.x ),
+                                           -(double) ( CacheState.y - CacheState.mon.y ) );
+            }
+            cairo_paint ( d );
+            cairo_set_operator ( d, CAIRO_OPERATOR_OVER );
+            color_background ( d );
+            cairo_paint ( d );
+        }
+        else {
+            // The backbuffer is kept, clear what was drawn before.
+            cairo_set_source_rgba ( d, 0.0, 0.0, 0.0, 0.0 );
+            cairo_paint ( d );
+        }
     }
     else {
-        offset = rofi_scroll_per_page ( state );
+        // Paint the background.
+        color_background ( d );
+        cairo_paint ( d );
     }
+}
+
+/**
+ * @param d The cairo context of the backbuffer.
+ * @param widget The widget to redraw.
+ *
+ * Paint the background under the widget, before it is drawn again.
+ */
+static void rofi_view_restore_background ( cairo_t *d, const Widget *widget )
+{
+    cairo_save ( d );
+    cairo_rectangle ( d, widget->x, widget->y, widget->w, widget->h );
+    cairo_clip ( d );
+    rofi_view_paint_background ( d );
+    cairo_restore ( d );
+    rofi_view_damage ( widget->x, widget->y, widget->w, widget->h );
+}
+
+/**
+ * @param tb The textbox to draw.
+ * @param d The cairo context of the backbuffer.
+ *
+ * Draw the textbox if the backbuffer is repainted or when it changed.
+ */
+static void rofi_view_draw_textbox ( textbox *tb, cairo_t *d )
+{
+    if ( CacheState.repaint ) {
+        textbox_draw ( tb, d );
+    }
+    else if ( tb->update ) {
+        rofi_view_restore_background ( d, WIDGET ( tb ) );
+        textbox_draw ( tb, d );
+    }
+}
+
+/**
+ * @param sb The scrollbar to draw.
+ * @param d The cairo context of the backbuffer.
+ *
+ * Draw the scrollbar if the backbuffer is repainted or when it changed.
+ */
+static void rofi_view_draw_scrollbar ( scrollbar *sb, cairo_t *d )
+{
+    if ( sb == NULL ) {
+        return;
+    }
+    if ( CacheState.repaint ) {
+        scrollbar_draw ( sb, d );
+    }
+    else if ( sb->update ) {
+        rofi_view_restore_background ( d, WIDGET ( sb ) );
+        scrollbar_draw ( sb, d );
+    }
+}
+
+static void rofi_view_draw ( RofiViewState *state, cairo_t *d, unsigned int offset )
+{
+    unsigned int i;
     // Re calculate the boxes and sizes, see if we can move this in the menu_calc*rowscolumns
     // Get number of remaining lines to display.
     unsigned int a_lines = MIN ( ( state->filtered_lines - offset ), state->max_elements );
@@ -918,7 +1073,7 @@ static void rofi_view_draw ( RofiViewState *state, cairo_t *d )
     unsigned int max_elements = MIN ( a_lines, state->max_rows * columns );
 
     scrollbar_set_handle_length ( state->scrollbar, columns * state->max_rows );
-    scrollbar_draw ( state->scrollbar, d );
+    rofi_view_draw_scrollbar ( state->scrollbar, d );
     // Element width.
     unsigned int element_width = CacheState.width - ( 2 * ( state->border ) );
     if ( state->scrollbar != NULL ) {
@@ -940,27 +1095,31 @@ static void rofi_view_draw ( RofiViewState *state, cairo_t *d )
             // Move it around.
             textbox_moveresize ( state->boxes[i], ex + x_offset, ey + y_offset, element_width, element_height );
             {
+                textbox         *tb    = state->boxes[i];
                 TextBoxFontType type   = ( ( ( i % state->max_rows ) & 1 ) == 0 ) ? NORMAL : ALT;
                 int             fstate = 0;
                 char            *text  = mode_get_display_value ( state->sw, state->line_map[i + offset], &fstate, TRUE );
                 TextBoxFontType tbft   = fstate | ( ( i + offset ) == state->selected ? HIGHLIGHT : type );
-                textbox_font ( state->boxes[i], tbft );
-                textbox_text ( state->boxes[i], text );
+                int             markup = ( tb->tbft ^ tbft ) & MARKUP;
+                textbox_font ( tb, tbft );
+                // Rows that still show the same text keep their layout and rendered surface.
+                if ( markup || g_strcmp0 ( tb->text, text ) != 0 ) {
+                    textbox_text ( tb, text );
+                }
                 g_free ( text );
             }
-            textbox_draw ( state->boxes[i], d );
+            rofi_view_draw_textbox ( state->boxes[i], d );
         }
         state->rchanged = FALSE;
     }
     else{
-        // Only do basic redrawing + highlight of row.
+        // The rows show the same entries as on the last pass, only the highlight moved.
+        // Rows whose font type does not change are not redrawn.
         for ( i = 0; i < max_elements && ( i + offset ) < state->filtered_lines; i++ ) {
-            TextBoxFontType type   = ( ( ( i % state->max_rows ) & 1 ) == 0 ) ? NORMAL : ALT;
-            int             fstate = 0;
-            mode_get_display_value ( state->sw, state->line_map[i + offset], &fstate, FALSE );
-            TextBoxFontType tbft = fstate | ( ( i + offset ) == state->selected ? HIGHLIGHT : type );
+            TextBoxFontType type = ( ( ( i % state->max_rows ) & 1 ) == 0 ) ? NORMAL : ALT;
+            TextBoxFontType tbft = ( state->boxes[i]->tbft & ~FMOD_MASK ) | ( ( i + offset ) == state->selected ? HIGHLIGHT : type );
             textbox_font ( state->boxes[i], tbft );
-            textbox_draw ( state->boxes[i], d );
+            rofi_view_draw_textbox ( state->boxes[i], d );
         }
     }
 }
@@ -971,34 +1130,32 @@ void rofi_view_update ( RofiViewState *state )
         return;
     }
     TICK ();
-    cairo_surface_t * surf = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, CacheState.width, CacheState.height );
-    cairo_t         *d     = cairo_create ( surf );
-    cairo_set_operator ( d, CAIRO_OPERATOR_SOURCE );
-    if ( config.fake_transparency ) {
-        if ( CacheState.fake_bg != NULL ) {
-            if ( CacheState.fake_bgrel ) {
-                cairo_set_source_surface ( d, CacheState.fake_bg, 0.0, 0.0 );
-            }
-            else {
-                cairo_set_source_surface ( d, CacheState.fake_bg,
-                                           -(double) ( CacheState.x - CacheState.mon.x ),
-                                           -(double) ( CacheState.y - CacheState.mon.y ) );
-            }
-            cairo_paint ( d );
-            cairo_set_operator ( d, CAIRO_OPERATOR_OVER );
-            color_background ( d );
-            cairo_paint ( d );
+    if ( CacheState.backbuffer == NULL ||
+         cairo_image_surface_get_width ( CacheState.backbuffer ) != CacheState.width ||
+         cairo_image_surface_get_height ( CacheState.backbuffer ) != CacheState.height ) {
+        if ( CacheState.backbuffer != NULL ) {
+            cairo_surface_destroy ( CacheState.backbuffer );
         }
+        CacheState.backbuffer = cairo_image_surface_create ( CAIRO_FORMAT_ARGB32, CacheState.width, CacheState.height );
+        CacheState.repaint    = TRUE;
     }
-    else {
-        // Paint the background.
-        color_background ( d );
-        cairo_paint ( d );
+    // Scrolling can change the visible rows, do it before deciding what to redraw.
+    unsigned int offset = 0;
+    if ( state->max_elements > 0 ) {
+        offset = rofi_view_scroll ( state );
+    }
+    if ( CacheState.painted != state || state->rchanged ) {
+        CacheState.repaint = TRUE;
+    }
+    cairo_t *d = cairo_create ( CacheState.backbuffer );
+    if ( CacheState.repaint ) {
+        rofi_view_paint_background ( d );
+        rofi_view_damage ( 0, 0, CacheState.width, CacheState.height );
     }
     TICK_N ( "Background" );
     color_border ( d );
 
-    if ( config.menu_bw > 0 ) {
+    if ( CacheState.repaint && config.menu_bw > 0 ) {
         cairo_save ( d );
         cairo_set_line_width ( d, config.menu_bw );
         cairo_rectangle ( d,
@@ -1013,23 +1170,23 @@ void rofi_view_update ( RofiViewState *state )
     // Always paint as overlay over the background.
     cairo_set_operator ( d, CAIRO_OPERATOR_OVER );
     if ( state->max_elements > 0 ) {
-        rofi_view_draw ( state, d );
+        rofi_view_draw ( state, d, offset );
     }
     if ( state->prompt_tb ) {
-        textbox_draw ( state->prompt_tb, d );
+        rofi_view_draw_textbox ( state->prompt_tb, d );
     }
     if ( state->text ) {
-        textbox_draw ( state->text, d );
+        rofi_view_draw_textbox ( state->text, d );
     }
     if ( state->case_indicator ) {
-        textbox_draw ( state->case_indicator, d );
+        rofi_view_draw_textbox ( state->case_indicator, d );
     }
     if ( state->message_tb ) {
-        textbox_draw ( state->message_tb, d );
+        rofi_view_draw_textbox ( state->message_tb, d );
     }
     color_separator ( d );
 
-    if ( strcmp ( config.separator_style, separator_style_none ) ) {
+    if ( CacheState.repaint && strcmp ( config.separator_style, separator_style_none ) ) {
         if ( strcmp ( config.separator_style, separator_style_dash ) == 0 ) {
             const double dashes[1] = { 4 };
             cairo_set_dash ( d, dashes, 1, 0.0 );
@@ -1054,18 +1211,17 @@ void rofi_view_update ( RofiViewState *state )
     if ( config.sidebar_mode == TRUE ) {
         for ( unsigned int j = 0; j < state->num_modi; j++ ) {
             if ( state->modi[j] != NULL ) {
-                textbox_draw ( state->modi[j], d );
+                rofi_view_draw_textbox ( state->modi[j], d );
             }
         }
     }
-    state->update = FALSE;
-
-    // Draw to actual window.
-    cairo_set_source_surface ( CacheState.draw, surf, 0, 0 );
-    cairo_paint ( CacheState.draw );
-    // Cleanup
+    state->update      = FALSE;
+    CacheState.painted = state;
+    CacheState.repaint = FALSE;
     cairo_destroy ( d );
-    cairo_surface_destroy ( surf );
+
+    // Copy the changed part to the actual window.
+    rofi_view_push_damage ();
 
     // Flush the surface.
     cairo_surface_flush ( CacheState.surface );
@@ -1240,58 +1396,52 @@ static void rofi_view_mouse_navigation ( RofiViewState *state, xcb_button_press_
         }
     }
 }
+/**
+ * @param state The Menu Handle
+ * @param tokens The tokens to match.
+ * @param start The first line to filter.
+ * @param j The position in the line_map to store the first match, should be <= start.
+ *
+ * Filter the lines from start till the end, storing the matches in the line_map from j on.
+ *
+ * @returns the position in the line_map after the last match.
+ */
+static unsigned int rofi_view_filter_lines ( RofiViewState *state, char **tokens, unsigned int start, unsigned int j )
+{
+    /**
+     * On long lists it can be beneficial to parallelize.
+     * If number of threads is 1, no thread is spawn.
+     * If number of threads > 1 and there are enough (> 1000) items, spawn jobs for the thread pool.
+     * For large lists with 8 threads I see a factor three speedup of the whole function.
+     */
+    unsigned int num   = state->num_lines - start;
+    unsigned int nt    = MAX ( 1, num / 500 );
+    thread_state states[nt];
+    unsigned int steps = ( num + nt ) / nt;
+    for ( unsigned int i = 0; i < nt; i++ ) {
+        states[i].state    = state;
+        states[i].tokens   = tokens;
+        states[i].start    = start + i * steps;
+        states[i].stop     = MIN ( state->num_lines, start + ( i + 1 ) * steps );
+        states[i].count    = 0;
+        states[i].callback = filter_elements;
+    }
+    rofi_view_run_jobs ( states, nt );
+    for ( unsigned int i = 0; i < nt; i++ ) {
+        if ( j != states[i].start ) {
+            memmove ( &( state->line_map[j] ), &( state->line_map[states[i].start] ), sizeof ( unsigned int ) * ( states[i].count ) );
+        }
+        j += states[i].count;
+    }
+    return j;
+}
+
 static void rofi_view_refilter ( RofiViewState *state )
 {
     TICK_N ( "Filter start" );
     if ( strlen ( state->text->text ) > 0 ) {
-        unsigned int j        = 0;
         char         **tokens = tokenize ( state->text->text, config.case_sensitive );
-        /**
-         * On long lists it can be beneficial to parallelize.
-         * If number of threads is 1, no thread is spawn.
-         * If number of threads > 1 and there are enough (> 1000) items, spawn jobs for the thread pool.
-         * For large lists with 8 threads I see a factor three speedup of the whole function.
-         */
-        unsigned int nt = MAX ( 1, state->num_lines / 500 );
-        thread_state states[nt];
-        GCond        cond;
-        GMutex       mutex;
-        g_mutex_init ( &mutex );
-        g_cond_init ( &cond );
-        unsigned int count = nt;
-        unsigned int steps = ( state->num_lines + nt ) / nt;
-        for ( unsigned int i = 0; i < nt; i++ ) {
-            states[i].state    = state;
-            states[i].tokens   = tokens;
-            states[i].start    = i * steps;
-            states[i].stop     = MIN ( state->num_lines, ( i + 1 ) * steps );
-            states[i].count    = 0;
-            states[i].cond     = &cond;
-            states[i].mutex    = &mutex;
-            states[i].acount   = &count;
-            states[i].callback = filter_elements;
-            if ( i > 0 ) {
-                g_thread_pool_push ( tpool, &states[i], NULL );
-            }
-        }
-        // Run one in this thread.
-        rofi_view_call_thread ( &states[0], NULL );
-        // No need to do this with only one thread.
-        if ( nt > 1 ) {
-            g_mutex_lock ( &mutex );
-            while ( count > 0 ) {
-                g_cond_wait ( &cond, &mutex );
-            }
-            g_mutex_unlock ( &mutex );
-        }
-        g_cond_clear ( &cond );
-        g_mutex_clear ( &mutex );
-        for ( unsigned int i = 0; i < nt; i++ ) {
-            if ( j != states[i].start ) {
-                memmove ( &( state->line_map[j] ), &( state->line_map[states[i].start] ), sizeof ( unsigned int ) * ( states[i].count ) );
-            }
-            j += states[i].count;
-        }
+        unsigned int j        = rofi_view_filter_lines ( state, tokens, 0, 0 );
         if ( config.levenshtein_sort ) {
             g_qsort_with_data ( state->line_map, j, sizeof ( int ), lev_sort, state->distance );
         }
@@ -1325,6 +1475,133 @@ static void rofi_view_refilter ( RofiViewState *state )
     state->update   = TRUE;
     TICK_N ( "Filter done" );
 }
+void rofi_view_reload_appended ( RofiViewState *state )
+{
+    unsigned int old_num = state->num_lines;
+    unsigned int num     = mode_get_num_entries ( state->sw );
+    if ( num <= old_num ) {
+        return;
+    }
+    TICK_N ( "Append start" );
+    state->num_lines       = num;
+    state->lines_not_ascii = g_realloc_n ( state->lines_not_ascii, num, sizeof ( int ) );
+    state->line_map        = g_realloc_n ( state->line_map, num, sizeof ( unsigned int ) );
+    state->distance        = g_realloc_n ( state->distance, num, sizeof ( int ) );
+    memset ( &( state->distance[old_num] ), 0, ( num - old_num ) * sizeof ( int ) );
+
+    thread_state t;
+    memset ( &t, 0, sizeof ( t ) );
+    t.state = state;
+    t.start = old_num;
+    t.stop  = num;
+    check_is_ascii ( &t, NULL );
+
+    // A full refilter is pending, it picks up the new lines.
+    if ( !state->refilter ) {
+        if ( strlen ( state->text->text ) > 0 ) {
+            // Only match the new lines, the old matches stay valid.
+            char **tokens = tokenize ( state->text->text, config.case_sensitive );
+            state->filtered_lines = rofi_view_filter_lines ( state, tokens, old_num, state->filtered_lines );
+            if ( config.levenshtein_sort ) {
+                g_qsort_with_data ( state->line_map, state->filtered_lines, sizeof ( int ), lev_sort, state->distance );
+            }
+            tokenize_free ( tokens );
+        }
+        else {
+            for ( unsigned int i = old_num; i < num; i++ ) {
+                state->line_map[state->filtered_lines++] = i;
+            }
+        }
+        scrollbar_set_max_value ( state->scrollbar, state->filtered_lines );
+        state->rchanged = TRUE;
+    }
+    TICK_N ( "Append done" );
+    state->update = TRUE;
+    rofi_view_queue_redraw ();
+}
+
+void rofi_view_reload ( RofiViewState *state )
+{
+    TICK_N ( "Reload start" );
+    state->num_lines       = mode_get_num_entries ( state->sw );
+    state->lines_not_ascii = g_realloc_n ( state->lines_not_ascii, MAX ( 1, state->num_lines ), sizeof ( int ) );
+    state->line_map        = g_realloc_n ( state->line_map, MAX ( 1, state->num_lines ), sizeof ( unsigned int ) );
+    state->distance        = g_realloc_n ( state->distance, MAX ( 1, state->num_lines ), sizeof ( int ) );
+    memset ( state->distance, 0, state->num_lines * sizeof ( int ) );
+
+    thread_state t;
+    memset ( &t, 0, sizeof ( t ) );
+    t.state = state;
+    t.start = 0;
+    t.stop  = state->num_lines;
+    check_is_ascii ( &t, NULL );
+
+    // The old line_map can point past the end, the refilter rebuilds it before the next draw.
+    state->filtered_lines = 0;
+    state->refilter       = TRUE;
+    state->update         = TRUE;
+    TICK_N ( "Reload done" );
+    rofi_view_queue_redraw ();
+}
+
+void rofi_view_reload_lines ( RofiViewState *state, const unsigned int *lines, unsigned int num )
+{
+    TICK_N ( "Reload lines start" );
+    thread_state t;
+    memset ( &t, 0, sizeof ( t ) );
+    t.state = state;
+    for ( unsigned int i = 0; i < num; i++ ) {
+        t.start = lines[i];
+        t.stop  = lines[i] + 1;
+        check_is_ascii ( &t, NULL );
+    }
+
+    // Without input every line is shown, and with a full refilter pending all lines are matched.
+    if ( !state->refilter && strlen ( state->text->text ) > 0 ) {
+        char         **tokens = tokenize ( state->text->text, config.case_sensitive );
+        // Drop the changed lines, the others keep their match.
+        unsigned int j = 0;
+        for ( unsigned int i = 0; i < state->filtered_lines; i++ ) {
+            unsigned int l = 0;
+            while ( l < num && lines[l] != state->line_map[i] ) {
+                l++;
+            }
+            if ( l == num ) {
+                state->line_map[j++] = state->line_map[i];
+            }
+        }
+        // Match them again, keeping the line_map sorted on line number.
+        for ( unsigned int i = 0; i < num; i++ ) {
+            if ( rofi_view_match_line ( state, tokens, lines[i] ) ) {
+                unsigned int pos = j;
+                while ( pos > 0 && state->line_map[pos - 1] > lines[i] ) {
+                    pos--;
+                }
+                memmove ( &( state->line_map[pos + 1] ), &( state->line_map[pos] ), ( j - pos ) * sizeof ( unsigned int ) );
+                state->line_map[pos] = lines[i];
+                j++;
+            }
+        }
+        if ( config.levenshtein_sort ) {
+            g_qsort_with_data ( state->line_map, j, sizeof ( int ), lev_sort, state->distance );
+        }
+        tokenize_free ( tokens );
+
+        state->filtered_lines = j;
+        if ( state->filtered_lines > 0 ) {
+            state->selected = MIN ( state->selected, state->filtered_lines - 1 );
+        }
+        else {
+            state->selected = 0;
+        }
+        scrollbar_set_max_value ( state->scrollbar, state->filtered_lines );
+    }
+    state->rchanged = TRUE;
+    state->update   = TRUE;
+    TICK_N ( "Reload lines done" );
+    rofi_view_queue_redraw ();
+}
+
 /**
  * @param state The Menu Handle
  *
@@ -1638,35 +1915,13 @@ RofiViewState *rofi_view_create ( Mode *sw,
         unsigned int nt = MAX ( 1, state->num_lines / 5000 );
         thread_state states[nt];
         unsigned int steps = ( state->num_lines + nt ) / nt;
-        unsigned int count = nt;
-        GCond        cond;
-        GMutex       mutex;
-        g_mutex_init ( &mutex );
-        g_cond_init ( &cond );
         for ( unsigned int i = 0; i < nt; i++ ) {
             states[i].state    = state;
             states[i].start    = i * steps;
             states[i].stop     = MIN ( ( i + 1 ) * steps, state->num_lines );
-            states[i].acount   = &count;
-            states[i].mutex    = &mutex;
-            states[i].cond     = &cond;
             states[i].callback = check_is_ascii;
-            if ( i > 0 ) {
-                g_thread_pool_push ( tpool, &( states[i] ), NULL );
-            }
         }
-        // Run one in this thread.
-        rofi_view_call_thread ( &( states[0] ), NULL );
-        // No need to do this with only one thread.
-        if ( nt > 1 ) {
-            g_mutex_lock ( &mutex );
-            while ( count > 0 ) {
-                g_cond_wait ( &cond, &mutex );
-            }
-            g_mutex_unlock ( &mutex );
-        }
-        g_cond_clear ( &cond );
-        g_mutex_clear ( &mutex );
+        rofi_view_run_jobs ( states, nt );
         TICK_N ( "Is ASCII stop" );
     }
     TICK_N ( "Startup notification" );
@@ -1878,6 +2133,16 @@ int rofi_view_error_dialog ( const char *msg, int markup )
 
 void rofi_view_cleanup ()
 {
+    if ( CacheState.damage ) {
+        cairo_region_destroy ( CacheState.damage );
+        CacheState.damage = NULL;
+    }
+    if ( CacheState.backbuffer ) {
+        cairo_surface_destroy ( CacheState.backbuffer );
+        CacheState.backbuffer = NULL;
+    }
+    CacheState.painted = NULL;
+    CacheState.repaint = TRUE;
     if ( CacheState.fake_bg ) {
         cairo_surface_destroy ( CacheState.fake_bg );
         CacheState.fake_bg = NULL;
@@ -1928,6 +2193,43 @@ void rofi_view_workers_initialize ( void )
     }
     TICK_N ( "Setup Threadpool, done" );
 }
+void rofi_view_queue_job ( thread_state *t )
+{
+    if ( tpool != NULL ) {
+        g_thread_pool_push ( tpool, t, NULL );
+    }
+    else {
+        rofi_view_call_thread ( t, NULL );
+    }
+}
+void rofi_view_run_jobs ( thread_state *states, unsigned int num )
+{
+    GCond        cond;
+    GMutex       mutex;
+    unsigned int count = num;
+    g_mutex_init ( &mutex );
+    g_cond_init ( &cond );
+    for ( unsigned int i = 0; i < num; i++ ) {
+        states[i].cond   = &cond;
+        states[i].mutex  = &mutex;
+        states[i].acount = &count;
+        if ( i > 0 ) {
+            rofi_view_queue_job ( &states[i] );
+        }
+    }
+    // Run one in this thread.
+    rofi_view_call_thread ( &states[0], NULL );
+    // No need to do this with only one thread.
+    if ( num > 1 ) {
+        g_mutex_lock ( &mutex );
+        while ( count > 0 ) {
+            g_cond_wait ( &cond, &mutex );
+        }
+        g_mutex_unlock ( &mutex );
+    }
+    g_cond_clear ( &cond );
+    g_mutex_clear ( &mutex );
+}
 void rofi_view_workers_finalize ( void )
 {
     if ( tpool ) {
@@ -129,8 +129,12 @@ cairo_surface_t * x11_helper_get_bg_surface ( void )
 // technically we could use window_get_prop(), but this is better for character set support
 char* window_get_text_prop ( xcb_window_t w, xcb_atom_t atom )
 {
-    xcb_get_property_cookie_t c  = xcb_get_property ( xcb->connection, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
-    xcb_get_property_reply_t  *r = xcb_get_property_reply ( xcb->connection, c, NULL );
+    xcb_get_property_cookie_t c = xcb_get_property ( xcb->connection, 0, w, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX );
+    return window_get_text_prop_reply ( xcb_get_property_reply ( xcb->connection, c, NULL ) );
+}
+
+char* window_get_text_prop_reply ( xcb_get_property_reply_t *r )
+{
     if ( r ) {
         if ( xcb_get_property_value_length ( r ) > 0 ) {
             char *str = NULL;
@@ -119,6 +119,8 @@ static XrmOption xrmOptions[] = {
 
     { xrm_Boolean, "disable-history",   { .num  = &config.disable_history    }, NULL,
       "Disable history in run/ssh"                                          },
+    { xrm_Number,  "max-history-size",  { .num  = &config.max_history_size   }, NULL,
+      "Maximum number of entries kept in the history"                       },
     { xrm_Boolean, "levenshtein-sort",  { .num  = &config.levenshtein_sort   }, NULL,
       "Use levenshtein sorting"                                             },
     { xrm_Boolean, "case-sensitive",    { .num  = &config.case_sensitive     }, NULL,
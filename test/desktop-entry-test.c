@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <assert.h>
+#include <glib.h>
+#include <string.h>
+#include <desktop-entry.h>
+
+static int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %i passed (%s)\n", ++test, # a ); \
+}
+
+/** Number of times the corpus is parsed for the timings. */
+#define BENCHMARK_ROUNDS    20
+
+static const char * const languages[] = { "de_DE", "de", "C", NULL };
+
+static gboolean parse ( const char *data, DesktopEntry *entry )
+{
+    return desktop_entry_parse ( data, strlen ( data ), languages, entry );
+}
+
+/**
+ * Parse the file with GKeyFile, the way drun used to.
+ */
+static gboolean parse_key_file ( const char *data, gsize length, const char *locale, DesktopEntry *entry )
+{
+    GKeyFile *kf = g_key_file_new ();
+    memset ( entry, 0, sizeof ( *entry ) );
+    // Translations for other than the current locale are only kept when asked for.
+    if ( !g_key_file_load_from_data ( kf, data, length, locale != NULL ? G_KEY_FILE_KEEP_TRANSLATIONS : 0, NULL ) || !g_key_file_has_group ( kf, "Desktop Entry" ) ) {
+        g_key_file_free ( kf );
+        return FALSE;
+    }
+    entry->name         = g_key_file_get_locale_string ( kf, "Desktop Entry", "Name", locale, NULL );
+    entry->generic_name = g_key_file_get_locale_string ( kf, "Desktop Entry", "GenericName", locale, NULL );
+    entry->exec         = g_key_file_get_string ( kf, "Desktop Entry", "Exec", NULL );
+    entry->terminal     = g_key_file_get_boolean ( kf, "Desktop Entry", "Terminal", NULL );
+    entry->hidden       = g_key_file_get_boolean ( kf, "Desktop Entry", "Hidden", NULL );
+    entry->no_display   = g_key_file_get_boolean ( kf, "Desktop Entry", "NoDisplay", NULL );
+    g_key_file_free ( kf );
+    return TRUE;
+}
+
+/**
+ * Desktop files as they are found installed, compared against GKeyFile.
+ */
+static const char * const fixtures[] = {
+    "[Desktop Entry]\nVersion=1.0\nType=Application\nName=Firefox Web Browser\nName[de]=Firefox-Webbrowser\n"
+    "Name[fr]=Navigateur Web Firefox\nComment=Browse the World Wide Web\nGenericName=Web Browser\n"
+    "GenericName[de]=Webbrowser\nKeywords=Internet;WWW;Browser;Web;Explorer\nExec=firefox %u\nTerminal=false\n"
+    "X-MultipleArgs=false\nIcon=firefox\nCategories=GNOME;GTK;Network;WebBrowser;\n"
+    "MimeType=text/html;text/xml;application/xhtml+xml;\nStartupNotify=true\nActions=new-window;new-private-window;\n\n"
+    "[Desktop Action new-window]\nName=Open a New Window\nName[de]=Ein neues Fenster \u00f6ffnen\nExec=firefox -new-window\n\n"
+    "[Desktop Action new-private-window]\nName=Open a New Private Window\nExec=firefox -private-window\n",
+    "# Created by hand\n\n[Desktop Entry]\nType=Application\nName=Htop\nName[de_DE]=Htop Prozesse\n"
+    "GenericName=Process Viewer\nGenericName[de_DE.UTF-8]=Prozessanzeige\nExec=htop\nTerminal=true\n"
+    "Categories=ConsoleOnly;System;\n",
+    "[Desktop Entry]\r\nType=Application\r\nName=Settings Daemon\r\nExec=/usr/lib/daemon --replace\r\n"
+    "NoDisplay=true\r\nOnlyShowIn=GNOME;\r\n",
+    "[Desktop Entry]\nType=Application\nName=Old Tool\nExec=sh -c \"echo\\shello\\t\\\\; exit\"\nHidden=true\n",
+    "[Desktop Entry]\nEncoding=UTF-8\nName=Caf\xc3\xa9\nName[de]=\nExec=cafe\n[X-Extra]\nName=Other\n",
+    "[Desktop Entry]\nName=No exec\nNoDisplay=false\nTerminal=false\n",
+    "[Other Group]\nName=x\n",
+};
+
+/**
+ * @param files The desktop files to compare, GBytes.
+ * @param locale The locale passed to GKeyFile, NULL for the current one.
+ * @param languages The languages passed to desktop_entry_parse().
+ *
+ * @returns the number of files where both parsers agree.
+ */
+static unsigned int compare_key_file ( GPtrArray *files, const char *locale, const char * const *languages )
+{
+    unsigned int equal = 0;
+    for ( unsigned int i = 0; i < files->len; i++ ) {
+        gsize        length;
+        const char   *data = g_bytes_get_data ( g_ptr_array_index ( files, i ), &length );
+        DesktopEntry a, b;
+        if ( !parse_key_file ( data, length, locale, &a ) ) {
+            equal++;
+            continue;
+        }
+        gboolean parsed = desktop_entry_parse ( data, length, languages, &b );
+        if ( parsed && g_strcmp0 ( a.name, b.name ) == 0 && g_strcmp0 ( a.generic_name, b.generic_name ) == 0 &&
+             g_strcmp0 ( a.exec, b.exec ) == 0 && a.terminal == b.terminal && a.hidden == b.hidden && a.no_display == b.no_display ) {
+            equal++;
+        }
+        else {
+            printf ( "Mismatch: %s | %s\n", a.name, b.name );
+        }
+        desktop_entry_clear ( &a );
+        desktop_entry_clear ( &b );
+    }
+    return equal;
+}
+
+static void unit_tests ( void )
+{
+    DesktopEntry de;
+    TASSERT ( parse ( "[Desktop Entry]\nName=Files\nName[fr]=Fichiers\nName[de]=Dateien\nName[de_DE]=Dateien DE\n"
+                      "GenericName=Manager\nGenericName[de]=Verwaltung\nExec=files %U\n", &de ) );
+    TASSERT ( g_strcmp0 ( de.name, "Dateien DE" ) == 0 );
+    TASSERT ( g_strcmp0 ( de.generic_name, "Verwaltung" ) == 0 );
+    TASSERT ( g_strcmp0 ( de.exec, "files %U" ) == 0 );
+    TASSERT ( !de.terminal && !de.hidden && !de.no_display );
+    desktop_entry_clear ( &de );
+
+    // Translation for an unused language, later groups are ignored.
+    TASSERT ( parse ( "# comment\n[Desktop Entry]\r\nName[fr]=Fichiers\r\nName = Files \r\nTerminal=true\n\n"
+                      "[Desktop Action new]\nName=New\nExec=new\n", &de ) );
+    TASSERT ( g_strcmp0 ( de.name, "Files " ) == 0 );
+    TASSERT ( de.generic_name == NULL );
+    TASSERT ( de.exec == NULL );
+    TASSERT ( de.terminal );
+    desktop_entry_clear ( &de );
+
+    // Groups before the entry are skipped.
+    TASSERT ( parse ( "[Other]\nExec=other\n[Desktop Entry]\nExec=a\\sb\\\\c\\;d\\te\nHidden=1\nNoDisplay=true\n", &de ) );
+    TASSERT ( g_strcmp0 ( de.exec, "a b\\c\\;d\te" ) == 0 );
+    TASSERT ( de.hidden && de.no_display );
+    desktop_entry_clear ( &de );
+
+    // Not valid UTF-8.
+    TASSERT ( parse ( "[Desktop Entry]\nName=\xff\xfe\nExec=x\n", &de ) );
+    TASSERT ( de.name == NULL );
+    desktop_entry_clear ( &de );
+
+    TASSERT ( !parse ( "", &de ) );
+    TASSERT ( !parse ( "[Other]\nName=x\n", &de ) );
+    TASSERT ( !parse ( "Name=x\n[Desktop Entry]\nExec=x\n", &de ) );
+    TASSERT ( !parse ( "[Desktop Entry]\nExec=x\nbroken line\n", &de ) );
+    TASSERT ( !parse ( "[Desktop Entry\nExec=x\n", &de ) );
+}
+
+static void fixture_tests ( void )
+{
+    GPtrArray *files = g_ptr_array_new_with_free_func ( (GDestroyNotify) g_bytes_unref );
+    for ( unsigned int i = 0; i < G_N_ELEMENTS ( fixtures ); i++ ) {
+        g_ptr_array_add ( files, g_bytes_new_static ( fixtures[i], strlen ( fixtures[i] ) ) );
+    }
+    TASSERT ( compare_key_file ( files, "de_DE", languages ) == files->len );
+    g_ptr_array_free ( files, TRUE );
+}
+
+/**
+ * @param path The directory with desktop files.
+ *
+ * Compare against GKeyFile for every desktop file in the directory, and time both.
+ */
+static void corpus_tests ( const char *path )
+{
+    GPtrArray *files = g_ptr_array_new_with_free_func ( (GDestroyNotify) g_bytes_unref );
+    GDir      *dir   = g_dir_open ( path, 0, NULL );
+    if ( dir != NULL ) {
+        const char *name;
+        while ( ( name = g_dir_read_name ( dir ) ) != NULL ) {
+            char  *file = g_build_filename ( path, name, NULL );
+            char  *data = NULL;
+            gsize length;
+            if ( g_str_has_suffix ( name, ".desktop" ) && g_file_get_contents ( file, &data, &length, NULL ) ) {
+                g_ptr_array_add ( files, g_bytes_new_take ( data, length ) );
+            }
+            g_free ( file );
+        }
+        g_dir_close ( dir );
+    }
+
+    const char * const *current = (const char * const *) g_get_language_names ();
+    TASSERT ( compare_key_file ( files, NULL, current ) == files->len );
+
+    gint64 start = g_get_monotonic_time ();
+    for ( unsigned int r = 0; r < BENCHMARK_ROUNDS; r++ ) {
+        for ( unsigned int i = 0; i < files->len; i++ ) {
+            gsize        length;
+            const char   *data = g_bytes_get_data ( g_ptr_array_index ( files, i ), &length );
+            DesktopEntry de;
+            parse_key_file ( data, length, NULL, &de );
+            desktop_entry_clear ( &de );
+        }
+    }
+    gint64 key_file = g_get_monotonic_time () - start;
+    start = g_get_monotonic_time ();
+    for ( unsigned int r = 0; r < BENCHMARK_ROUNDS; r++ ) {
+        for ( unsigned int i = 0; i < files->len; i++ ) {
+            gsize        length;
+            const char   *data = g_bytes_get_data ( g_ptr_array_index ( files, i ), &length );
+            DesktopEntry de;
+            desktop_entry_parse ( data, length, current, &de );
+            desktop_entry_clear ( &de );
+        }
+    }
+    gint64 streaming = g_get_monotonic_time () - start;
+    printf ( "Parsed %u desktop files %d times: GKeyFile %.2f ms, desktop_entry_parse %.2f ms\n",
+             files->len, BENCHMARK_ROUNDS, key_file / 1000.0, streaming / 1000.0 );
+    g_ptr_array_free ( files, TRUE );
+}
+
+int main ( int argc, char **argv )
+{
+    unit_tests ();
+    fixture_tests ();
+    // A directory of desktop files, e.g. /usr/share/applications, can be passed to compare and time against.
+    // It is not done by default, the result would depend on what is installed.
+    if ( argc > 1 ) {
+        corpus_tests ( argv[1] );
+    }
+    return 0;
+}
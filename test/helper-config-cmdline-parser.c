@@ -60,4 +60,23 @@ int main ( int argc, char ** argv )
     TASSERT ( strcmp ( list[5], "ssh chuck; echo 'x-terminal-emulator chuck'" ) == 0 );
     g_strfreev ( list );
 
+    // Unknown keys are dropped, braces that do not form a key are kept.
+    helper_parse_setup ( "a{unknown}b {{cmd}} {} {x y}", &list, &llength, "{cmd}", "ls", NULL );
+    TASSERT ( llength == 5 );
+    TASSERT ( strcmp ( list[0], "ab" ) == 0 );
+    TASSERT ( strcmp ( list[1], "{ls}" ) == 0 );
+    TASSERT ( strcmp ( list[2], "{}" ) == 0 );
+    TASSERT ( strcmp ( list[3], "{x" ) == 0 );
+    TASSERT ( strcmp ( list[4], "y}" ) == 0 );
+    g_strfreev ( list );
+
+    // The compiled templates of the configuration give the same result.
+    config.run_shell_command = test_str;
+    helper_launch_setup ();
+    helper_parse_setup ( test_str, &list, &llength, "{host}", "chuck",
+                         "{terminal}", "x-terminal-emulator", NULL );
+    TASSERT ( llength == 6 );
+    TASSERT ( strcmp ( list[5], "ssh chuck; echo 'x-terminal-emulator chuck'" ) == 0 );
+    g_strfreev ( list );
+    helper_launch_cleanup ();
 }
@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <glib.h>
 #include <history.h>
+#include <settings.h>
+#include <time.h>
 #include <string.h>
 
 static int test = 0;
@@ -72,27 +74,132 @@ static void history_test ( void )
 
         g_free ( p );
     }
-    // Max 25 entries.
+    // Capacity of 25 entries: aap was used twice, then the most recent go first.
+    config.max_history_size = 25;
     history_set ( file, "blaat" );
     retv = history_get_list ( file, &length );
 
     TASSERT ( retv != NULL );
     TASSERT ( length == 25 );
-    for ( unsigned int in = 0; in < 24; in++ ) {
-        char *p = g_strdup_printf ( "aap%i", in + 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "aap" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[1], "blaat" ) == 0 );
+    for ( unsigned int in = 2; in < 25; in++ ) {
+        char *p = g_strdup_printf ( "aap%i", 27 - in );
         TASSERT ( g_strcmp0 ( retv[in], p ) == 0 );
 
         g_free ( p );
     }
 
+    GHashTable *index = history_index ( retv, length );
+    TASSERT ( g_hash_table_size ( index ) == 25 );
+    TASSERT ( g_hash_table_contains ( index, "aap3" ) );
+    TASSERT ( g_hash_table_contains ( index, "blaat" ) );
+    TASSERT ( !g_hash_table_contains ( index, "aap2" ) );
     g_strfreev ( retv );
+    // The index keeps its own copies.
+    TASSERT ( g_hash_table_contains ( index, "aap25" ) );
+    g_hash_table_destroy ( index );
+    config.max_history_size = 1000;
 
     unlink ( file );
 }
 
+static void append ( const char *line )
+{
+    FILE *fp = fopen ( file, "a" );
+    fputs ( line, fp );
+    fclose ( fp );
+}
+
+static void frecency_test ( void )
+{
+    unsigned int length = 0;
+    char         **retv;
+    char         *line;
+    gint64       now = time ( NULL );
+    unlink ( file );
+
+    // Five uses two months ago count less than one use now.
+    for ( unsigned int i = 0; i < 5; i++ ) {
+        line = g_strdup_printf ( "+%" G_GINT64_FORMAT " old\n", now - 60 * 24 * 3600 );
+        append ( line );
+        g_free ( line );
+    }
+    history_set ( file, "new" );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "new" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[1], "old" ) == 0 );
+    g_strfreev ( retv );
+
+    // Two recent uses count more than one.
+    history_set ( file, "old" );
+    history_set ( file, "old" );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "old" ) == 0 );
+    g_strfreev ( retv );
+    unlink ( file );
+
+    // A large history, compacted along the way, keeps the order and the capacity.
+    for ( unsigned int i = 0; i < 2000; i++ ) {
+        char *p = g_strdup_printf ( "entry%u", ( i < 1500 ) ? i : i - 500 );
+        history_set ( file, p );
+        g_free ( p );
+    }
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 1000 );
+    // Used twice.
+    TASSERT ( g_strcmp0 ( retv[0], "entry1499" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[499], "entry1000" ) == 0 );
+    // Then the most recent.
+    TASSERT ( g_strcmp0 ( retv[500], "entry999" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[999], "entry500" ) == 0 );
+    g_strfreev ( retv );
+
+    unlink ( file );
+
+    // History written before the journal, and by the first journal version.
+    append ( "5 foo\n3 bar\n0 baz\n+ baz\n+ baz\n- bar\n" );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "foo" ) == 0 );
+    TASSERT ( g_strcmp0 ( retv[1], "baz" ) == 0 );
+    g_strfreev ( retv );
+    unlink ( file );
+}
+
+static void deferred_test ( void )
+{
+    unsigned int length = 0;
+    char         **retv;
+    unlink ( file );
+
+    // Written in order by the background writer, reading waits for it.
+    history_set_deferred ( file, "aap" );
+    history_set_deferred ( file, "noot" );
+    history_set_deferred ( file, "noot" );
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "noot" ) == 0 );
+    g_strfreev ( retv );
+
+    history_set_deferred ( file, "mies" );
+    history_remove ( file, "mies" );
+    history_set_deferred ( file, "aap" );
+    history_flush ();
+    retv = history_get_list ( file, &length );
+    TASSERT ( length == 2 );
+    TASSERT ( g_strcmp0 ( retv[0], "aap" ) == 0 );
+    g_strfreev ( retv );
+    unlink ( file );
+}
+
 int main (  G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
 {
     history_test ();
+    frecency_test ();
+    deferred_test ();
 
     return 0;
 }
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <assert.h>
+#include <glib.h>
+#include <string.h>
+#include <i3-tree.h>
+
+static int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %i passed (%s)\n", ++test, # a ); \
+}
+
+static I3Window *parse ( const char *data, unsigned int *num )
+{
+    return i3_tree_parse ( data, strlen ( data ), num );
+}
+
+int main ( G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
+{
+    unsigned int num;
+    I3Window     *w;
+
+    // Trimmed down GET_TREE reply: a workspace with a window and a floating window, a dock area.
+    const char *tree =
+        "{\"id\":1,\"type\":\"root\",\"name\":\"root\",\"window\":null,\"nodes\":["
+        " {\"id\":2,\"type\":\"output\",\"name\":\"DP-1\",\"rect\":{\"x\":0,\"y\":0},\"nodes\":["
+        "  {\"id\":3,\"type\":\"dockarea\",\"nodes\":["
+        "   {\"id\":4,\"type\":\"con\",\"name\":\"bar\",\"window\":4194306,\"nodes\":[],"
+        "    \"window_properties\":{\"class\":\"i3bar\",\"instance\":\"i3bar\"}}]},"
+        "  {\"id\":5,\"type\":\"workspace\",\"name\":\"1\",\"nodes\":["
+        "   {\"id\":6,\"type\":\"con\",\"name\":\"vim \\\"a.c\\\" \\u00e9\\ud83d\\ude00\",\"window\":6291459,"
+        "    \"urgent\":true,\"focused\":false,\"marks\":[\"x\"],\"percent\":0.5,"
+        "    \"window_properties\":{\"class\":\"URxvt\",\"instance\":\"urxvt\",\"window_role\":null,"
+        "     \"transient_for\":null},\"nodes\":[],\"floating_nodes\":[]}],"
+        "   \"floating_nodes\":[{\"id\":7,\"type\":\"floating_con\",\"window\":null,\"nodes\":["
+        "    {\"id\":8,\"type\":\"con\",\"name\":\"Dialog\",\"window\":8388611,\"focused\":true,"
+        "     \"window_type\":\"dialog\",\"window_properties\":{\"class\":\"Gimp\",\"window_role\":\"gimp-dock\"}}]}]}]}]}";
+    w = parse ( tree, &num );
+    TASSERT ( w != NULL );
+    TASSERT ( num == 2 );
+    TASSERT ( w[0].window == 6291459 );
+    TASSERT ( g_strcmp0 ( w[0].title, "vim \"a.c\" \xc3\xa9\xf0\x9f\x98\x80" ) == 0 );
+    TASSERT ( g_strcmp0 ( w[0].class, "URxvt" ) == 0 );
+    TASSERT ( g_strcmp0 ( w[0].instance, "urxvt" ) == 0 );
+    TASSERT ( w[0].role == NULL );
+    TASSERT ( w[0].urgent && !w[0].focused );
+    TASSERT ( w[1].window == 8388611 );
+    TASSERT ( g_strcmp0 ( w[1].title, "Dialog" ) == 0 );
+    TASSERT ( g_strcmp0 ( w[1].role, "gimp-dock" ) == 0 );
+    TASSERT ( w[1].instance == NULL );
+    TASSERT ( !w[1].urgent && w[1].focused );
+    i3_tree_free ( w, num );
+
+    // Dock and desktop windows are left out.
+    w = parse ( "{\"nodes\":[{\"window\":5,\"window_type\":\"desktop\"},{\"window\":6,\"window_type\":\"normal\"}]}", &num );
+    TASSERT ( w != NULL && num == 1 && w[0].window == 6 );
+    i3_tree_free ( w, num );
+
+    w = parse ( "  {}  ", &num );
+    TASSERT ( w != NULL && num == 0 );
+    i3_tree_free ( w, num );
+
+    // Invalid replies.
+    TASSERT ( parse ( "", &num ) == NULL && num == 0 );
+    TASSERT ( parse ( "[]", &num ) == NULL );
+    TASSERT ( parse ( "{\"nodes\":[{\"window\":5}]", &num ) == NULL );
+    TASSERT ( parse ( "{\"nodes\":[{\"window\":5,}]}", &num ) == NULL );
+    TASSERT ( parse ( "{\"name\":\"a\\qb\"}", &num ) == NULL );
+    TASSERT ( parse ( "{\"window\":99999999999}", &num ) == NULL );
+    TASSERT ( parse ( "{\"a\":1} x", &num ) == NULL );
+
+    // Deep nesting is refused, not recursed into.
+    GString *deep = g_string_new ( "{\"a\":" );
+    for ( int i = 0; i < 1000; i++ ) {
+        g_string_append ( deep, "[" );
+    }
+    for ( int i = 0; i < 1000; i++ ) {
+        g_string_append ( deep, "]" );
+    }
+    g_string_append ( deep, "}" );
+    TASSERT ( parse ( deep->str, &num ) == NULL );
+    g_string_free ( deep, TRUE );
+    return 0;
+}
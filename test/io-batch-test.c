@@ -0,0 +1,87 @@
+#include <unistd.h>
+#include <errno.h>
+
+#include <stdio.h>
+#include <assert.h>
+#include <glib.h>
+#include <sys/stat.h>
+#include <io-batch.h>
+#include <string.h>
+
+static int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %i passed (%s)\n", ++test, # a ); \
+}
+
+#define NUM_FILES    600
+
+int main ( G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
+{
+    char *dir = g_dir_make_tmp ( "rofi-io-batch-XXXXXX", NULL );
+    TASSERT ( dir != NULL );
+
+    // More files than IO_BATCH_DEPTH, so slots get reused.
+    char           *paths[NUM_FILES + 2];
+    IOBatchRequest reqs[NUM_FILES + 2];
+    memset ( reqs, 0, sizeof ( reqs ) );
+    for ( unsigned int i = 0; i < NUM_FILES; i++ ) {
+        char *content = g_strdup_printf ( "file %u\n", i );
+        paths[i] = g_strdup_printf ( "%s/%u", dir, i );
+        g_file_set_contents ( paths[i], content, i == 0 ? 0 : -1, NULL );
+        chmod ( paths[i], ( i % 2 ) ? 0755 : 0644 );
+        g_free ( content );
+    }
+    paths[NUM_FILES]     = g_strdup_printf ( "%s/missing", dir );
+    paths[NUM_FILES + 1] = g_strdup ( dir );
+    for ( unsigned int i = 0; i < NUM_FILES + 2; i++ ) {
+        reqs[i].path = paths[i];
+    }
+
+    io_batch_read ( reqs, NUM_FILES + 2 );
+    // Empty file.
+    TASSERT ( reqs[0].error == 0 );
+    TASSERT ( reqs[0].length == 0 );
+    TASSERT ( reqs[0].data != NULL && reqs[0].data[0] == '\0' );
+    unsigned int valid = 0;
+    for ( unsigned int i = 1; i < NUM_FILES; i++ ) {
+        char *content = g_strdup_printf ( "file %u\n", i );
+        if ( reqs[i].error == 0 && reqs[i].length == strlen ( content ) && strcmp ( reqs[i].data, content ) == 0 ) {
+            valid++;
+        }
+        g_free ( content );
+    }
+    TASSERT ( valid == NUM_FILES - 1 );
+    TASSERT ( reqs[NUM_FILES].error == ENOENT );
+    TASSERT ( reqs[NUM_FILES].data == NULL );
+    // Directories are not read.
+    TASSERT ( reqs[NUM_FILES + 1].error != 0 );
+    TASSERT ( reqs[NUM_FILES + 1].data == NULL );
+    for ( unsigned int i = 0; i < NUM_FILES + 2; i++ ) {
+        g_free ( reqs[i].data );
+    }
+
+    io_batch_stat ( reqs, NUM_FILES + 2 );
+    unsigned int executable = 0;
+    for ( unsigned int i = 0; i < NUM_FILES; i++ ) {
+        if ( io_batch_is_executable ( &( reqs[i] ) ) ) {
+            executable++;
+        }
+    }
+    TASSERT ( executable == NUM_FILES / 2 );
+    TASSERT ( reqs[1].size == (off_t) strlen ( "file 1\n" ) );
+    TASSERT ( reqs[NUM_FILES].error == ENOENT );
+    TASSERT ( !io_batch_is_executable ( &( reqs[NUM_FILES] ) ) );
+    TASSERT ( S_ISDIR ( reqs[NUM_FILES + 1].mode ) );
+    TASSERT ( !io_batch_is_executable ( &( reqs[NUM_FILES + 1] ) ) );
+
+    for ( unsigned int i = 0; i < NUM_FILES + 1; i++ ) {
+        unlink ( paths[i] );
+        g_free ( paths[i] );
+    }
+    g_free ( paths[NUM_FILES + 1] );
+    rmdir ( dir );
+    g_free ( dir );
+    return 0;
+}
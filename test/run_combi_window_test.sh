@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+
+# Close a window while combi shows it, the rows after it should still select the right window.
+sleep 1;
+xterm -T MonkeySee sh &
+XPID=$!
+sleep 1;
+xterm -T TermClosed sh &
+CPID=$!
+sleep 1;
+xterm -T TermUnwanted sh &
+TPID=$!
+sleep 1;
+rofi -show combi -modi combi -combi-modi window,run > output.txt &
+RPID=$!
+
+sleep 5;
+kill ${CPID}
+sleep 1;
+xdotool type 'MonkeySee'
+sleep 0.4
+xdotool key Return
+sleep 1;
+xdotool key Ctrl+d
+sleep 1;
+kill ${TPID}
+if pgrep -u $USER xterm
+then
+    pkill -u $USER xterm
+    kill ${RPID}
+    exit 1
+fi
+#  Get result, kill xvfb
+wait ${RPID}
+RETV=$?
+exit ${RETV}
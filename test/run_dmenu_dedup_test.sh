@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+
+# Rows 2 and 5 are duplicates, -selected-row and the printed indexes refer to the original input.
+echo -e -n "aap\nnoot\naap\nmies\nzus\nnoot\njet" | rofi -dmenu -dedup -format i -selected-row 3 > output.txt &
+RPID=$!
+
+# send enter.
+sleep 5;
+# mies (3)
+xdotool key Shift+Return
+sleep 0.4
+# zus (4)
+xdotool key Shift+Return
+sleep 0.4
+# jet (6)
+xdotool key Return
+
+#  Get result, kill xvfb
+wait ${RPID}
+RETV=$?
+OUTPUT=$(cat output.txt | tr '\n' ' ')
+if [ "${OUTPUT}" != '3 4 6 ' ]
+then
+    echo "Got: '${OUTPUT}' expected '3 4 6 '"
+    exit 1
+fi
+exit ${RETV}
@@ -0,0 +1,68 @@
+#!/usr/bin/env bash
+
+# Binary input: flags, display length, match length (32 bit little endian), then the strings.
+function input ( )
+{
+    # urgent
+    printf '\x01\x00\x00\x00\x04\x00\x00\x00\x00\x00\x00\x00aap\x00'
+    # active, with a separate match text
+    printf '\x02\x00\x00\x00\x05\x00\x00\x00\x04\x00\x00\x00noot\x00zzz\x00'
+    # markup
+    printf '\x04\x00\x00\x00\x0c\x00\x00\x00\x00\x00\x00\x00<b>mies</b>\x00'
+    # not NUL terminated, skipped
+    printf '\x00\x00\x00\x00\x04\x00\x00\x00\x00\x00\x00\x00bad!'
+    # duplicate of the first row
+    printf '\x00\x00\x00\x00\x04\x00\x00\x00\x00\x00\x00\x00aap\x00'
+    # urgent and active
+    printf '\x03\x00\x00\x00\x04\x00\x00\x00\x00\x00\x00\x00jet\x00'
+    # truncated, ignored
+    printf '\x00\x00\x00\x00\x64\x00\x00\x00\x00\x00\x00\x00trunc'
+}
+
+function check ( )
+{
+    if [ "${1}" != "${2}" ]
+    then
+        echo "Got: '${1}' expected '${2}'"
+        exit 1
+    fi
+}
+
+# Indexes refer to the records of the input, the broken record and the duplicate are dropped.
+OUTPUT=$(input | rofi -dmenu -input-format rbin -dedup -format i -dump 2> errors.txt | tr '\n' ' ')
+check "${OUTPUT}" '0 1 2 5 '
+grep -q "not NUL terminated" errors.txt || { echo "No warning for the unterminated record"; exit 1; }
+grep -q "truncated" errors.txt || { echo "No warning for the truncated input"; exit 1; }
+
+# Without -dedup the duplicate is kept.
+OUTPUT=$(input | rofi -dmenu -input-format rbin -format i -dump 2> /dev/null | tr '\n' ' ')
+check "${OUTPUT}" '0 1 2 4 5 '
+
+# Rows with a match text are matched on it, not on the display text.
+OUTPUT=$(input | rofi -dmenu -input-format rbin -format s -filter zzz -dump 2> /dev/null | tr '\n' ' ')
+check "${OUTPUT}" 'noot '
+OUTPUT=$(input | rofi -dmenu -input-format rbin -format s -filter noot -dump 2> /dev/null | tr '\n' ' ')
+check "${OUTPUT}" ''
+
+# The flags do not end up in the text.
+OUTPUT=$(input | rofi -dmenu -input-format rbin -format s -filter mies -dump 2> /dev/null | tr '\n' ' ')
+check "${OUTPUT}" '<b>mies</b> '
+
+# Interactive: the urgent, active and markup rows can be selected like any other.
+input | rofi -dmenu -input-format rbin -dedup -format i -markup-rows > output.txt 2> /dev/null &
+RPID=$!
+
+sleep 5;
+xdotool key Down
+sleep 0.2
+xdotool key Down
+sleep 0.2
+xdotool key Shift+Return
+sleep 0.4
+xdotool key Return
+
+wait ${RPID}
+RETV=$?
+OUTPUT=$(cat output.txt | tr '\n' ' ')
+check "${OUTPUT}" '2 5 '
+exit ${RETV}
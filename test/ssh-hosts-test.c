@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <assert.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <ssh-hosts.h>
+
+static int test = 0;
+
+#define TASSERT( a )    {                                \
+        assert ( a );                                    \
+        printf ( "Test %i passed (%s)\n", ++test, # a ); \
+}
+
+static void write_file ( const char *dir, const char *name, const char *content, gboolean append )
+{
+    char *path = g_build_filename ( dir, name, NULL );
+    FILE *fp   = fopen ( path, append ? "a" : "w" );
+    assert ( fp != NULL );
+    fputs ( content, fp );
+    fclose ( fp );
+    g_free ( path );
+}
+
+/**
+ * Put the modification time in the past, so the next change of the file or directory
+ * is noticed even when it happens within the timestamp granularity.
+ */
+static void set_old_mtime ( const char *dir, const char *name )
+{
+    struct timespec times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    char            *path    = g_build_filename ( dir, name, NULL );
+    assert ( utimensat ( AT_FDCWD, path, times, 0 ) == 0 );
+    g_free ( path );
+}
+
+static void remove_tree ( const char *path )
+{
+    GDir *dir = g_dir_open ( path, 0, NULL );
+    if ( dir != NULL ) {
+        const char *name;
+        while ( ( name = g_dir_read_name ( dir ) ) != NULL ) {
+            char *child = g_build_filename ( path, name, NULL );
+            remove_tree ( child );
+            g_free ( child );
+        }
+        g_dir_close ( dir );
+    }
+    g_remove ( path );
+}
+
+/**
+ * Read the hosts, and check them against the expected space separated list.
+ */
+static gboolean read_hosts ( const char *home, const char *cache, const char *expected, SSHCacheState *state )
+{
+    unsigned int length = 0;
+    char         **hosts = ssh_hosts_read ( home, cache, SSH_HOSTS_CACHE_PARSE_KNOWN_HOSTS, &length, state );
+    char         *found  = ( hosts != NULL ) ? g_strjoinv ( " ", hosts ) : g_strdup ( "" );
+    gboolean     retv    = g_strcmp0 ( found, expected ) == 0 && length == ( hosts != NULL ? g_strv_length ( hosts ) : 0 );
+    if ( !retv ) {
+        fprintf ( stderr, "Expected '%s', got '%s'\n", expected, found );
+    }
+    g_free ( found );
+    g_strfreev ( hosts );
+    return retv;
+}
+
+int main ( G_GNUC_UNUSED int argc, G_GNUC_UNUSED char **argv )
+{
+    SSHCacheState state;
+    char          *home = g_dir_make_tmp ( "rofi-ssh-hosts-XXXXXX", NULL );
+    assert ( home != NULL );
+    char          *ssh   = g_build_filename ( home, ".ssh", NULL );
+    char          *confd = g_build_filename ( ssh, "conf.d", NULL );
+    char          *cache = g_build_filename ( home, "rofi.sshhosts", NULL );
+    char          *fresh = g_build_filename ( home, "fresh.sshhosts", NULL );
+    assert ( g_mkdir_with_parents ( confd, 0700 ) == 0 );
+    write_file ( ssh, "known_hosts", "alpha,10.0.0.1 ssh-rsa AAAA\n|1|hashed ssh-rsa AAAA\nbeta,10.0.0.2 ssh-rsa AAAA\n", FALSE );
+    write_file ( ssh, "config", "Host gamma *.wild\nInclude conf.d/*\n", FALSE );
+    write_file ( confd, "one", "Host delta Gamma\n", FALSE );
+    set_old_mtime ( ssh, "known_hosts" );
+    set_old_mtime ( ssh, "config" );
+    set_old_mtime ( confd, "one" );
+    set_old_mtime ( ssh, "conf.d" );
+
+    // Full parse, then the same hosts from the cache.
+    TASSERT ( read_hosts ( home, cache, "alpha beta gamma delta", &state ) && state == SSH_CACHE_MISS );
+    TASSERT ( g_file_test ( cache, G_FILE_TEST_IS_REGULAR ) );
+    TASSERT ( read_hosts ( home, cache, "alpha beta gamma delta", &state ) && state == SSH_CACHE_HIT );
+
+    // Appended to known_hosts: only the tail is parsed, the result matches a full parse.
+    write_file ( ssh, "known_hosts", "epsilon,10.0.0.3 ssh-rsa AAAA\nalpha,10.0.0.4 ssh-rsa AAAA\ndelta ssh-rsa AAAA\n", TRUE );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon gamma delta", &state ) && state == SSH_CACHE_TAIL );
+    TASSERT ( read_hosts ( home, fresh, "alpha beta epsilon gamma delta", &state ) && state == SSH_CACHE_MISS );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon gamma delta", &state ) && state == SSH_CACHE_HIT );
+    // Without a newline at the end the last line is parsed again on the next append.
+    write_file ( ssh, "known_hosts", "zeta,10.0.0.5 ssh-rsa AAAA", TRUE );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta gamma delta", &state ) && state == SSH_CACHE_TAIL );
+    write_file ( ssh, "known_hosts", "\neta,10.0.0.6 ssh-rsa AAAA\n", TRUE );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta", &state ) && state == SSH_CACHE_TAIL );
+    g_remove ( fresh );
+    TASSERT ( read_hosts ( home, fresh, "alpha beta epsilon zeta eta gamma delta", &state ) && state == SSH_CACHE_MISS );
+
+    // A new file in an included directory.
+    write_file ( confd, "two", "Host theta\n", FALSE );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta", &state ) && state == SSH_CACHE_MISS );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta", &state ) && state == SSH_CACHE_HIT );
+
+    // A changed config file.
+    write_file ( ssh, "config", "Host iota\n", TRUE );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta iota", &state ) && state == SSH_CACHE_MISS );
+
+    // Corrupt caches are rejected.
+    gchar *content = NULL;
+    gsize length   = 0;
+    TASSERT ( g_file_get_contents ( cache, &content, &length, NULL ) && length > 64 );
+    TASSERT ( g_file_set_contents ( cache, content, length / 2, NULL ) );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta iota", &state ) && state == SSH_CACHE_MISS );
+    content[0] = 'X';
+    TASSERT ( g_file_set_contents ( cache, content, length, NULL ) );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta iota", &state ) && state == SSH_CACHE_MISS );
+    content[0] = 'R';
+    content[length - 1] = 'x';
+    TASSERT ( g_file_set_contents ( cache, content, length, NULL ) );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta iota", &state ) && state == SSH_CACHE_MISS );
+    TASSERT ( read_hosts ( home, cache, "alpha beta epsilon zeta eta gamma delta theta iota", &state ) && state == SSH_CACHE_HIT );
+    g_free ( content );
+
+    // A cache of another home directory is not used.
+    char *other = g_build_filename ( home, "other", NULL );
+    TASSERT ( read_hosts ( other, cache, "", &state ) && state == SSH_CACHE_MISS );
+    g_free ( other );
+
+    // The favorites go in front, duplicates are dropped ignoring case.
+    unsigned int num        = 2;
+    char         **favorites = g_strsplit ( "BETA omega", " ", -1 );
+    char         **more      = g_strsplit ( "alpha beta Omega", " ", -1 );
+    char         **merged    = ssh_hosts_merge ( favorites, &num, more, 3 );
+    TASSERT ( num == 3 && g_strcmp0 ( merged[0], "BETA" ) == 0 && g_strcmp0 ( merged[1], "omega" ) == 0 &&
+              g_strcmp0 ( merged[2], "alpha" ) == 0 && merged[3] == NULL );
+    g_strfreev ( merged );
+
+    remove_tree ( home );
+    g_free ( fresh );
+    g_free ( cache );
+    g_free ( confd );
+    g_free ( ssh );
+    g_free ( home );
+    return 0;
+}